@@ -0,0 +1,60 @@
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "flat_hash_map.hpp"
+
+namespace {
+constexpr std::size_t NUMBER_OF_KEYS = 500000;
+constexpr std::size_t NUMBER_OF_LOOKUPS = 1000000;
+
+struct StringHash {
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view key) const noexcept {
+        return std::hash<std::string_view>{}(key);
+    }
+};
+
+template<typename Map>
+void measure(const std::vector<std::string> &keys, const std::vector<std::string_view> &lookups,
+             std::string_view name) {
+    Map map;
+    for (std::size_t idx{0}; idx < keys.size(); ++idx) {
+        map.try_emplace(keys[idx], static_cast<int>(idx));
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t sum{0};
+    for (const auto key : lookups) {
+        sum += map.find(key)->second;
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << name << ": " << elapsed.count() / lookups.size() << " ns per lookup (" << sum << ")" << std::endl;
+}
+} // namespace
+
+// Lookups of existing keys by view, in a table larger than the caches, against std::unordered_map.
+int main() {
+    std::vector<std::string> keys;
+    keys.reserve(NUMBER_OF_KEYS);
+    for (std::size_t idx{0}; idx < NUMBER_OF_KEYS; ++idx) {
+        keys.push_back("key:" + std::to_string(idx * 7919));
+    }
+    std::vector<std::string_view> lookups;
+    lookups.reserve(NUMBER_OF_LOOKUPS);
+    std::mt19937 random{7};
+    for (std::size_t idx{0}; idx < NUMBER_OF_LOOKUPS; ++idx) {
+        lookups.push_back(keys[random() % NUMBER_OF_KEYS]);
+    }
+
+    measure<FlatHashMap<std::string, int, StringHash, std::equal_to<>>>(keys, lookups, "FlatHashMap");
+    measure<std::unordered_map<std::string, int, StringHash, std::equal_to<>>>(keys, lookups, "std::unordered_map");
+    return 0;
+}
@@ -0,0 +1,563 @@
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "latency_histogram.hpp"
+#include "socket_utils.hpp"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+enum class Command { get, set, ping };
+constexpr std::array<std::string_view, 3> COMMAND_NAMES{"GET", "SET", "PING"};
+constexpr std::size_t KEY_DIGITS = 12;
+
+struct BenchConfig {
+    std::string host{"127.0.0.1"};
+    int port{6379};
+    // Connect to a Unix domain socket instead of host and port.
+    std::string unix_socket_path{};
+    std::size_t number_of_connections{50};
+    std::size_t number_of_threads{1};
+    // Number of requests a connection keeps in flight.
+    std::size_t pipeline_depth{1};
+    std::uint64_t number_of_requests{100000};
+    // When set, requests are sent for this long instead of a fixed number of them.
+    std::chrono::seconds duration{0};
+    // Keys are picked uniformly from key:000000000000 up to the key space.
+    std::size_t key_space{10000};
+    std::size_t value_size{64};
+    // Relative weights of GET, SET and PING.
+    std::array<unsigned, 3> command_mix{50, 50, 0};
+};
+
+/**
+ * @brief A client connection of a worker, with the requests it sent and not got a reply for yet.
+ *
+ */
+struct Connection {
+    int file_descriptor{-1};
+    std::string output;
+    std::size_t output_offset{0};
+    std::string input;
+    std::deque<Clock::time_point> send_times;
+    bool is_waiting_for_write{false};
+};
+
+struct WorkerResult {
+    LatencyHistogram latencies;
+    std::uint64_t number_of_errors{0};
+};
+
+/**
+ * @brief Hands out the requests to the workers, either up to a number of them or until the deadline.
+ *
+ */
+class RequestBudget {
+  public:
+    explicit RequestBudget(const BenchConfig &config)
+      : number_of_requests_{config.number_of_requests}, has_deadline_{config.duration.count() != 0},
+        deadline_{Clock::now() + config.duration} {
+    }
+
+    bool take() {
+        if (has_deadline_) {
+            return Clock::now() < deadline_;
+        }
+
+        return requests_issued_.fetch_add(1, std::memory_order_relaxed) < number_of_requests_;
+    }
+
+  private:
+    std::uint64_t number_of_requests_;
+    bool has_deadline_;
+    Clock::time_point deadline_;
+    std::atomic<std::uint64_t> requests_issued_{0};
+};
+
+void print_usage(const char *program_name) {
+    std::cout << "Usage: " << program_name << " [OPTIONS]\n";
+    std::cout << "Options:\n";
+    std::cout << "  --host HOST         Server address (default: 127.0.0.1)\n";
+    std::cout << "  --port PORT_NUMBER  Server port (default: 6379)\n";
+    std::cout << "  --unixsocket PATH   Connect to a Unix domain socket instead of host and port\n";
+    std::cout << "  --connections N     Number of connections (default: 50)\n";
+    std::cout << "  --threads N         Number of threads which share the connections (default: 1)\n";
+    std::cout << "  --pipeline N        Requests in flight per connection (default: 1)\n";
+    std::cout << "  --requests N        Total number of requests (default: 100000)\n";
+    std::cout << "  --duration SECONDS  Send requests for this long instead of a number of them\n";
+    std::cout << "  --keyspace N        Number of distinct keys (default: 10000)\n";
+    std::cout << "  --value-size BYTES  Size of the SET values (default: 64)\n";
+    std::cout << "  --mix GET:SET:PING  Relative weights of the commands (default: 50:50:0)\n";
+    std::cout << "  --help, -h          Show this help message\n";
+}
+
+std::array<unsigned, 3> parse_command_mix(const std::string &argument) {
+    std::array<unsigned, 3> command_mix{};
+    std::istringstream stream{argument};
+    char separator;
+    if (!(stream >> command_mix[0] >> separator >> command_mix[1] >> separator >> command_mix[2]) ||
+        command_mix[0] + command_mix[1] + command_mix[2] == 0) {
+        throw std::invalid_argument("Invalid command mix: " + argument);
+    }
+
+    return command_mix;
+}
+
+BenchConfig parse_command_line(int argc, char *argv[]) {
+    BenchConfig config;
+
+    static struct option long_options[] = {{"host", required_argument, nullptr, 'H'},
+                                           {"port", required_argument, nullptr, 'p'},
+                                           {"unixsocket", required_argument, nullptr, 'u'},
+                                           {"connections", required_argument, nullptr, 'c'},
+                                           {"threads", required_argument, nullptr, 't'},
+                                           {"pipeline", required_argument, nullptr, 'P'},
+                                           {"requests", required_argument, nullptr, 'n'},
+                                           {"duration", required_argument, nullptr, 'D'},
+                                           {"keyspace", required_argument, nullptr, 'r'},
+                                           {"value-size", required_argument, nullptr, 'd'},
+                                           {"mix", required_argument, nullptr, 'm'},
+                                           {"help", no_argument, nullptr, 'h'},
+                                           {0, 0, 0, 0}};
+
+    int option_index = 0;
+    int c;
+
+    while ((c = getopt_long(argc, argv, "H:p:u:c:t:P:n:D:r:d:m:h", long_options, &option_index)) != -1) {
+        switch (c) {
+        case 'H':
+            config.host = optarg;
+            break;
+        case 'p':
+            config.port = std::stoi(optarg);
+            break;
+        case 'u':
+            config.unix_socket_path = optarg;
+            break;
+        case 'c':
+            config.number_of_connections = std::max<std::size_t>(std::stoul(optarg), 1);
+            break;
+        case 't':
+            config.number_of_threads = std::max<std::size_t>(std::stoul(optarg), 1);
+            break;
+        case 'P':
+            config.pipeline_depth = std::max<std::size_t>(std::stoul(optarg), 1);
+            break;
+        case 'n':
+            config.number_of_requests = std::stoull(optarg);
+            break;
+        case 'D':
+            config.duration = std::chrono::seconds{std::stoul(optarg)};
+            break;
+        case 'r':
+            config.key_space = std::max<std::size_t>(std::stoul(optarg), 1);
+            break;
+        case 'd':
+            config.value_size = std::stoul(optarg);
+            break;
+        case 'm':
+            config.command_mix = parse_command_mix(optarg);
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            exit(0);
+            break;
+        case '?':
+            // getopt_long already printed an error message
+            print_usage(argv[0]);
+            exit(1);
+            break;
+        default:
+            exit(1);
+        }
+    }
+
+    config.number_of_threads = std::min(config.number_of_threads, config.number_of_connections);
+    return config;
+}
+
+int connect_to_server(const BenchConfig &config) {
+    TCPSocketConfig socket_config;
+    socket_config.ip = config.host;
+    socket_config.port = config.port;
+    socket_config.is_blocking = true;
+    socket_config.unix_socket_path = config.unix_socket_path;
+
+    const auto file_descriptor = create_socket(socket_config);
+
+    sockaddr_storage address;
+    socklen_t address_length = sizeof(address);
+    if (getpeername(file_descriptor, reinterpret_cast<sockaddr *>(&address), &address_length) != 0) {
+        throw SocketException("Could not connect to the server");
+    }
+
+    if (config.unix_socket_path.empty()) {
+        const int one = 1;
+        setsockopt(file_descriptor, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    if (!set_non_blocking(file_descriptor)) {
+        throw SocketException("setNonBlocking() failed.");
+    }
+
+    return file_descriptor;
+}
+
+void append_bulk_string(std::string &output, std::string_view value) {
+    output += '$';
+    output += std::to_string(value.size());
+    output += "\r\n";
+    output += value;
+    output += "\r\n";
+}
+
+void append_request(std::string &output, Command command, std::size_t key_index, std::string_view value) {
+    std::array<char, 4 + KEY_DIGITS> key{'k', 'e', 'y', ':'};
+    auto digits = std::to_string(key_index);
+    std::fill(key.begin() + 4, key.end(), '0');
+    std::copy(digits.rbegin(), digits.rend(), key.rbegin());
+    const auto key_view = std::string_view{key.data(), key.size()};
+
+    switch (command) {
+    case Command::get:
+        output += "*2\r\n$3\r\nGET\r\n";
+        append_bulk_string(output, key_view);
+        break;
+    case Command::set:
+        output += "*3\r\n$3\r\nSET\r\n";
+        append_bulk_string(output, key_view);
+        append_bulk_string(output, value);
+        break;
+    case Command::ping:
+        output += "*1\r\n$4\r\nPING\r\n";
+        break;
+    }
+}
+
+std::optional<std::size_t> find_line_end(std::string_view input) {
+    const auto line_end = input.find("\r\n");
+    if (line_end == std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    return line_end;
+}
+
+std::int64_t parse_length(std::string_view digits) {
+    std::int64_t length{0};
+    const auto [end, error_code] = std::from_chars(digits.data(), digits.data() + digits.size(), length);
+    if (error_code != std::errc{} || end != digits.data() + digits.size()) {
+        throw std::runtime_error("Invalid length in reply: " + std::string{digits});
+    }
+
+    return length;
+}
+
+/**
+ * @return Size of the reply at the start of the input, nothing when it is not complete yet.
+ */
+std::optional<std::size_t> get_reply_size(std::string_view input) {
+    const auto line_end = find_line_end(input);
+    if (!line_end.has_value()) {
+        return std::nullopt;
+    }
+    const auto header_size = *line_end + 2;
+
+    switch (input.front()) {
+    case '+':
+    case '-':
+    case ':':
+        return header_size;
+    case '$': {
+        const auto length = parse_length(input.substr(1, *line_end - 1));
+        const auto size = header_size + (length < 0 ? 0 : static_cast<std::size_t>(length) + 2);
+        return size <= input.size() ? std::optional{size} : std::nullopt;
+    }
+    case '*': {
+        const auto number_of_elements = parse_length(input.substr(1, *line_end - 1));
+        auto size = header_size;
+        for (std::int64_t idx{0}; idx < number_of_elements; ++idx) {
+            const auto element_size = get_reply_size(input.substr(size));
+            if (!element_size.has_value()) {
+                return std::nullopt;
+            }
+            size += *element_size;
+        }
+        return size;
+    }
+    default:
+        throw std::runtime_error("Invalid reply prefix: " + std::string{input.substr(0, 1)});
+    }
+}
+
+class Worker {
+  public:
+    Worker(const BenchConfig &config, RequestBudget &budget, std::vector<int> file_descriptors, std::uint64_t seed)
+      : config_{config}, budget_{budget}, random_engine_{seed},
+        command_distribution_{config.command_mix.begin(), config.command_mix.end()},
+        key_distribution_{0, config.key_space - 1}, value_(config.value_size, 'x'),
+        connections_(file_descriptors.size()) {
+        epoll_file_descriptor_ = epoll_create1(0);
+        if (epoll_file_descriptor_ < 0) {
+            throw SocketException("Epoll creation failed");
+        }
+
+        for (std::size_t idx{0}; idx < connections_.size(); ++idx) {
+            auto &connection = connections_[idx];
+            connection.file_descriptor = file_descriptors[idx];
+
+            epoll_event event{EPOLLIN, {&connection}};
+            if (epoll_ctl(epoll_file_descriptor_, EPOLL_CTL_ADD, connection.file_descriptor, &event) != 0) {
+                throw SocketException("Failed to add to epoll list");
+            }
+        }
+    }
+
+    ~Worker() {
+        for (const auto &connection : connections_) {
+            close(connection.file_descriptor);
+        }
+        close(epoll_file_descriptor_);
+    }
+
+    WorkerResult run() {
+        std::size_t number_of_requests_in_flight{0};
+        for (auto &connection : connections_) {
+            while (connection.send_times.size() < config_.pipeline_depth && budget_.take()) {
+                issue_request(connection);
+                ++number_of_requests_in_flight;
+            }
+            flush(connection);
+        }
+
+        std::array<epoll_event, 256> events;
+        while (number_of_requests_in_flight != 0) {
+            const auto number_of_events = epoll_wait(epoll_file_descriptor_, events.data(), events.size(), 1000);
+            if (number_of_events < 0 && errno != EINTR) {
+                throw SocketException("Epoll wait failed");
+            }
+
+            for (int event_number{0}; event_number < number_of_events; ++event_number) {
+                auto &connection = *reinterpret_cast<Connection *>(events[event_number].data.ptr);
+                if (events[event_number].events & EPOLLOUT) {
+                    flush(connection);
+                }
+                if (events[event_number].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    number_of_requests_in_flight -= handle_replies(connection, number_of_requests_in_flight);
+                }
+            }
+        }
+
+        return std::move(result_);
+    }
+
+  private:
+    void issue_request(Connection &connection) {
+        const auto command = static_cast<Command>(command_distribution_(random_engine_));
+        append_request(connection.output, command, key_distribution_(random_engine_), value_);
+        connection.send_times.push_back(Clock::now());
+    }
+
+    /**
+     * @brief Read the replies which arrived and send a new request for each of them while the budget lasts.
+     *
+     * @return Number of requests which got their reply without being replaced.
+     */
+    std::size_t handle_replies(Connection &connection, std::size_t number_of_requests_in_flight) {
+        std::array<char, 64 * 1024> buffer;
+        for (;;) {
+            const auto bytes_received = recv(connection.file_descriptor, buffer.data(), buffer.size(), 0);
+            if (bytes_received > 0) {
+                connection.input.append(buffer.data(), bytes_received);
+                continue;
+            }
+            if (bytes_received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            if (bytes_received < 0 && errno == EINTR) {
+                continue;
+            }
+
+            throw SocketException("The server closed a connection with " + std::to_string(number_of_requests_in_flight) +
+                                  " requests in flight");
+        }
+
+        // The replies of one read arrived at the same time.
+        const auto now = Clock::now();
+        std::size_t number_of_finished_requests{0};
+        std::size_t offset{0};
+        while (offset < connection.input.size()) {
+            const auto reply = std::string_view{connection.input}.substr(offset);
+            const auto reply_size = get_reply_size(reply);
+            if (!reply_size.has_value()) {
+                break;
+            }
+
+            if (connection.send_times.empty()) {
+                throw std::runtime_error("Got a reply without a request");
+            }
+            const auto latency = now - connection.send_times.front();
+            connection.send_times.pop_front();
+            result_.latencies.record(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+            if (reply.front() == '-') {
+                ++result_.number_of_errors;
+            }
+            offset += *reply_size;
+
+            if (budget_.take()) {
+                issue_request(connection);
+            } else {
+                ++number_of_finished_requests;
+            }
+        }
+
+        connection.input.erase(0, offset);
+        flush(connection);
+        return number_of_finished_requests;
+    }
+
+    void flush(Connection &connection) {
+        while (connection.output_offset < connection.output.size()) {
+            const auto bytes_sent = send(connection.file_descriptor,
+                                         connection.output.data() + connection.output_offset,
+                                         connection.output.size() - connection.output_offset,
+                                         MSG_NOSIGNAL);
+            if (bytes_sent > 0) {
+                connection.output_offset += bytes_sent;
+                continue;
+            }
+            if (bytes_sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytes_sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                set_waiting_for_write(connection, true);
+                return;
+            }
+
+            throw SocketException("Sending a request failed");
+        }
+
+        connection.output.clear();
+        connection.output_offset = 0;
+        set_waiting_for_write(connection, false);
+    }
+
+    void set_waiting_for_write(Connection &connection, bool is_waiting_for_write) {
+        if (connection.is_waiting_for_write == is_waiting_for_write) {
+            return;
+        }
+
+        epoll_event event{EPOLLIN | (is_waiting_for_write ? EPOLLOUT : 0u), {&connection}};
+        if (epoll_ctl(epoll_file_descriptor_, EPOLL_CTL_MOD, connection.file_descriptor, &event) != 0) {
+            throw SocketException("Failed to modify epoll list");
+        }
+        connection.is_waiting_for_write = is_waiting_for_write;
+    }
+
+    const BenchConfig &config_;
+    RequestBudget &budget_;
+    std::mt19937_64 random_engine_;
+    std::discrete_distribution<int> command_distribution_;
+    std::uniform_int_distribution<std::size_t> key_distribution_;
+    std::string value_;
+    // Not resized after the construction, epoll refers to the connections by their address.
+    std::vector<Connection> connections_;
+    int epoll_file_descriptor_{-1};
+    WorkerResult result_;
+};
+
+void print_report(const BenchConfig &config, const WorkerResult &result, Clock::duration elapsed) {
+    const auto elapsed_seconds = std::chrono::duration<double>(elapsed).count();
+    const auto number_of_replies = result.latencies.get_count();
+    const auto to_us = [](double nanoseconds) {
+        return nanoseconds / 1000.0;
+    };
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "connections: " << config.number_of_connections << ", threads: " << config.number_of_threads
+              << ", pipeline: " << config.pipeline_depth << ", key space: " << config.key_space
+              << ", value size: " << config.value_size << " bytes, mix " << COMMAND_NAMES[0] << ":" << COMMAND_NAMES[1]
+              << ":" << COMMAND_NAMES[2] << " " << config.command_mix[0] << ":" << config.command_mix[1] << ":"
+              << config.command_mix[2] << '\n';
+    std::cout << "requests: " << number_of_replies << " in " << elapsed_seconds << " s, errors: "
+              << result.number_of_errors << '\n';
+    std::cout << "throughput: " << static_cast<double>(number_of_replies) / elapsed_seconds << " requests/s\n";
+    std::cout << "latency (us): min=" << to_us(result.latencies.get_min())
+              << " mean=" << to_us(result.latencies.get_mean())
+              << " p50=" << to_us(result.latencies.get_percentile(50))
+              << " p99=" << to_us(result.latencies.get_percentile(99))
+              << " p999=" << to_us(result.latencies.get_percentile(99.9))
+              << " max=" << to_us(result.latencies.get_max()) << std::endl;
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+    try {
+        const auto config = parse_command_line(argc, argv);
+
+        // The connections are spread over the threads and all opened before the first request is sent.
+        std::vector<std::vector<int>> file_descriptors_per_thread(config.number_of_threads);
+        for (std::size_t idx{0}; idx < config.number_of_connections; ++idx) {
+            file_descriptors_per_thread[idx % config.number_of_threads].push_back(connect_to_server(config));
+        }
+
+        RequestBudget budget{config};
+        std::vector<WorkerResult> results(config.number_of_threads);
+        std::vector<std::exception_ptr> errors(config.number_of_threads);
+
+        const auto start = Clock::now();
+        {
+            std::vector<std::jthread> threads;
+            for (std::size_t idx{0}; idx < config.number_of_threads; ++idx) {
+                threads.emplace_back([&, idx]() {
+                    try {
+                        Worker worker{config, budget, file_descriptors_per_thread[idx], idx + 1};
+                        results[idx] = worker.run();
+                    } catch (...) {
+                        errors[idx] = std::current_exception();
+                    }
+                });
+            }
+        }
+        const auto elapsed = Clock::now() - start;
+
+        for (const auto &error : errors) {
+            if (error != nullptr) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        WorkerResult total;
+        for (const auto &result : results) {
+            total.latencies.merge(result.latencies);
+            total.number_of_errors += result.number_of_errors;
+        }
+        print_report(config, total, elapsed);
+    } catch (const std::exception &exception) {
+        std::cerr << exception.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
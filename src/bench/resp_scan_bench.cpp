@@ -0,0 +1,135 @@
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+#include "resp_scan.hpp"
+#include "resp_tokenizer.hpp"
+
+namespace {
+std::vector<SIMDLevel> get_simd_levels() {
+    std::vector<SIMDLevel> simd_levels{SIMDLevel::scalar};
+    if (get_supported_simd_level() != SIMDLevel::scalar) {
+        simd_levels.push_back(SIMDLevel::sse2);
+    }
+    if (get_supported_simd_level() == SIMDLevel::avx2) {
+        simd_levels.push_back(SIMDLevel::avx2);
+    }
+
+    return simd_levels;
+}
+
+/**
+ * @brief Pipeline of small GET and SET commands, as sent by a benchmark client.
+ *
+ */
+std::string create_pipeline(std::size_t number_of_commands) {
+    std::string pipeline;
+    for (std::size_t idx{0}; idx < number_of_commands; ++idx) {
+        const auto key = "key:" + std::to_string(100000 + idx);
+        if (idx % 2 == 0) {
+            pipeline += "*3\r\n$3\r\nSET\r\n$10\r\n" + key + "\r\n$16\r\nvalue_0123456789\r\n";
+        } else {
+            pipeline += "*2\r\n$3\r\nGET\r\n$10\r\n" + key + "\r\n";
+        }
+    }
+
+    return pipeline;
+}
+
+/**
+ * @brief Walk the headers of the commands and skip the bulk string payloads, like the tokenizer does.
+ *
+ * @return Sum of the lengths in the headers.
+ */
+template<typename FindCRLF, typename ParseLength>
+std::size_t walk_headers(std::string_view input, FindCRLF &&find_crlf, ParseLength &&parse_length) {
+    std::size_t sum_of_lengths{0};
+    std::size_t position{0};
+    while (position < input.size()) {
+        const auto prefix = input[position++];
+        const auto line_end = find_crlf(input, position);
+        const auto length = parse_length(input.substr(position, line_end - position));
+        position = line_end + 2;
+        if (prefix == '$') {
+            position += length + 2;
+        }
+        sum_of_lengths += length;
+    }
+
+    return sum_of_lengths;
+}
+} // namespace
+
+// Walk the headers of a pipeline of small GET and SET commands with the scalar path the tokenizer used before
+// (std::string_view::find and std::from_chars) and with the vectorized one.
+int main() {
+    constexpr std::size_t NUMBER_OF_COMMANDS = 1000;
+    constexpr std::size_t NUMBER_OF_ROUNDS = 500;
+    const auto pipeline = create_pipeline(NUMBER_OF_COMMANDS);
+
+    const auto measure = [&](const std::string &name, auto &&walk) {
+        std::size_t sum_of_lengths{0};
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t round{0}; round < NUMBER_OF_ROUNDS; ++round) {
+            sum_of_lengths += walk(pipeline);
+        }
+        const auto duration = std::chrono::steady_clock::now() - start;
+        const auto duration_ns = std::chrono::duration<double, std::nano>(duration).count();
+        std::cout << name << ": " << duration_ns / (NUMBER_OF_ROUNDS * NUMBER_OF_COMMANDS) << " ns per command"
+                  << std::endl;
+        return sum_of_lengths;
+    };
+
+    const auto scalar_find_crlf = [](std::string_view input, std::size_t from) {
+        return input.find("\r\n", from);
+    };
+    const auto scalar_parse_length = [](std::string_view digits) {
+        return get_int_from_string_view(digits);
+    };
+    const auto swar_parse_length = [](std::string_view digits) {
+        // The digits of the pipeline are always followed by their CRLF and more.
+        int length{0};
+        parse_length(digits, digits.size() + 2, length);
+        return length;
+    };
+
+    const auto expected_sum_of_lengths = measure("scalar", [&](std::string_view input) {
+        return walk_headers(input, scalar_find_crlf, scalar_parse_length);
+    });
+    const auto check = [expected_sum_of_lengths](std::size_t sum_of_lengths) {
+        if (sum_of_lengths != expected_sum_of_lengths) {
+            std::cout << "The lengths differ from the scalar path: " << sum_of_lengths << std::endl;
+        }
+    };
+
+    for (const auto simd_level : get_simd_levels()) {
+        const auto simd_find_crlf = get_find_crlf(simd_level);
+        check(measure(std::string{to_string(simd_level)} + " find, SWAR length", [&](std::string_view input) {
+            return walk_headers(input, simd_find_crlf, swar_parse_length);
+        }));
+    }
+
+    const auto inline_find_crlf = [](std::string_view input, std::size_t from) {
+        return find_crlf(input, from);
+    };
+    check(measure(std::string{"find_crlf ("} + to_string(get_supported_simd_level()) + "), SWAR length",
+                  [&](std::string_view input) {
+                      return walk_headers(input, inline_find_crlf, swar_parse_length);
+                  }));
+
+    RESPTokenizer tokenizer{};
+    const auto tokenizer_name = std::string{"tokenizer ("} + to_string(get_supported_simd_level()) + ")";
+    measure(tokenizer_name, [&tokenizer](std::string_view input) {
+        while (!input.empty()) {
+            tokenizer.generate_command_tokens(input);
+            input.remove_prefix(tokenizer.get_number_of_bytes_consumed());
+        }
+        return std::size_t{0};
+    });
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc_queue.hpp"
+
+namespace {
+/**
+ * @brief The queue before its indices were put on cache lines of their own and cached by the other side. Only kept as
+ * the baseline of the benchmark.
+ *
+ */
+template<typename T>
+class UnpaddedSPSCQueue {
+  public:
+    explicit UnpaddedSPSCQueue(std::size_t capacity) : capacity_{capacity}, store_(capacity * sizeof(T)) {
+    }
+
+    bool push(T object) {
+        const auto current_tail = tail_.load(std::memory_order_relaxed);
+        const auto next_tail = (current_tail + 1) & (capacity_ - 1);
+        if (next_tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        new (store_.data() + current_tail * sizeof(T)) T(std::move(object));
+        tail_.store(next_tail, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item) {
+        const auto current_head = head_.load(std::memory_order_relaxed);
+        if (current_head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        auto top_ptr = reinterpret_cast<T *>(store_.data() + current_head * sizeof(T));
+        item = std::move(*top_ptr);
+        head_.store((current_head + 1) & (capacity_ - 1), std::memory_order_release);
+        return true;
+    }
+
+  private:
+    std::atomic<std::size_t> head_{0};
+    std::atomic<std::size_t> tail_{0};
+    std::size_t capacity_{0};
+    std::vector<std::byte> store_;
+};
+
+/**
+ * @brief Pass the numbers 0 to number_of_items - 1 from a producer to a consumer thread.
+ *
+ * @return Sum of the numbers the consumer popped.
+ */
+template<typename Push, typename Pop>
+std::size_t transfer(std::size_t number_of_items, Push &&push, Pop &&pop) {
+    std::size_t sum{0};
+    auto consumer = std::jthread([&]() {
+        std::size_t number_of_popped_items{0};
+        while (number_of_popped_items < number_of_items) {
+            if (const auto number_of_popped = pop(sum); number_of_popped != 0) {
+                number_of_popped_items += number_of_popped;
+            } else {
+                // The producer may need the core.
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (std::size_t number{0}; number < number_of_items;) {
+        if (const auto number_of_pushed = push(number); number_of_pushed != 0) {
+            number += number_of_pushed;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    return sum;
+}
+} // namespace
+
+// Throughput of numbers passed between two threads, through the queue before the indices were padded and cached,
+// through the current one with single items and through the current one in batches.
+int main() {
+    constexpr std::size_t NUMBER_OF_ITEMS = 10000000;
+    constexpr std::size_t QUEUE_SIZE = 1024;
+    constexpr std::size_t BATCH_SIZE = 64;
+    const auto expected_sum = NUMBER_OF_ITEMS * (NUMBER_OF_ITEMS - 1) / 2;
+
+    const auto measure = [&](const std::string &name, auto &&push, auto &&pop) {
+        const auto start = std::chrono::steady_clock::now();
+        if (transfer(NUMBER_OF_ITEMS, push, pop) != expected_sum) {
+            std::cout << name << ": the consumer lost items" << std::endl;
+        }
+        const auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << ": " << NUMBER_OF_ITEMS / duration / 1e6 << " million items per second" << std::endl;
+    };
+
+    UnpaddedSPSCQueue<std::size_t> unpadded_queue(QUEUE_SIZE);
+    measure(
+      "unpadded",
+      [&](std::size_t number) {
+          return static_cast<std::size_t>(unpadded_queue.push(number));
+      },
+      [&](std::size_t &sum) {
+          std::size_t item{0};
+          const auto is_popped = unpadded_queue.pop(item);
+          sum += is_popped ? item : 0;
+          return static_cast<std::size_t>(is_popped);
+      });
+
+    SPSCQueue<std::size_t> queue(QUEUE_SIZE);
+    measure(
+      "padded and cached",
+      [&](std::size_t number) {
+          return static_cast<std::size_t>(queue.push(number));
+      },
+      [&](std::size_t &sum) {
+          std::size_t item{0};
+          const auto is_popped = queue.pop(item);
+          sum += is_popped ? item : 0;
+          return static_cast<std::size_t>(is_popped);
+      });
+
+    std::array<std::size_t, BATCH_SIZE> batch;
+    measure(
+      "padded and cached, batches of " + std::to_string(BATCH_SIZE),
+      [&](std::size_t first_number) {
+          const auto batch_size = std::min(BATCH_SIZE, NUMBER_OF_ITEMS - first_number);
+          for (std::size_t idx{0}; idx < batch_size; ++idx) {
+              batch[idx] = first_number + idx;
+          }
+          return queue.push_bulk(std::span{batch}.first(batch_size));
+      },
+      [&](std::size_t &sum) {
+          std::array<std::size_t, BATCH_SIZE> items;
+          const auto number_of_items = queue.pop_bulk(items);
+          for (std::size_t idx{0}; idx < number_of_items; ++idx) {
+              sum += items[idx];
+          }
+          return number_of_items;
+      });
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <stop_token>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "tcp_server.hpp"
+
+namespace {
+using namespace std::chrono_literals;
+constexpr int LISTENING_PORT = 6399;
+constexpr auto UNIX_SOCKET_PATH = "/tmp/tcp_server_bench.sock";
+constexpr std::size_t NUMBER_OF_CLIENTS = 1000;
+constexpr std::size_t NUMBER_OF_ROUND_TRIPS = 20000;
+constexpr auto POLL_TIMEOUT = 10s;
+
+std::vector<int> connect_clients(std::size_t number_of_clients, int port) {
+    TCPSocketConfig client_tcp_socket_config;
+    client_tcp_socket_config.ip = '0';
+    client_tcp_socket_config.is_listening = false;
+    client_tcp_socket_config.is_blocking = true;
+    client_tcp_socket_config.needs_so_timestamp = false;
+    client_tcp_socket_config.port = port;
+
+    std::vector<int> client_file_descriptors;
+    for (std::size_t idx{0}; idx < number_of_clients; ++idx) {
+        client_file_descriptors.push_back(create_socket(client_tcp_socket_config));
+    }
+
+    return client_file_descriptors;
+}
+
+int connect_unix_client(const std::string &path) {
+    TCPSocketConfig client_socket_config;
+    client_socket_config.is_blocking = true;
+    client_socket_config.unix_socket_path = path;
+    return create_socket(client_socket_config);
+}
+
+// Send a small request and wait for its reply, the given number of times. Returns the mean time of a round trip.
+std::chrono::nanoseconds measure_round_trips(int client, std::size_t number_of_round_trips) {
+    const std::string request = "*1\r\n$4\r\nPING\r\n";
+    std::string reply(request.size(), '\0');
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t idx{0}; idx < number_of_round_trips; ++idx) {
+        send(client, request.data(), request.size(), 0);
+        std::size_t bytes_received{0};
+        while (bytes_received < reply.size()) {
+            const auto result = recv(client, reply.data() + bytes_received, reply.size() - bytes_received, 0);
+            if (result <= 0) {
+                return std::chrono::nanoseconds::max();
+            }
+            bytes_received += result;
+        }
+    }
+
+    return (std::chrono::steady_clock::now() - start) / number_of_round_trips;
+}
+
+// Resident set size of the process in bytes.
+std::size_t get_resident_memory() {
+    std::size_t total_pages{0};
+    std::size_t resident_pages{0};
+    std::ifstream{"/proc/self/statm"} >> total_pages >> resident_pages;
+    return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
+template<typename Predicate>
+void poll_until(TCPServer &server, Predicate predicate) {
+    const auto start = std::chrono::steady_clock::now();
+    while (!predicate() && (std::chrono::steady_clock::now() - start < POLL_TIMEOUT)) {
+        server.poll();
+    }
+}
+
+/**
+ * @brief A large number of clients connect at the same time. Measures how long it takes until all of them are
+ * accepted and how much memory the idle connections hold.
+ *
+ */
+void run_accept_storm() {
+    TCPServer server{LISTENING_PORT};
+    const auto resident_memory_before = get_resident_memory();
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto clients = connect_clients(NUMBER_OF_CLIENTS, LISTENING_PORT);
+    poll_until(server, [&server]() { return server.get_number_of_connections() == NUMBER_OF_CLIENTS; });
+    const auto duration = std::chrono::steady_clock::now() - start;
+
+    const auto resident_memory_per_connection = (get_resident_memory() - resident_memory_before) / NUMBER_OF_CLIENTS;
+    std::cout << "Accept storm: " << server.get_number_of_connections() << " connections in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(duration).count() << " us, "
+              << resident_memory_per_connection << " resident bytes per connection, "
+              << server.get_buffer_pool_stats().bytes_in_use << " buffer bytes in use" << std::endl;
+
+    std::for_each(clients.begin(), clients.end(), [](auto client) { close(client); });
+}
+
+/**
+ * @brief Round trips of a small request over loopback TCP and over a Unix domain socket of the same echo server. The
+ * Unix domain socket skips the TCP/IP stack.
+ *
+ */
+void run_unix_socket_vs_loopback() {
+    auto config = TCPServerConfig{LISTENING_PORT};
+    config.unix_socket_path = UNIX_SOCKET_PATH;
+    TCPServer server{config};
+    server.receive_callback = [&server](auto tcp_socket) {
+        const auto message = std::string(tcp_socket->receive_buffer.data(), tcp_socket->next_valid_receive_index);
+        tcp_socket->next_valid_receive_index = 0;
+        server.enqueue_to_send_buffer(tcp_socket->file_descriptor, message);
+    };
+
+    auto server_thread = std::jthread([&server](std::stop_token stop_token) {
+        while (!stop_token.stop_requested()) {
+            server.poll(10);
+        }
+    });
+
+    const auto tcp_client = connect_clients(1, LISTENING_PORT).front();
+    const auto unix_client = connect_unix_client(UNIX_SOCKET_PATH);
+
+    const auto tcp_round_trip = measure_round_trips(tcp_client, NUMBER_OF_ROUND_TRIPS);
+    const auto unix_round_trip = measure_round_trips(unix_client, NUMBER_OF_ROUND_TRIPS);
+    std::cout << "Mean round trip over " << NUMBER_OF_ROUND_TRIPS << " requests: loopback TCP "
+              << tcp_round_trip.count() << " ns, Unix domain socket " << unix_round_trip.count() << " ns" << std::endl;
+
+    close(tcp_client);
+    close(unix_client);
+}
+} // namespace
+
+int main() {
+    run_accept_storm();
+    run_unix_socket_vs_loopback();
+    return 0;
+}
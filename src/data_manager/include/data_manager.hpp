@@ -1,40 +1,94 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
+#include <memory>
+#include <functional>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "flat_hash_map.hpp"
+
 using namespace std::chrono_literals;
+
+template<typename Key>
+struct KeyHash : std::hash<Key> {};
+
+/**
+ * @brief String keys are hashed as a std::string_view, so a key received with a command is looked up without being
+ * copied into a std::string first.
+ *
+ */
+template<>
+struct KeyHash<std::string> {
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view key) const noexcept {
+        return std::hash<std::string_view>{}(key);
+    }
+};
+
+/**
+ * @brief Shard which owns a key when the keyspace is split between several data managers.
+ *
+ * The hash is mixed and the shard is taken from its high bits, the keys of a shard still spread over all the groups
+ * of its table.
+ */
+inline std::size_t get_key_shard(std::string_view key, std::size_t number_of_shards) {
+    const auto hash = static_cast<std::uint64_t>(KeyHash<std::string>{}(key)) * 0x9E3779B97F4A7C15;
+    return static_cast<std::size_t>(((hash >> 32) * number_of_shards) >> 32);
+}
+
 template<typename Key, typename Value>
 class DataManager {
     static inline constexpr auto MAX_DURATION = std::chrono::milliseconds::max();
 
+    // Values are shared so that a reader (e.g. a zero copy send) can keep one alive after it is removed.
     struct ValueWithExpiry {
-        Value value;
+        std::shared_ptr<const Value> value;
         std::chrono::steady_clock::time_point time_added{std::chrono::steady_clock::now()};
         std::chrono::milliseconds duration{MAX_DURATION};
     };
 
   public:
+    using ValueReleaser = std::function<void(std::shared_ptr<const Value>)>;
+
+    /**
+     * @brief Hand removed values of at least the given size to the releaser instead of freeing them in place, e.g. to
+     * free them on a background thread. Only values without other references are handed over.
+     *
+     */
+    void set_value_releaser(std::size_t min_size, ValueReleaser releaser) {
+        min_released_value_size_ = min_size;
+        value_releaser_ = std::move(releaser);
+    }
+
     /**
      * @brief Sets a key-value pair with an optional expiry duration.
      *
-     * @param key The key to set.
+     * @param key The key to set, or anything its hash accepts, e.g. a std::string_view for a std::string key.
      * @param value The value to associate with the key.
      * @param duration Optional duration after which the key will expire. Default is 0 (no expiry).
      * @return true if the key was set successfully, false if the key already exists.
      */
-    bool set(Key key, Value value, std::chrono::milliseconds duration = MAX_DURATION) {
-        ValueWithExpiry new_value;
-        new_value.value = std::move(value);
+    template<typename SetKey>
+    bool set(SetKey &&key, Value value, std::chrono::milliseconds duration = MAX_DURATION) {
+        // The key is only constructed when it does not exist yet.
+        const auto [it, is_inserted] = data_store_.try_emplace(std::forward<SetKey>(key));
+        if (!is_inserted) {
+            return false;
+        }
+
+        auto &new_value = it->second;
+        new_value.value = std::make_shared<const Value>(std::move(value));
 
         if (duration != MAX_DURATION) {
             new_value.duration = duration;
         }
 
-        const auto result = data_store_.emplace(std::move(key), std::move(new_value));
-        return result.second;
+        return true;
     }
 
     /**
@@ -45,9 +99,26 @@ class DataManager {
      * default-constructed Value if the key does not exist or has expired.
      */
     std::pair<bool, Value> get(const Key &key) {
+        const auto value = get_shared(key);
+        if (value == nullptr) {
+            return {false, Value()};
+        }
+
+        return {true, *value};
+    }
+
+    /**
+     * @brief Gets the value associated with a given key without copying it.
+     *
+     * @param key The key to look up, or anything its hash accepts, e.g. a std::string_view for a std::string key.
+     * @return The value, which stays valid as long as it is referenced, or nullptr if the key does not exist or has
+     * expired.
+     */
+    template<typename LookupKey>
+    std::shared_ptr<const Value> get_shared(const LookupKey &key) {
         const auto it = data_store_.find(key);
         if (it == data_store_.end()) {
-            return {false, Value()};
+            return nullptr;
         }
 
         const auto &value_with_expiry = it->second;
@@ -59,16 +130,17 @@ class DataManager {
 
             if (time_diff >= value_with_expiry.duration) {
                 // Key has expired, remove it
+                release(std::move(it->second.value));
                 data_store_.erase(it);
-                return {false, Value()};
+                return nullptr;
             }
         }
 
-        return {true, it->second.value};
+        return it->second.value;
     }
 
-    std::vector<Value> get_keys() {
-        std::vector<Value> result;
+    std::vector<Key> get_keys() {
+        std::vector<Key> result;
         result.reserve(data_store_.size());
         for (const auto &key_value : data_store_) {
             result.push_back(key_value.first);
@@ -78,5 +150,16 @@ class DataManager {
     }
 
   private:
-    std::unordered_map<Key, ValueWithExpiry> data_store_;
+    void release(std::shared_ptr<const Value> value) {
+        if constexpr (requires { value->size(); }) {
+            // A value which is still referenced, e.g. by a zero copy send, is freed by its last reader.
+            if (value_releaser_ && value.use_count() == 1 && value->size() >= min_released_value_size_) {
+                value_releaser_(std::move(value));
+            }
+        }
+    }
+
+    std::size_t min_released_value_size_{0};
+    ValueReleaser value_releaser_;
+    FlatHashMap<Key, ValueWithExpiry, KeyHash<Key>, std::equal_to<>> data_store_;
 };
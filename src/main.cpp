@@ -1,6 +1,8 @@
+#include <chrono>
 #include <filesystem>
 #include <getopt.h>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 #include "redis.hpp"
@@ -13,9 +15,66 @@ void printUsage(const char *progName) {
     std::cout << "  --dbfilename FILE   Database filename (default: dump.rdb)\n";
     std::cout << "  --port PORT_NUMBER  Port on which Redis listens (default: 6379)\n";
     std::cout << "  --replicaof         start redis as salve (default: master)\n";
+    std::cout << "  --reactors N        Number of network threads (default: 1)\n";
+    std::cout << "  --io-backend NAME   epoll or io_uring (default: epoll)\n";
+    std::cout << "  --idle-policy NAME  busy-poll or spin-then-park (default: spin-then-park)\n";
+    std::cout << "  --idle-spin-us N    Time to spin before parking an idle thread (default: 100)\n";
+    std::cout << "  --zero-copy-threshold BYTES\n";
+    std::cout << "                      Send values of at least this size without a copy, 0 disables (default: 65536)\n";
+    std::cout << "  --client-output-buffer-limit \"CLASS HARD SOFT SECONDS\"\n";
+    std::cout << "                      Output buffer limit of normal or replica clients in bytes, 0 disables a limit\n";
+    std::cout << "                      (default: \"normal 0 0 0\" and \"replica 268435456 67108864 60\")\n";
+    std::cout << "  --unixsocket PATH   Also listen on a Unix domain socket for local clients (default: off)\n";
+    std::cout << "  --timeout SECONDS   Close the connection of a client after it is idle this long, 0 disables\n";
+    std::cout << "                      (default: 0)\n";
+    std::cout << "  --proto-max-bulk-len BYTES\n";
+    std::cout << "                      Reject requests with a longer bulk string (default: 536870912)\n";
+    std::cout << "  --shards N          Threads which execute the commands, the keyspace is split between them\n";
+    std::cout << "                      (default: 1)\n";
+    std::cout << "  --queue-size N      Entries of each queue between a network thread and a shard, a power of two\n";
+    std::cout << "                      (default: 1024)\n";
+    std::cout << "  --run-to-completion Execute the commands on the network thread, ignores --reactors and --shards\n";
+    std::cout << "  --reactor-cpus LIST Pin the network threads to these CPUs in turn, e.g. 0-3,8 (default: any CPU)\n";
+    std::cout << "  --shard-cpus LIST   Pin the shard threads to these CPUs in turn, their keys are allocated on the\n";
+    std::cout << "                      NUMA node of the CPU (default: any CPU)\n";
+    std::cout << "  --background-cpus LIST\n";
+    std::cout << "                      Pin the background workers to these CPUs in turn (default: any CPU)\n";
+    std::cout << "  --lazy-free-threshold BYTES\n";
+    std::cout << "                      Free expired values of at least this size in the background\n";
+    std::cout << "                      (default: 1048576)\n";
     std::cout << "  --help, -h          Show this help message\n";
 }
 
+/**
+ * @brief Parse "<class> <hard bytes> <soft bytes> <soft seconds>" into the limit of the class.
+ *
+ * @return false when the limit is malformed.
+ */
+bool parse_output_buffer_limit(const std::string &argument,
+                               std::array<OutputBufferLimit, NUMBER_OF_CLIENT_CLASSES> &limits) {
+    std::istringstream stream{argument};
+    std::string client_class;
+    std::size_t hard_limit_bytes;
+    std::size_t soft_limit_bytes;
+    long long soft_limit_seconds;
+    if (!(stream >> client_class >> hard_limit_bytes >> soft_limit_bytes >> soft_limit_seconds)) {
+        return false;
+    }
+
+    ClientClass parsed_class;
+    if (client_class == "normal") {
+        parsed_class = ClientClass::normal;
+    } else if (client_class == "replica" || client_class == "slave") {
+        parsed_class = ClientClass::replica;
+    } else {
+        return false;
+    }
+
+    limits[static_cast<std::size_t>(parsed_class)] =
+      OutputBufferLimit{hard_limit_bytes, soft_limit_bytes, std::chrono::seconds{soft_limit_seconds}};
+    return true;
+}
+
 RedisConfig parseCommandLine(int argc, char *argv[]) {
     RedisConfig config;
 
@@ -23,13 +82,30 @@ RedisConfig parseCommandLine(int argc, char *argv[]) {
                                            {"dbfilename", required_argument, nullptr, 'f'},
                                            {"port", required_argument, nullptr, 'p'},
                                            {"replicaof", required_argument, nullptr, 'r'},
-                                           {"help", required_argument, nullptr, 'h'},
+                                           {"reactors", required_argument, nullptr, 'n'},
+                                           {"io-backend", required_argument, nullptr, 'b'},
+                                           {"idle-policy", required_argument, nullptr, 'i'},
+                                           {"idle-spin-us", required_argument, nullptr, 's'},
+                                           {"zero-copy-threshold", required_argument, nullptr, 'z'},
+                                           {"client-output-buffer-limit", required_argument, nullptr, 'o'},
+                                           {"unixsocket", required_argument, nullptr, 'u'},
+                                           {"timeout", required_argument, nullptr, 't'},
+                                           {"proto-max-bulk-len", required_argument, nullptr, 'l'},
+                                           {"shards", required_argument, nullptr, 'k'},
+                                           {"queue-size", required_argument, nullptr, 'q'},
+                                           {"run-to-completion", no_argument, nullptr, 'c'},
+                                           {"reactor-cpus", required_argument, nullptr, 'a'},
+                                           {"shard-cpus", required_argument, nullptr, 'e'},
+                                           {"background-cpus", required_argument, nullptr, 'w'},
+                                           {"lazy-free-threshold", required_argument, nullptr, 'y'},
+                                           {"help", no_argument, nullptr, 'h'},
                                            {0, 0, 0, 0}};
 
     int option_index = 0;
     int c;
 
-    while ((c = getopt_long(argc, argv, "d:f:p:r:h", long_options, &option_index)) != -1) {
+    const auto *short_options = "d:f:p:r:n:b:i:s:z:o:u:t:l:k:q:ca:e:w:y:h";
+    while ((c = getopt_long(argc, argv, short_options, long_options, &option_index)) != -1) {
         switch (c) {
         case 'd':
             config.rdb_config.dir = optarg;
@@ -43,6 +119,71 @@ RedisConfig parseCommandLine(int argc, char *argv[]) {
         case 'r':
             config.role = Role::slave;
             break;
+        case 'n':
+            config.number_of_reactors = std::stoul(optarg);
+            break;
+        case 'b':
+            if (std::string{optarg} == "io_uring") {
+                config.io_backend = IOBackend::io_uring;
+            } else if (std::string{optarg} == "epoll") {
+                config.io_backend = IOBackend::epoll;
+            } else {
+                printUsage(argv[0]);
+                exit(1);
+            }
+            break;
+        case 'i':
+            if (std::string{optarg} == "busy-poll") {
+                config.idle_config.policy = IdlePolicy::busy_poll;
+            } else if (std::string{optarg} == "spin-then-park") {
+                config.idle_config.policy = IdlePolicy::spin_then_park;
+            } else {
+                printUsage(argv[0]);
+                exit(1);
+            }
+            break;
+        case 's':
+            config.idle_config.spin_duration = std::chrono::microseconds{std::stoul(optarg)};
+            break;
+        case 'z':
+            config.zero_copy_threshold = std::stoul(optarg);
+            break;
+        case 'o':
+            if (!parse_output_buffer_limit(optarg, config.output_buffer_limits)) {
+                printUsage(argv[0]);
+                exit(1);
+            }
+            break;
+        case 'u':
+            config.unix_socket_path = optarg;
+            break;
+        case 't':
+            config.client_idle_timeout = std::chrono::seconds{std::stoul(optarg)};
+            break;
+        case 'l':
+            config.proto_max_bulk_len = std::stoull(optarg);
+            break;
+        case 'k':
+            config.number_of_shards = std::stoul(optarg);
+            break;
+        case 'q':
+            config.queue_size = std::stoul(optarg);
+            break;
+        case 'c':
+            config.run_to_completion = true;
+            break;
+        case 'a':
+            config.reactor_cpus = parse_cpu_list(optarg);
+            break;
+        case 'e':
+            config.shard_cpus = parse_cpu_list(optarg);
+            break;
+        case 'w':
+            config.background_cpus = parse_cpu_list(optarg);
+            break;
+        case 'y':
+            config.lazy_free_threshold = std::stoul(optarg);
+            break;
         case 'h':
             printUsage(argv[0]);
             exit(0);
@@ -1,41 +1,215 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
+#include "buffer_pool.hpp"
+#include "client_registry.hpp"
 #include "data_manager.hpp"
+#include "reply_builder.hpp"
 #include "resp_tokenizer.hpp"
 
 struct RequestMessage {
     int client_id;
-    std::string message;
+    // The commands, in the receive buffer of the connection. They are not copied, the handler hands the slice back
+    // with the last response and the network thread releases it.
+    BufferSlice message;
+    // Bookkeeping of the connection, the handler records the last command in it.
+    std::shared_ptr<ClientInfo> client{nullptr};
+    // Payloads of the large bulk strings of the commands, which were streamed out of the message by the RESPParser.
+    std::vector<std::string> streamed_values{};
+    // Position of the message among the messages of the client. Its commands are executed by one shard, the network
+    // thread restores the order of the replies of several shards with it.
+    std::uint64_t sequence{0};
+    // Memory of a sent response, the responses to the commands are serialized into it.
+    std::string response_buffer{};
 };
 
 struct ResponseMessage {
     int client_id;
     std::string message;
+    // Content of a large bulk string reply. It is not copied into the message, the message only holds the bulk
+    // string header and the value is sent afterwards, followed by the closing CRLF.
+    std::shared_ptr<const std::string> value{nullptr};
+    // Id of the ClientInfo of the connection. A later connection can get the same file descriptor, but not the same id.
+    std::uint64_t connection_id{0};
+    // Sequence of the request, see RequestMessage. The replies of a request can take several messages, the last one is
+    // marked.
+    std::uint64_t sequence{0};
+    bool is_last{true};
+    // The commands of the request, with the last response. See RequestMessage.
+    BufferSlice request{};
+};
+
+/**
+ * @brief What MessageHandler::generate_pipeline_response executed.
+ *
+ */
+struct PipelineResult {
+    std::size_t number_of_bytes{0};
+    std::size_t number_of_commands{0};
+};
+
+/**
+ * @brief Properties of a command, as reported by COMMAND INFO.
+ *
+ */
+enum class CommandFlag : std::uint32_t {
+    // Reads the keyspace.
+    read = 1 << 0,
+    // Changes the keyspace.
+    write = 1 << 1,
+    // Runs in constant time.
+    fast = 1 << 2,
+    // Inspects or manages the server.
+    admin = 1 << 3,
 };
 
+template<typename... Flags>
+constexpr std::uint32_t to_flags(Flags... flags) {
+    return (0u | ... | static_cast<std::uint32_t>(flags));
+}
+
 class Redis;
 
 class MessageHandler {
   public:
-    MessageHandler(const Redis &redis, DataManager<std::string, std::string> &data_manager);
-    const std::string &genera_response(std::string_view input);
+    using Handler = void (MessageHandler::*)(const std::vector<Token> &tokens);
+
+    /**
+     * @brief Entry of the command table.
+     *
+     */
+    struct Command {
+        // Upper case.
+        std::string_view name;
+        // Number of arguments including the name of the command. A negative arity is the minimum number.
+        int arity;
+        std::uint32_t flags;
+        // Positions of the keys within the arguments, 0 when the command has none. A negative last key counts from the
+        // end.
+        int first_key;
+        int last_key;
+        int key_step;
+        Handler handler;
+
+        bool has_flag(CommandFlag flag) const {
+            return (flags & static_cast<std::uint32_t>(flag)) != 0;
+        }
+
+        bool accepts_number_of_arguments(int number_of_arguments) const {
+            return arity >= 0 ? number_of_arguments == arity : number_of_arguments >= -arity;
+        }
+    };
+
+    static constexpr std::size_t NUMBER_OF_COMMANDS = 9;
+
+    // Every supported command, ordered by name.
+    static const std::array<Command, NUMBER_OF_COMMANDS> COMMANDS;
+
+    /**
+     * @brief Look up a command by its name in any case, with a perfect hash of the upper cased name.
+     *
+     * @return The command or nullptr when it is not supported.
+     */
+    static const Command *find_command(std::string_view name);
+
+    MessageHandler(Redis &redis, DataManager<std::string, std::string> &data_manager);
+
+    /**
+     * @brief Execute a command and generate its response.
+     *
+     * @param client Connection which sent the command, its last command is updated when given.
+     */
+    const std::string &genera_response(std::string_view input, ClientInfo *client = nullptr);
+
+    /**
+     * @brief Execute the commands of a pipeline in order and append their responses to one buffer, so they are sent
+     * with one write. The responses are serialized straight into the buffer, a buffer which is reused does not need
+     * to allocate.
+     *
+     * A response with a large value (see take_response_value) ends the batch, it has to be sent before the responses
+     * of the next commands. The rest of the input is executed by the next call.
+     *
+     * @return Bytes of the input and number of commands which were executed.
+     */
+    PipelineResult
+    generate_pipeline_response(std::string_view input, std::string &responses, ClientInfo *client = nullptr);
+
+    /**
+     * @brief Payloads of the streamed bulk strings of the commands executed next, see RequestMessage. A command which
+     * stores one moves it instead of copying it.
+     *
+     */
+    void set_streamed_values(std::span<std::string> streamed_values) {
+        streamed_values_ = streamed_values;
+        tokenizer_.set_streamed_values(streamed_values);
+    }
+
+    /**
+     * @brief Take the value of the last response when it is too large to be copied into it, see ResponseMessage.
+     *
+     * @return The value or nullptr when the response is complete.
+     */
+    std::shared_ptr<const std::string> take_response_value() {
+        return std::move(response_value_);
+    }
+
+    /**
+     * @brief Number of calls of a command by this handler. Can be read from any thread.
+     *
+     * @param command_index Index of the command in COMMANDS.
+     */
+    std::uint64_t get_number_of_calls(std::size_t command_index) const {
+        return number_of_calls_[command_index].load(std::memory_order_relaxed);
+    }
 
   private:
-    void verify_input(const std::vector<Token> &tokens);
-    void generate_ping_response();
-    void generate_error_response(const std::string &error_message);
+    /**
+     * @brief Execute one command and append its response with reply_.
+     *
+     */
+    void execute_command(std::string_view input, ClientInfo *client);
+    /**
+     * @return false when the tokens are not a command, an error response is generated then.
+     */
+    bool verify_input(const std::vector<Token> &tokens);
+    void generate_ping_response(const std::vector<Token> &tokens);
+    void generate_error_response(std::string_view error_message);
     void generate_echo_response(const std::vector<Token> &tokens);
     void generate_set_response(const std::vector<Token> &tokens);
     void generate_get_response(const std::vector<Token> &tokens);
     void generate_rdb_config_response(const std::vector<Token> &tokens);
     void generate_redis_info_response(const std::vector<Token> &tokens);
     void generate_keys_response(const std::vector<Token> &tokens);
+    void generate_client_response(const std::vector<Token> &tokens);
+    void generate_client_list_response();
+    void generate_client_kill_response(const std::vector<Token> &tokens);
+    void generate_command_response(const std::vector<Token> &tokens);
+    void add_command_info(const Command &command);
+
+    /**
+     * @brief Copy of a bulk string of the current command, or the streamed payload it views.
+     *
+     */
+    std::string take_value(std::string_view value);
 
+    // Number of calls of every command, in the order of COMMANDS.
+    std::array<std::atomic<std::uint64_t>, NUMBER_OF_COMMANDS> number_of_calls_{};
+    // Response of genera_response.
     std::string response_{""};
+    // Writes to the buffer of the current call.
+    ReplyBuilder reply_;
+    std::shared_ptr<const std::string> response_value_{nullptr};
+    std::span<std::string> streamed_values_{};
     RESPTokenizer tokenizer_;
-    const Redis &redis_;
+    Redis &redis_;
     DataManager<std::string, std::string> &data_manager_;
 };
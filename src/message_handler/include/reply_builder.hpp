@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Serializes RESP replies at the end of a buffer owned by the caller.
+ *
+ * Numbers are written with std::to_chars into a stack buffer and every reply is appended in place, so no temporary
+ * strings are created. A buffer which is cleared and reused keeps its capacity, once it has grown to the size of the
+ * replies of a batch, building them does not allocate.
+ */
+class ReplyBuilder {
+  public:
+    // Replies which do not depend on the command, they are copied as they are.
+    static constexpr std::string_view OK{"+OK\r\n"};
+    static constexpr std::string_view PONG{"+PONG\r\n"};
+    static constexpr std::string_view NULL_BULK{"$-1\r\n"};
+    static constexpr std::string_view NULL_ARRAY{"*-1\r\n"};
+    static constexpr std::string_view EMPTY_ARRAY{"*0\r\n"};
+
+    ReplyBuilder() = default;
+
+    explicit ReplyBuilder(std::string &output) : output_{&output} {
+    }
+
+    /**
+     * @brief Append the following replies to the given buffer.
+     *
+     */
+    void set_output(std::string &output) {
+        output_ = &output;
+    }
+
+    /**
+     * @brief Append a reply which is already encoded, e.g. OK.
+     *
+     */
+    void add_encoded(std::string_view reply) {
+        output_->append(reply);
+    }
+
+    /**
+     * @brief +<value>\r\n, the value must not contain a CR or LF.
+     *
+     */
+    void add_simple_string(std::string_view value) {
+        output_->push_back('+');
+        output_->append(value);
+        output_->append(CRLF);
+    }
+
+    /**
+     * @brief -ERR <message>\r\n
+     *
+     */
+    void add_error(std::string_view message) {
+        output_->append("-ERR ");
+        output_->append(message);
+        output_->append(CRLF);
+    }
+
+    /**
+     * @brief :<value>\r\n
+     *
+     */
+    void add_integer(long long value) {
+        add_header(':', value);
+    }
+
+    /**
+     * @brief $<size>\r\n<value>\r\n
+     *
+     */
+    void add_bulk(std::string_view value) {
+        add_bulk_header(value.size());
+        output_->append(value);
+        output_->append(CRLF);
+    }
+
+    /**
+     * @brief Only the $<size>\r\n of a bulk string, for a value which is sent separately together with its CRLF.
+     *
+     */
+    void add_bulk_header(std::size_t size) {
+        add_header('$', static_cast<long long>(size));
+    }
+
+    /**
+     * @brief *<number of elements>\r\n, the elements are added afterwards.
+     *
+     */
+    void add_array_header(std::size_t number_of_elements) {
+        add_header('*', static_cast<long long>(number_of_elements));
+    }
+
+  private:
+    static constexpr std::string_view CRLF{"\r\n"};
+
+    void add_header(char prefix, long long value) {
+        // Prefix, sign, 19 digits and the CRLF.
+        std::array<char, 23> header;
+        header[0] = prefix;
+        auto *end = std::to_chars(header.data() + 1, header.data() + header.size() - 2, value).ptr;
+        *end++ = '\r';
+        *end++ = '\n';
+        output_->append(header.data(), static_cast<std::size_t>(end - header.data()));
+    }
+
+    std::string *output_{nullptr};
+};
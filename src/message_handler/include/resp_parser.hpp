@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Incremental parser which finds the complete commands in the bytes received from a connection.
+ *
+ * It keeps the state of a partial command between reads, so the bytes of a command which arrives in pieces are
+ * looked at once. Bulk string payloads are skipped without being scanned.
+ *
+ * The caller passes all pending bytes of the connection, which start with the first byte not returned as part of a
+ * complete command yet. The bytes passed by an earlier call must not change.
+ *
+ * The payloads of large bulk strings are streamed: they are moved out of the input into a string of their own as they
+ * arrive, so the buffer of the connection does not need to hold them. The '$' of their header is replaced by
+ * STREAMED_BULK_STRING_PREFIX, the payload and its CRLF are not part of the returned commands.
+ */
+class RESPParser {
+  public:
+    static constexpr std::size_t DEFAULT_MAX_BULK_LENGTH = 512 * 1024 * 1024;
+    static constexpr std::size_t DEFAULT_STREAMED_BULK_LENGTH = 32 * 1024;
+    static constexpr char STREAMED_BULK_STRING_PREFIX = '&';
+
+    struct Result {
+        // Bytes at the start of the input which hold complete commands. The caller takes them out of its buffer before
+        // the next call.
+        std::size_t complete_size{0};
+        // Bytes which are left in the input, streamed payloads were taken out of it.
+        std::size_t size{0};
+    };
+
+    /**
+     * @param max_bulk_length Longer bulk strings are a protocol error, they are rejected as soon as their header
+     * arrives.
+     * @param streamed_bulk_length Bulk strings of at least this length are streamed, 0 disables it.
+     */
+    explicit RESPParser(std::size_t max_bulk_length = DEFAULT_MAX_BULK_LENGTH,
+                        std::size_t streamed_bulk_length = DEFAULT_STREAMED_BULK_LENGTH);
+
+    /**
+     * @brief Continue parsing with the bytes received since the last call.
+     *
+     * @param input All pending bytes. Streamed payloads are taken out of it, the bytes behind them move forward.
+     */
+    Result parse(std::span<char> input);
+
+    /**
+     * @brief Take the payloads of the streamed bulk strings of the complete commands returned so far, in the order of
+     * their headers.
+     *
+     */
+    std::vector<std::string> take_streamed_values();
+
+    /**
+     * @brief The input is not valid RESP. The bytes after the complete commands cannot be parsed anymore.
+     *
+     */
+    bool has_error() const {
+        return !error_.empty();
+    }
+
+    const std::string &get_error() const {
+        return error_;
+    }
+
+  private:
+    enum class State { array_header, bulk_string_header, bulk_string_payload, streamed_bulk_string_payload };
+
+    /**
+     * @return Value of the header at the parse position, or -1 while its CRLF has not arrived. The position is moved
+     * past the header.
+     */
+    long long parse_header(std::string_view input, char prefix, const char *length_name);
+
+    /**
+     * @brief Move the bytes of the streamed payload at the parse position out of the input.
+     *
+     * @return false when the payload is not complete yet.
+     */
+    bool stream_payload(std::span<char> &input);
+
+    /**
+     * @brief The current bulk string was read, continue with the next element or command.
+     *
+     */
+    void complete_element();
+    void set_error(std::string error);
+
+    std::size_t max_bulk_length_;
+    std::size_t streamed_bulk_length_;
+
+    State state_{State::array_header};
+    // Bytes of the input which were parsed.
+    std::size_t position_{0};
+    // End of the last complete command.
+    std::size_t complete_size_{0};
+    std::size_t number_of_pending_elements_{0};
+    // Bytes of the current payload including its CRLF which did not arrive yet.
+    std::size_t number_of_pending_payload_bytes_{0};
+    std::string error_{};
+
+    // Payloads of the streamed bulk strings, the first ones belong to complete commands.
+    std::vector<std::string> streamed_values_{};
+    std::size_t number_of_complete_streamed_values_{0};
+};
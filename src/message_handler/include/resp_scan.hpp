@@ -0,0 +1,108 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Instruction set used to search the CRLFs of RESP headers. The best one the CPU supports is picked once at
+ * startup, scalar is the portable fallback.
+ *
+ */
+enum class SIMDLevel { scalar, sse2, avx2 };
+
+SIMDLevel get_supported_simd_level();
+
+const char *to_string(SIMDLevel simd_level);
+
+/**
+ * @brief Search for a CRLF with the best instruction set of the CPU, see find_crlf().
+ *
+ */
+std::size_t search_crlf(std::string_view input, std::size_t from);
+
+/**
+ * @return Position of the first CRLF at or after from, std::string_view::npos when there is none.
+ */
+inline std::size_t find_crlf(std::string_view input, std::size_t from) {
+#ifdef __SSE2__
+    // The CRLF of a header is mostly within the next 16 bytes, they are checked inline. SSE2 is part of every x86-64
+    // CPU.
+    if (from + 16 <= input.size()) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input.data() + from));
+        const auto carriage_returns =
+          static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+        const auto line_feeds =
+          static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))));
+        if (const auto crlfs = carriage_returns & (line_feeds >> 1); crlfs != 0) {
+            return from + static_cast<std::size_t>(std::countr_zero(crlfs));
+        }
+
+        // A '\r' in the last byte can be followed by a '\n' after the block.
+        return search_crlf(input, from + 15);
+    }
+#endif
+    return search_crlf(input, from);
+}
+
+using FindCRLF = std::size_t (*)(std::string_view input, std::size_t from);
+
+/**
+ * @brief CRLF search with the given instruction set, which has to be supported by the CPU. Used by tests and
+ * benchmarks, find_crlf() uses the best one.
+ *
+ */
+FindCRLF get_find_crlf(SIMDLevel simd_level);
+
+/**
+ * @brief Parse the length of a "*<length>" or "$<length>" header.
+ *
+ * @return false when the digits are not a valid int.
+ */
+bool parse_length(std::string_view digits, int &length);
+
+/**
+ * @brief Same as parse_length(digits) for digits which are followed by more bytes of the input, e.g. the CRLF of the
+ * header. When 8 bytes can be read from the start of the digits, up to 8 digits are loaded and parsed at once within
+ * a 64 bit word (SWAR). Longer or negative lengths are parsed with std::from_chars.
+ *
+ * @param readable_size Number of bytes which can be read from the start of the digits.
+ */
+inline bool parse_length(std::string_view digits, std::size_t readable_size, int &length) {
+    if constexpr (std::endian::native != std::endian::little) {
+        return parse_length(digits, length);
+    }
+
+    if (digits.empty() || digits.size() > 8 || readable_size < 8) {
+        return parse_length(digits, length);
+    }
+
+    // A load of a fixed size stays in a register. The digits are moved to its top and padded with leading '0's.
+    std::uint64_t word;
+    std::memcpy(&word, digits.data(), sizeof(word));
+    if (digits.size() != 8) {
+        const auto shift = 8 * (8 - digits.size());
+        word = (word << shift) | (0x3030303030303030 >> (64 - shift));
+    }
+
+    // Every byte has to be between '0' and '9', e.g. negative lengths are left to std::from_chars.
+    const auto is_digit = ((word & 0xF0F0F0F0F0F0F0F0) == 0x3030303030303030) &&
+                          (((word + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) == 0x3030303030303030);
+    if (!is_digit) {
+        return parse_length(digits, length);
+    }
+
+    // Combine neighbouring digits, then pairs, then quadruples.
+    word -= 0x3030303030303030;
+    word = (word * 10 + (word >> 8)) & 0x00FF00FF00FF00FF;
+    word = (word * 100 + (word >> 16)) & 0x0000FFFF0000FFFF;
+    word = (word * 10000 + (word >> 32)) & 0x00000000FFFFFFFF;
+    length = static_cast<int>(word);
+    return true;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <span>
 #include <string>
 #include <variant>
 #include <vector>
@@ -26,15 +27,53 @@ class RESPTokenizer {
   public:
     RESPTokenizer();
     std::vector<Token> &generate_tokens(std::string_view input);
+
+    /**
+     * @brief Tokenize only the command at the start of the input, an array and its elements. The input can hold more
+     * commands of a pipeline after it.
+     *
+     */
+    std::vector<Token> &generate_command_tokens(std::string_view input);
+
+    /**
+     * @brief Payloads of the bulk strings which were streamed by the RESPParser, for the commands tokenized next. They
+     * are used in order, one for each header with the streamed prefix.
+     *
+     */
+    void set_streamed_values(std::span<const std::string> streamed_values) {
+        streamed_values_ = streamed_values;
+        next_streamed_value_ = 0;
+    }
+
+    /**
+     * @return Number of bytes of the input which were tokenized by the last call.
+     */
+    std::size_t get_number_of_bytes_consumed() const {
+        return position_;
+    }
+
+    /**
+     * @return Number of streamed values which were used by the commands tokenized since they were set.
+     */
+    std::size_t get_number_of_streamed_values_used() const {
+        return next_streamed_value_;
+    }
+
     void print_tokens() const;
 
   private:
     std::string_view get_view_before_the_next_CRLF();
+    int get_length(std::string_view digits) const;
+
+    void add_token();
 
     void add_array();
     void add_bulk_string();
+    void add_streamed_bulk_string();
 
     std::string_view input_view_{};
     std::size_t position_{0};
     std::vector<Token> tokens_{};
+    std::span<const std::string> streamed_values_{};
+    std::size_t next_streamed_value_{0};
 };
@@ -8,6 +8,11 @@
 namespace {
 using namespace std::chrono_literals;
 
+// Slots of the perfect hash table of the commands, a power of two.
+constexpr std::size_t NUMBER_OF_COMMAND_SLOTS = 32;
+constexpr std::uint8_t EMPTY_COMMAND_SLOT = 0xFF;
+constexpr std::size_t MAX_COMMAND_NAME_SIZE = 15;
+
 bool iequals(std::string_view lhs, std::string_view rhs) {
     const auto ichar_equals = [](char a, char b) {
         return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
@@ -15,58 +20,199 @@ bool iequals(std::string_view lhs, std::string_view rhs) {
 
     return std::ranges::equal(lhs, rhs, ichar_equals);
 }
+
+/**
+ * @brief FNV-1a of the upper cased name. Clearing bit 5 upper cases letters, other characters only need to hash the
+ * same every time as the name is compared after the lookup.
+ *
+ */
+constexpr std::uint32_t hash_command_name(std::string_view name, std::uint32_t seed) {
+    auto hash = 2166136261u ^ seed;
+    for (const auto c : name) {
+        hash ^= static_cast<std::uint8_t>(c) & 0xDF;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+constexpr std::size_t get_command_slot(std::string_view name, std::uint32_t seed) {
+    return hash_command_name(name, seed) & (NUMBER_OF_COMMAND_SLOTS - 1);
+}
+
+/**
+ * @brief Seed for which every command gets a slot of its own.
+ *
+ */
+template<typename Commands>
+constexpr std::uint32_t find_perfect_hash_seed(const Commands &commands) {
+    for (std::uint32_t seed{0};; ++seed) {
+        std::array<bool, NUMBER_OF_COMMAND_SLOTS> is_slot_used{};
+        auto has_collision = false;
+        for (const auto &command : commands) {
+            auto &is_used = is_slot_used[get_command_slot(command.name, seed)];
+            has_collision |= is_used;
+            is_used = true;
+        }
+
+        if (!has_collision) {
+            return seed;
+        }
+    }
+}
+
+template<typename Commands>
+constexpr std::array<std::uint8_t, NUMBER_OF_COMMAND_SLOTS> create_command_slots(const Commands &commands,
+                                                                                  std::uint32_t seed) {
+    std::array<std::uint8_t, NUMBER_OF_COMMAND_SLOTS> slots{};
+    slots.fill(EMPTY_COMMAND_SLOT);
+    for (std::size_t idx{0}; idx < commands.size(); ++idx) {
+        slots[get_command_slot(commands[idx].name, seed)] = static_cast<std::uint8_t>(idx);
+    }
+
+    return slots;
+}
+
+/**
+ * @brief Zero terminated lower case names, in the order of the commands.
+ *
+ */
+template<typename Commands>
+constexpr auto create_lower_case_command_names(const Commands &commands) {
+    std::array<std::array<char, MAX_COMMAND_NAME_SIZE + 1>, std::tuple_size_v<Commands>> names{};
+    for (std::size_t idx{0}; idx < commands.size(); ++idx) {
+        const auto name = commands[idx].name;
+        for (std::size_t position{0}; position < name.size() && position < MAX_COMMAND_NAME_SIZE; ++position) {
+            const auto c = name[position];
+            names[idx][position] = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+    }
+
+    return names;
+}
+
+std::string to_lower(std::string_view name) {
+    std::string lower_case_name{name};
+    std::ranges::transform(lower_case_name, lower_case_name.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+
+    return lower_case_name;
+}
+} // namespace
+
+// name, arity, flags, first key, last key, key step, handler
+constexpr std::array<MessageHandler::Command, MessageHandler::NUMBER_OF_COMMANDS> MessageHandler::COMMANDS{{
+  {"CLIENT", -2, to_flags(CommandFlag::admin), 0, 0, 0, &MessageHandler::generate_client_response},
+  {"COMMAND", -1, to_flags(), 0, 0, 0, &MessageHandler::generate_command_response},
+  {"CONFIG", -3, to_flags(CommandFlag::admin), 0, 0, 0, &MessageHandler::generate_rdb_config_response},
+  {"ECHO", 2, to_flags(CommandFlag::fast), 0, 0, 0, &MessageHandler::generate_echo_response},
+  {"GET", 2, to_flags(CommandFlag::read, CommandFlag::fast), 1, 1, 1, &MessageHandler::generate_get_response},
+  {"INFO", -2, to_flags(), 0, 0, 0, &MessageHandler::generate_redis_info_response},
+  {"KEYS", 2, to_flags(CommandFlag::read), 0, 0, 0, &MessageHandler::generate_keys_response},
+  {"PING", -1, to_flags(CommandFlag::fast), 0, 0, 0, &MessageHandler::generate_ping_response},
+  {"SET", -3, to_flags(CommandFlag::write), 1, 1, 1, &MessageHandler::generate_set_response},
+}};
+
+namespace {
+constexpr auto COMMAND_HASH_SEED = find_perfect_hash_seed(MessageHandler::COMMANDS);
+constexpr auto COMMAND_SLOTS = create_command_slots(MessageHandler::COMMANDS, COMMAND_HASH_SEED);
+// Recorded as the last command of a client.
+constexpr auto LOWER_CASE_COMMAND_NAMES = create_lower_case_command_names(MessageHandler::COMMANDS);
+
+static_assert(std::ranges::all_of(MessageHandler::COMMANDS, [](const auto &command) {
+    return command.name.size() <= MAX_COMMAND_NAME_SIZE;
+}));
 } // namespace
 
-MessageHandler::MessageHandler(const Redis &redis, DataManager<std::string, std::string> &data_manager)
+const MessageHandler::Command *MessageHandler::find_command(std::string_view name) {
+    const auto command_index = COMMAND_SLOTS[get_command_slot(name, COMMAND_HASH_SEED)];
+    if (command_index == EMPTY_COMMAND_SLOT) {
+        return nullptr;
+    }
+
+    // Names which are not commands can share the slot of one.
+    const auto &command = COMMANDS[command_index];
+    return iequals(name, command.name) ? &command : nullptr;
+}
+
+MessageHandler::MessageHandler(Redis &redis, DataManager<std::string, std::string> &data_manager)
   : tokenizer_{}, redis_{redis}, data_manager_{data_manager} {
 }
 
-const std::string &MessageHandler::genera_response(std::string_view input) {
-    response_ = "";
-    const auto &tokens = tokenizer_.generate_tokens(input);
+const std::string &MessageHandler::genera_response(std::string_view input, ClientInfo *client) {
+    response_.clear();
+    response_value_ = nullptr;
+    reply_.set_output(response_);
+    execute_command(input, client);
+
+    return response_;
+}
+
+PipelineResult
+MessageHandler::generate_pipeline_response(std::string_view input, std::string &responses, ClientInfo *client) {
+    response_value_ = nullptr;
+    reply_.set_output(responses);
 
-    // TODO retrun of verification fails...
-    verify_input(tokens);
+    PipelineResult result;
+    while (result.number_of_bytes < input.size()) {
+        execute_command(input.substr(result.number_of_bytes), client);
+        result.number_of_bytes += tokenizer_.get_number_of_bytes_consumed();
+        ++result.number_of_commands;
+
+        if (response_value_ != nullptr) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+void MessageHandler::execute_command(std::string_view input, ClientInfo *client) {
+    const auto &tokens = tokenizer_.generate_command_tokens(input);
+    if (!verify_input(tokens)) {
+        return;
+    }
 
     const auto number_of_array_elements = std::get<int>(tokens[0].value);
+    if (number_of_array_elements == 0) {
+        reply_.add_encoded(ReplyBuilder::EMPTY_ARRAY);
+        return;
+    }
     const auto &command_token = tokens[1];
 
     if (command_token.type != TokenType::BULK_STRING) {
         generate_error_response("Expected second token to be a BULK_STRING type");
+        return;
     }
 
     const auto command = std::get<std::string_view>(command_token.value);
-    // std::transform(command.begin(), command.end(), command.begin(), [](auto c) { return std::tolower(c); });
+    const auto *command_entry = find_command(command);
+    if (command_entry == nullptr) {
+        generate_error_response("Unknown command: " + std::string(command));
+        return;
+    }
 
-    if (iequals(command, "PING")) {
-        generate_ping_response();
-    } else if (iequals(command, "ECHO")) {
-        if (number_of_array_elements != 2) {
-            generate_error_response("ECHO command expects exactly one argument");
-        }
+    const auto command_index = static_cast<std::size_t>(command_entry - COMMANDS.data());
+    if (client != nullptr) {
+        client->last_command.store(LOWER_CASE_COMMAND_NAMES[command_index].data(), std::memory_order_relaxed);
+    }
 
-        generate_echo_response(tokens);
-    } else if (iequals(command, "SET")) {
-        generate_set_response(tokens);
-    } else if (iequals(command, "GET")) {
-        generate_get_response(tokens);
-    } else if (iequals(command, "CONFIG")) {
-        generate_rdb_config_response(tokens);
-    } else if (iequals(command, "KEYS")) {
-        generate_keys_response(tokens);
-    } else if (iequals(command, "INFO")) {
-        generate_redis_info_response(tokens);
-    } else {
-        generate_error_response("Unknown command: " + std::string(command));
+    if (!command_entry->accepts_number_of_arguments(number_of_array_elements)) {
+        generate_error_response("wrong number of arguments for '" + to_lower(command_entry->name) + "' command");
+        return;
     }
 
-    return response_;
+    // Only this thread writes the counter, INFO of any shard reads it.
+    auto &number_of_calls = number_of_calls_[command_index];
+    number_of_calls.store(number_of_calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    (this->*command_entry->handler)(tokens);
 }
 
-void MessageHandler::verify_input(const std::vector<Token> &tokens) {
+bool MessageHandler::verify_input(const std::vector<Token> &tokens) {
     if (tokens.empty()) {
         generate_error_response("Empty message");
-        return;
+        return false;
     }
 
     const auto &first_token = tokens[0];
@@ -82,21 +228,31 @@ void MessageHandler::verify_input(const std::vector<Token> &tokens) {
         throw std::runtime_error("Invalid number of array elements: " + std::to_string(number_of_array_elements));
     }
 
-    if (number_of_array_elements == 0) {
-        response_ = "*0\r\n";
-    }
-
     if (static_cast<int>(tokens.size() - 1) < number_of_array_elements) {
         throw std::runtime_error("Not enough tokens for the number of array elements");
     }
+
+    return true;
 }
 
-void MessageHandler::generate_ping_response() {
-    response_ = "+PONG\r\n";
+void MessageHandler::generate_ping_response(const std::vector<Token> &tokens) {
+    const auto number_of_array_elements = std::get<int>(tokens[0].value);
+    if (number_of_array_elements > 2) {
+        generate_error_response("wrong number of arguments for 'ping' command");
+        return;
+    }
+
+    // PING <message> replies with the message.
+    if (number_of_array_elements == 2) {
+        generate_echo_response(tokens);
+        return;
+    }
+
+    reply_.add_encoded(ReplyBuilder::PONG);
 }
 
-void MessageHandler::generate_error_response(const std::string &error_message) {
-    response_ = "-ERR " + error_message + "\r\n";
+void MessageHandler::generate_error_response(std::string_view error_message) {
+    reply_.add_error(error_message);
 }
 
 void MessageHandler::generate_echo_response(const std::vector<Token> &tokens) {
@@ -106,7 +262,7 @@ void MessageHandler::generate_echo_response(const std::vector<Token> &tokens) {
     }
 
     const auto echo_value = std::get<std::string_view>(echo_token.value);
-    response_ = "$" + std::to_string(echo_value.size()) + "\r\n" + std::string(echo_value) + "\r\n";
+    reply_.add_bulk(echo_value);
 }
 
 void MessageHandler::generate_set_response(const std::vector<Token> &tokens) {
@@ -122,7 +278,12 @@ void MessageHandler::generate_set_response(const std::vector<Token> &tokens) {
     const auto value = std::get<std::string_view>(value_token.value);
 
     std::chrono::milliseconds expiry_duration{std::numeric_limits<int>::max()};
-    const auto key_value_has_expiry = tokens.size() == 6;
+    const auto number_of_array_elements = std::get<int>(tokens[0].value);
+    if (number_of_array_elements != 3 && number_of_array_elements != 5) {
+        generate_error_response("syntax error");
+        return;
+    }
+    const auto key_value_has_expiry = number_of_array_elements == 5;
 
     if (key_value_has_expiry) {
         const auto &expiry_token = tokens[4];
@@ -142,12 +303,12 @@ void MessageHandler::generate_set_response(const std::vector<Token> &tokens) {
     }
 
 
-    if (!data_manager_.set(std::string(key), std::string(value), expiry_duration)) {
+    if (!data_manager_.set(key, take_value(value), expiry_duration)) {
         generate_error_response("Key already exists: " + std::string(key));
         return;
     }
 
-    response_ = "+OK\r\n";
+    reply_.add_encoded(ReplyBuilder::OK);
 }
 
 void MessageHandler::generate_get_response(const std::vector<Token> &tokens) {
@@ -158,13 +319,22 @@ void MessageHandler::generate_get_response(const std::vector<Token> &tokens) {
     }
 
     const auto key = std::get<std::string_view>(key_token.value);
-    const auto [exists, value] = data_manager_.get(std::string(key));
+    auto value = data_manager_.get_shared(key);
 
-    if (!exists) {
-        response_ = "$-1\r\n"; // Null bulk string
-    } else {
-        response_ = "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+    if (value == nullptr) {
+        reply_.add_encoded(ReplyBuilder::NULL_BULK);
+        return;
+    }
+
+    // Large values are sent from the memory of the data manager.
+    const auto zero_copy_threshold = redis_.get_zero_copy_threshold();
+    if (zero_copy_threshold != 0 && value->size() >= zero_copy_threshold) {
+        reply_.add_bulk_header(value->size());
+        response_value_ = std::move(value);
+        return;
     }
+
+    reply_.add_bulk(*value);
 }
 
 void MessageHandler::generate_rdb_config_response(const std::vector<Token> &tokens) {
@@ -192,17 +362,9 @@ void MessageHandler::generate_rdb_config_response(const std::vector<Token> &toke
         return;
     }
 
-    response_ = "*2\r\n$3\r\ndir\r\n";
-
-    if (target == "dir") {
-        const auto &dir = redis_.get_rdb_dir();
-        response_ += "$" + std::to_string(dir.size()) + "\r\n";
-        response_ += dir + "\r\n";
-    } else {
-        const auto &file_name = redis_.get_rdb_file_name();
-        response_ += "$" + std::to_string(file_name.size()) + "\r\n";
-        response_ += file_name + "\r\n";
-    }
+    reply_.add_array_header(2);
+    reply_.add_bulk("dir");
+    reply_.add_bulk(target == "dir" ? redis_.get_rdb_dir() : redis_.get_rdb_file_name());
 }
 
 void MessageHandler::generate_redis_info_response(const std::vector<Token> &tokens) {
@@ -212,33 +374,253 @@ void MessageHandler::generate_redis_info_response(const std::vector<Token> &toke
         return;
     }
 
-    const auto replication = std::get<std::string_view>(replication_command.value);
-    if (replication != "replication") {
-        generate_error_response("Only replication is supported for INFO command");
+    const auto section = std::get<std::string_view>(replication_command.value);
+
+    std::string response;
+    if (section == "replication") {
+        response = "role:" + redis_.get_role() + '\n';
+        response += "master_replid:" + redis_.get_replication_id() + '\n';
+        response += "master_repl_offset:" + std::to_string(redis_.get_replication_offset()) + '\n';
+    } else if (section == "threads") {
+        // <thread>:working_us=<us>,spinning_us=<us>,parked_us=<us>,parks=<count>,cpu=<cpu>,numa_node=<node>
+        // The CPU and the node are -1 when the thread is not pinned.
+        const auto to_info_line = [](const std::string &thread_name, const IdleStats &stats,
+                                     const ThreadPlacement &placement) {
+            return thread_name + ":working_us=" + std::to_string(stats.working_ns.load() / 1000) +
+                   ",spinning_us=" + std::to_string(stats.spinning_ns.load() / 1000) +
+                   ",parked_us=" + std::to_string(stats.parked_ns.load() / 1000) +
+                   ",parks=" + std::to_string(stats.number_of_parks.load()) +
+                   ",cpu=" + std::to_string(placement.cpu.load()) +
+                   ",numa_node=" + std::to_string(placement.numa_node.load()) + '\n';
+        };
+
+        // There are no shard threads when the network thread runs the commands to completion.
+        const auto is_run_to_completion = redis_.is_run_to_completion();
+        response = "execution_mode:";
+        response += is_run_to_completion ? "run_to_completion\n" : "shard_threads\n";
+        for (std::size_t idx{0}; idx < redis_.get_number_of_reactors(); ++idx) {
+            response += to_info_line("reactor_" + std::to_string(idx), redis_.get_reactor_idle_stats(idx),
+                                     redis_.get_reactor_placement(idx));
+        }
+        for (std::size_t idx{0}; idx < redis_.get_number_of_shards() && !is_run_to_completion; ++idx) {
+            response += to_info_line("shard_" + std::to_string(idx), redis_.get_shard_idle_stats(idx),
+                                     redis_.get_shard_placement(idx));
+        }
+        // background_<type>:pending=<count>,processed=<count>,cpu=<cpu>,numa_node=<node>
+        const auto &background_jobs = redis_.get_background_jobs();
+        for (std::size_t idx{0}; idx < NUMBER_OF_BACKGROUND_JOB_TYPES; ++idx) {
+            const auto type = static_cast<BackgroundJobType>(idx);
+            const auto &placement = background_jobs.get_placement(type);
+            response += "background_" + std::string{BACKGROUND_JOB_TYPE_NAMES[idx]} +
+                        ":pending=" + std::to_string(background_jobs.get_number_of_pending_jobs(type)) +
+                        ",processed=" + std::to_string(background_jobs.get_number_of_processed_jobs(type)) +
+                        ",cpu=" + std::to_string(placement.cpu.load()) +
+                        ",numa_node=" + std::to_string(placement.numa_node.load()) + '\n';
+        }
+    } else if (section == "clients") {
+        response = "connected_clients:" + std::to_string(redis_.get_number_of_clients()) + '\n';
+        response += "client_output_buffer_limit_disconnections:" +
+                    std::to_string(redis_.get_number_of_output_buffer_limit_disconnections()) + '\n';
+        response += "client_idle_timeout_disconnections:" +
+                    std::to_string(redis_.get_number_of_idle_timeout_disconnections()) + '\n';
+    } else if (section == "commandstats") {
+        // cmdstat_<command>:calls=<count>
+        for (std::size_t idx{0}; idx < COMMANDS.size(); ++idx) {
+            if (const auto number_of_calls = redis_.get_number_of_calls(idx); number_of_calls != 0) {
+                response += "cmdstat_" + to_lower(COMMANDS[idx].name) +
+                            ":calls=" + std::to_string(number_of_calls) + '\n';
+            }
+        }
+    } else if (section == "stats") {
+        response = "total_commands_processed:" + std::to_string(redis_.get_number_of_commands_processed()) + '\n';
+        response += "instantaneous_ops_per_sec:" + std::to_string(redis_.get_instantaneous_ops_per_sec()) + '\n';
+        response += "request_queue_full_pauses:" + std::to_string(redis_.get_number_of_request_queue_full_pauses()) +
+                    '\n';
+        response += "response_queue_full_pauses:" +
+                    std::to_string(redis_.get_number_of_response_queue_full_pauses()) + '\n';
+    } else {
+        generate_error_response(
+          "Only replication, threads, clients, stats and commandstats are supported for INFO command");
         return;
     }
 
-    auto response = "role:" + redis_.get_role() + '\n';
-    response += "master_replid:" + redis_.get_replication_id() + '\n';
-    response += "master_repl_offset:" + std::to_string(redis_.get_replication_offset()) + '\n';
-
 
-    response_ = "$" + std::to_string(response.size()) + "\r\n" + response + "\r\n";
+    reply_.add_bulk(response);
 }
 
 void MessageHandler::generate_keys_response(const std::vector<Token> &tokens) {
     const auto &pattern_token = tokens[2];
     const auto pattern = std::get<std::string_view>(pattern_token.value);
 
-    if (pattern == "*") {
+    if (pattern != "*") {
         generate_error_response("Only \"*\" is supported.");
+        return;
     }
 
-    // *<array_size>\r\n$<key_size>\r\n<key>\r\n
+    // *<array_size>\r\n$<key_size>\r\n<key>\r\n, only the keys of this shard. The network thread gathers the replies
+    // of every shard into one.
     const auto keys = data_manager_.get_keys();
 
-    response_ = "*" + std::to_string(keys.size()) + "\r\n";
+    reply_.add_array_header(keys.size());
     for (const auto &key : keys) {
-        response_ += "$" + std::to_string(key.size()) + "\r\n" + key + "\r\n";
+        reply_.add_bulk(key);
     }
 }
+
+void MessageHandler::generate_client_response(const std::vector<Token> &tokens) {
+    const auto number_of_array_elements = std::get<int>(tokens[0].value);
+    if (number_of_array_elements < 2 || tokens[2].type != TokenType::BULK_STRING) {
+        generate_error_response("CLIENT command expects a subcommand");
+        return;
+    }
+
+    const auto subcommand = std::get<std::string_view>(tokens[2].value);
+    if (iequals(subcommand, "LIST")) {
+        generate_client_list_response();
+    } else if (iequals(subcommand, "KILL")) {
+        generate_client_kill_response(tokens);
+    } else {
+        generate_error_response("Only LIST and KILL are supported for CLIENT command");
+    }
+}
+
+void MessageHandler::generate_client_list_response() {
+    // id=<id> addr=<ip:port> fd=<fd> age=<s> idle=<s> qbuf=<bytes> qbuf-free=<bytes> omem=<bytes> tot-mem=<bytes>
+    // cmd=<command>
+    const auto now = std::chrono::steady_clock::now();
+    std::string response;
+    redis_.for_each_client([&](const ClientInfo &client) {
+        const auto last_interaction =
+          std::chrono::steady_clock::time_point{std::chrono::nanoseconds{client.last_interaction_ns.load()}};
+        const auto query_buffer_bytes = client.query_buffer_bytes.load();
+        const auto query_buffer_capacity = client.query_buffer_capacity.load();
+        const auto query_buffer_free = query_buffer_capacity - std::min(query_buffer_bytes, query_buffer_capacity);
+        const auto output_buffer_bytes = client.output_buffer_bytes.load();
+        const auto age = std::chrono::duration_cast<std::chrono::seconds>(now - client.created_at);
+        const auto idle = std::chrono::duration_cast<std::chrono::seconds>(now - last_interaction);
+        const auto *last_command = client.last_command.load(std::memory_order_relaxed);
+
+        response += "id=" + std::to_string(client.id) + " addr=" + client.address +
+                    " fd=" + std::to_string(client.file_descriptor) + " age=" + std::to_string(age.count()) +
+                    " idle=" + std::to_string(idle.count()) + " qbuf=" + std::to_string(query_buffer_bytes) +
+                    " qbuf-free=" + std::to_string(query_buffer_free) +
+                    " omem=" + std::to_string(output_buffer_bytes) +
+                    " tot-mem=" + std::to_string(query_buffer_capacity + output_buffer_bytes) +
+                    " cmd=" + (last_command == nullptr ? "NULL" : last_command) + '\n';
+    });
+
+    reply_.add_bulk(response);
+}
+
+void MessageHandler::generate_client_kill_response(const std::vector<Token> &tokens) {
+    const auto number_of_array_elements = std::get<int>(tokens[0].value);
+    const auto is_bulk_string = [&](int idx) {
+        return tokens[idx].type == TokenType::BULK_STRING;
+    };
+
+    // Old form: CLIENT KILL <ip:port>
+    if (number_of_array_elements == 3 && is_bulk_string(3)) {
+        const auto address = std::get<std::string_view>(tokens[3].value);
+        if (redis_.kill_clients_by_address(address) == 0) {
+            generate_error_response("No such client");
+            return;
+        }
+
+        reply_.add_encoded(ReplyBuilder::OK);
+        return;
+    }
+
+    // New form: CLIENT KILL ID <id> | ADDR <ip:port>
+    if (number_of_array_elements != 4 || !is_bulk_string(3) || !is_bulk_string(4)) {
+        generate_error_response("CLIENT KILL expects <ip:port>, ID <id> or ADDR <ip:port>");
+        return;
+    }
+
+    const auto filter = std::get<std::string_view>(tokens[3].value);
+    const auto argument = std::get<std::string_view>(tokens[4].value);
+
+    std::size_t number_of_killed_clients;
+    if (iequals(filter, "ID")) {
+        number_of_killed_clients = redis_.kill_client(get_int_from_string_view(argument)) ? 1 : 0;
+    } else if (iequals(filter, "ADDR")) {
+        number_of_killed_clients = redis_.kill_clients_by_address(argument);
+    } else {
+        generate_error_response("Only ID and ADDR are supported for CLIENT KILL");
+        return;
+    }
+
+    reply_.add_integer(static_cast<long long>(number_of_killed_clients));
+}
+
+void MessageHandler::generate_command_response(const std::vector<Token> &tokens) {
+    const auto number_of_array_elements = std::get<int>(tokens[0].value);
+
+    // COMMAND lists every command.
+    if (number_of_array_elements == 1) {
+        reply_.add_array_header(COMMANDS.size());
+        for (const auto &command : COMMANDS) {
+            add_command_info(command);
+        }
+        return;
+    }
+
+    const auto subcommand = std::get<std::string_view>(tokens[2].value);
+    if (iequals(subcommand, "COUNT") && number_of_array_elements == 2) {
+        reply_.add_integer(static_cast<long long>(COMMANDS.size()));
+        return;
+    }
+
+    if (!iequals(subcommand, "INFO")) {
+        generate_error_response("Only COUNT and INFO are supported for COMMAND command");
+        return;
+    }
+
+    // COMMAND INFO <name> ... replies with a null array for names which are not commands.
+    reply_.add_array_header(static_cast<std::size_t>(number_of_array_elements - 2));
+    for (int idx{3}; idx <= number_of_array_elements; ++idx) {
+        const auto *command = find_command(std::get<std::string_view>(tokens[idx].value));
+        if (command == nullptr) {
+            reply_.add_encoded(ReplyBuilder::NULL_ARRAY);
+        } else {
+            add_command_info(*command);
+        }
+    }
+}
+
+void MessageHandler::add_command_info(const Command &command) {
+    // *6 <name> <arity> *<number of flags> +<flag>... <first key> <last key> <key step>
+    constexpr std::array<std::pair<CommandFlag, std::string_view>, 4> FLAG_NAMES{{{CommandFlag::write, "write"},
+                                                                                  {CommandFlag::read, "readonly"},
+                                                                                  {CommandFlag::admin, "admin"},
+                                                                                  {CommandFlag::fast, "fast"}}};
+
+    reply_.add_array_header(6);
+    reply_.add_bulk(to_lower(command.name));
+    reply_.add_integer(command.arity);
+
+    const auto number_of_flags = std::ranges::count_if(FLAG_NAMES, [&command](const auto &flag_name) {
+        return command.has_flag(flag_name.first);
+    });
+    reply_.add_array_header(static_cast<std::size_t>(number_of_flags));
+    for (const auto &[flag, flag_name] : FLAG_NAMES) {
+        if (command.has_flag(flag)) {
+            reply_.add_simple_string(flag_name);
+        }
+    }
+
+    reply_.add_integer(command.first_key);
+    reply_.add_integer(command.last_key);
+    reply_.add_integer(command.key_step);
+}
+
+std::string MessageHandler::take_value(std::string_view value) {
+    // A large value was streamed into a string of its own, which is moved into the keyspace.
+    const auto streamed_value = std::ranges::find_if(streamed_values_, [value](const auto &streamed_value) {
+        return streamed_value.data() == value.data();
+    });
+    if (streamed_value != streamed_values_.end()) {
+        return std::move(*streamed_value);
+    }
+
+    return std::string(value);
+}
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include "resp_parser.hpp"
+#include "resp_scan.hpp"
+
+namespace {
+// Longest header which is accepted, e.g. "$<length>\r\n". Bounds the bytes scanned again while a header is incomplete.
+constexpr std::size_t MAX_HEADER_SIZE = 32;
+} // namespace
+
+RESPParser::RESPParser(std::size_t max_bulk_length, std::size_t streamed_bulk_length)
+  : max_bulk_length_{max_bulk_length}, streamed_bulk_length_{streamed_bulk_length} {
+}
+
+RESPParser::Result RESPParser::parse(std::span<char> input) {
+    while (!has_error() && position_ < input.size()) {
+        const std::string_view input_view{input.data(), input.size()};
+        switch (state_) {
+        case State::array_header: {
+            const auto number_of_elements = parse_header(input_view, '*', "multibulk");
+            if (number_of_elements < 0) {
+                break;
+            }
+
+            // An empty array is a command of its own, the message handler answers it.
+            number_of_pending_elements_ = static_cast<std::size_t>(number_of_elements);
+            if (number_of_pending_elements_ == 0) {
+                complete_size_ = position_;
+                number_of_complete_streamed_values_ = streamed_values_.size();
+            } else {
+                state_ = State::bulk_string_header;
+            }
+            continue;
+        }
+        case State::bulk_string_header: {
+            const auto header_position = position_;
+            const auto length = parse_header(input_view, '$', "bulk");
+            if (length < 0) {
+                break;
+            }
+
+            if (static_cast<std::size_t>(length) > max_bulk_length_) {
+                set_error("Protocol error: invalid bulk length");
+                break;
+            }
+
+            number_of_pending_payload_bytes_ = static_cast<std::size_t>(length) + 2;
+            if (streamed_bulk_length_ != 0 && static_cast<std::size_t>(length) >= streamed_bulk_length_) {
+                // The whole payload is allocated at once, it is only copied when it is taken out of the input.
+                input[header_position] = STREAMED_BULK_STRING_PREFIX;
+                streamed_values_.emplace_back().reserve(number_of_pending_payload_bytes_);
+                state_ = State::streamed_bulk_string_payload;
+            } else {
+                state_ = State::bulk_string_payload;
+            }
+            continue;
+        }
+        case State::bulk_string_payload: {
+            const auto number_of_bytes = std::min(number_of_pending_payload_bytes_, input.size() - position_);
+            position_ += number_of_bytes;
+            number_of_pending_payload_bytes_ -= number_of_bytes;
+            if (number_of_pending_payload_bytes_ != 0) {
+                continue;
+            }
+
+            // The command is still in the input, the CRLF can be checked even when it arrived separately.
+            if (input_view.substr(position_ - 2, 2) != "\r\n") {
+                set_error("Protocol error: expected CRLF after bulk string");
+                break;
+            }
+
+            complete_element();
+            continue;
+        }
+        case State::streamed_bulk_string_payload:
+            if (stream_payload(input)) {
+                complete_element();
+            }
+            continue;
+        }
+
+        // A header is incomplete or the input is invalid.
+        break;
+    }
+
+    // The complete commands are taken out of the input by the caller.
+    const auto complete_size = complete_size_;
+    position_ -= complete_size;
+    complete_size_ = 0;
+    return {complete_size, input.size()};
+}
+
+std::vector<std::string> RESPParser::take_streamed_values() {
+    if (number_of_complete_streamed_values_ == 0) {
+        return {};
+    }
+
+    const auto complete_values_end = streamed_values_.begin() + number_of_complete_streamed_values_;
+    std::vector<std::string> values{std::make_move_iterator(streamed_values_.begin()),
+                                    std::make_move_iterator(complete_values_end)};
+    streamed_values_.erase(streamed_values_.begin(), complete_values_end);
+    number_of_complete_streamed_values_ = 0;
+    return values;
+}
+
+long long RESPParser::parse_header(std::string_view input, char prefix, const char *length_name) {
+    if (input[position_] != prefix) {
+        set_error(std::string{"Protocol error: expected '"} + prefix + "', got '" + input[position_] + "'");
+        return -1;
+    }
+
+    const auto header = input.substr(position_, MAX_HEADER_SIZE);
+    const auto line_end = find_crlf(header, 0);
+    if (line_end == std::string_view::npos) {
+        if (header.size() == MAX_HEADER_SIZE) {
+            set_error(std::string{"Protocol error: too big "} + length_name + " header");
+        }
+        return -1;
+    }
+
+    int value{0};
+    if (!parse_length(header.substr(1, line_end - 1), input.size() - position_ - 1, value) || value < 0) {
+        set_error(std::string{"Protocol error: invalid "} + length_name + " length");
+        return -1;
+    }
+
+    position_ += line_end + 2;
+    return value;
+}
+
+bool RESPParser::stream_payload(std::span<char> &input) {
+    // The payload is followed by its CRLF, both are copied and the CRLF is checked once it is complete.
+    auto &value = streamed_values_.back();
+    const auto number_of_bytes = std::min(number_of_pending_payload_bytes_, input.size() - position_);
+    value.append(input.data() + position_, number_of_bytes);
+    number_of_pending_payload_bytes_ -= number_of_bytes;
+
+    const auto rest = input.subspan(position_ + number_of_bytes);
+    std::memmove(input.data() + position_, rest.data(), rest.size());
+    input = input.first(input.size() - number_of_bytes);
+
+    if (number_of_pending_payload_bytes_ != 0) {
+        return false;
+    }
+
+    if (!value.ends_with("\r\n")) {
+        set_error("Protocol error: expected CRLF after bulk string");
+        return false;
+    }
+
+    value.resize(value.size() - 2);
+    return true;
+}
+
+void RESPParser::complete_element() {
+    if (--number_of_pending_elements_ == 0) {
+        complete_size_ = position_;
+        number_of_complete_streamed_values_ = streamed_values_.size();
+        state_ = State::array_header;
+    } else {
+        state_ = State::bulk_string_header;
+    }
+}
+
+void RESPParser::set_error(std::string error) {
+    error_ = std::move(error);
+}
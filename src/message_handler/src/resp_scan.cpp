@@ -0,0 +1,121 @@
+#include <bit>
+#include <charconv>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RESP_SCAN_HAS_X86 1
+#endif
+
+#include "resp_scan.hpp"
+
+namespace {
+std::size_t find_crlf_scalar(std::string_view input, std::size_t from) {
+    return input.find("\r\n", from);
+}
+
+#ifdef RESP_SCAN_HAS_X86
+/**
+ * @brief Check the '\r's of a block, given as a bit mask of their positions, for a following '\n'.
+ *
+ * @return Position of the first CRLF, npos when there is none in the block.
+ */
+std::size_t find_line_feed_after(std::string_view input, std::size_t block_start, std::uint32_t carriage_returns) {
+    while (carriage_returns != 0) {
+        const auto position = block_start + static_cast<std::size_t>(std::countr_zero(carriage_returns));
+        if (position + 1 < input.size() && input[position + 1] == '\n') {
+            return position;
+        }
+        carriage_returns &= carriage_returns - 1;
+    }
+
+    return std::string_view::npos;
+}
+
+__attribute__((target("sse2"))) std::size_t find_crlf_sse2(std::string_view input, std::size_t from) {
+    constexpr std::size_t BLOCK_SIZE = 16;
+    const auto carriage_return = _mm_set1_epi8('\r');
+
+    auto position = from;
+    for (; position + BLOCK_SIZE <= input.size(); position += BLOCK_SIZE) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input.data() + position));
+        const auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, carriage_return)));
+        if (const auto crlf = find_line_feed_after(input, position, mask); crlf != std::string_view::npos) {
+            return crlf;
+        }
+    }
+
+    return find_crlf_scalar(input, position);
+}
+
+__attribute__((target("avx2"))) std::size_t find_crlf_avx2(std::string_view input, std::size_t from) {
+    constexpr std::size_t BLOCK_SIZE = 32;
+    const auto carriage_return = _mm256_set1_epi8('\r');
+
+    auto position = from;
+    for (; position + BLOCK_SIZE <= input.size(); position += BLOCK_SIZE) {
+        const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input.data() + position));
+        const auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, carriage_return)));
+        if (const auto crlf = find_line_feed_after(input, position, mask); crlf != std::string_view::npos) {
+            return crlf;
+        }
+    }
+
+    return find_crlf_sse2(input, position);
+}
+#endif
+
+SIMDLevel detect_simd_level() {
+#ifdef RESP_SCAN_HAS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SIMDLevel::avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SIMDLevel::sse2;
+    }
+#endif
+    return SIMDLevel::scalar;
+}
+
+const SIMDLevel SUPPORTED_SIMD_LEVEL = detect_simd_level();
+const FindCRLF FIND_CRLF = get_find_crlf(SUPPORTED_SIMD_LEVEL);
+
+} // namespace
+
+SIMDLevel get_supported_simd_level() {
+    return SUPPORTED_SIMD_LEVEL;
+}
+
+const char *to_string(SIMDLevel simd_level) {
+    switch (simd_level) {
+    case SIMDLevel::avx2:
+        return "avx2";
+    case SIMDLevel::sse2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+std::size_t search_crlf(std::string_view input, std::size_t from) {
+    return FIND_CRLF(input, from);
+}
+
+FindCRLF get_find_crlf(SIMDLevel simd_level) {
+    switch (simd_level) {
+#ifdef RESP_SCAN_HAS_X86
+    case SIMDLevel::avx2:
+        return find_crlf_avx2;
+    case SIMDLevel::sse2:
+        return find_crlf_sse2;
+#endif
+    default:
+        return find_crlf_scalar;
+    }
+}
+
+bool parse_length(std::string_view digits, int &length) {
+    const auto [end, error_code] = std::from_chars(digits.data(), digits.data() + digits.size(), length);
+    return !digits.empty() && error_code == std::errc{} && end == digits.data() + digits.size();
+}
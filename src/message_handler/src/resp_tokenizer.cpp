@@ -3,13 +3,10 @@
 #include <stdexcept>
 #include <system_error>
 
-#include "common.hpp"
+#include "resp_parser.hpp"
+#include "resp_scan.hpp"
 #include "resp_tokenizer.hpp"
 
-namespace {
-const std::string CRLF = "\r\n";
-}
-
 RESPTokenizer::RESPTokenizer() {
 }
 
@@ -19,19 +16,29 @@ std::vector<Token> &RESPTokenizer::generate_tokens(std::string_view input) {
     input_view_ = input;
 
     while (position_ < input_view_.size()) {
-        const auto prefix = input_view_[position_];
-        position_++;
-
-        switch (prefix) {
-        case '*':
-            add_array();
-            break;
-        case '$':
-            add_bulk_string();
-            break;
-        default:
-            throw std::runtime_error("Invalid RESP prefix: " + std::string(1, prefix));
-        }
+        add_token();
+    }
+
+    return tokens_;
+}
+
+std::vector<Token> &RESPTokenizer::generate_command_tokens(std::string_view input) {
+    position_ = 0;
+    tokens_.clear();
+    input_view_ = input;
+
+    if (input_view_.empty()) {
+        return tokens_;
+    }
+
+    add_token();
+    if (tokens_.front().type != TokenType::ARRAY) {
+        return tokens_;
+    }
+
+    const auto number_of_elements = std::get<int>(tokens_.front().value);
+    for (int idx{0}; idx < number_of_elements && position_ < input_view_.size(); ++idx) {
+        add_token();
     }
 
     return tokens_;
@@ -70,8 +77,30 @@ void RESPTokenizer::print_tokens() const {
     }
 }
 
+void RESPTokenizer::add_token() {
+    const auto prefix = input_view_[position_];
+    position_++;
+
+    switch (prefix) {
+    case '*':
+        add_array();
+        break;
+    case '$':
+        add_bulk_string();
+        break;
+    case RESPParser::STREAMED_BULK_STRING_PREFIX:
+        add_streamed_bulk_string();
+        break;
+    default:
+        throw std::runtime_error("Invalid RESP prefix: " + std::string(1, prefix));
+    }
+}
+
 std::string_view RESPTokenizer::get_view_before_the_next_CRLF() {
-    const auto CRLF_postion = input_view_.find(CRLF, position_);
+    const auto CRLF_postion = find_crlf(input_view_, position_);
+    if (CRLF_postion == std::string_view::npos) {
+        throw std::runtime_error("Missing CRLF after position " + std::to_string(position_));
+    }
     const auto length = (CRLF_postion - position_);
     const auto result = input_view_.substr(position_, length);
 
@@ -80,15 +109,39 @@ std::string_view RESPTokenizer::get_view_before_the_next_CRLF() {
     return result;
 }
 
+int RESPTokenizer::get_length(std::string_view digits) const {
+    // The digits are followed by the rest of the input.
+    int length{0};
+    if (!parse_length(digits, input_view_.size() - (digits.data() - input_view_.data()), length)) {
+        throw std::runtime_error("Invalid length: " + std::string(digits));
+    }
+
+    return length;
+}
+
 void RESPTokenizer::add_array() {
     const auto array_length_view = get_view_before_the_next_CRLF();
-    const auto token = Token{TokenType::ARRAY, get_int_from_string_view(array_length_view)};
+    const auto token = Token{TokenType::ARRAY, get_length(array_length_view)};
     tokens_.emplace_back(token);
 }
 
 void RESPTokenizer::add_bulk_string() {
     // TODO: Handle null bulk strings
-    const auto length = get_int_from_string_view(get_view_before_the_next_CRLF());
+    const auto length = get_length(get_view_before_the_next_CRLF());
+    if (length < 0 || position_ + length + 2 > input_view_.size()) {
+        throw std::runtime_error("Truncated bulk string of length " + std::to_string(length));
+    }
     tokens_.emplace_back(Token{TokenType::BULK_STRING, std::string_view(input_view_.data() + position_, length)});
     position_ += length + 2;
 }
+
+void RESPTokenizer::add_streamed_bulk_string() {
+    // Only the header is part of the input.
+    const auto length = get_length(get_view_before_the_next_CRLF());
+    if (next_streamed_value_ == streamed_values_.size() ||
+        streamed_values_[next_streamed_value_].size() != static_cast<std::size_t>(length)) {
+        throw std::runtime_error("Missing streamed bulk string of length " + std::to_string(length));
+    }
+
+    tokens_.emplace_back(Token{TokenType::BULK_STRING, std::string_view{streamed_values_[next_streamed_value_++]}});
+}
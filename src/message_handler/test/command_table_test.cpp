@@ -0,0 +1,46 @@
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "message_handler.hpp"
+
+TEST(CommandTable, commandsAreFoundInAnyCase) {
+    for (const auto &command : MessageHandler::COMMANDS) {
+        std::string lower_case_name{command.name};
+        for (auto &c : lower_case_name) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+
+        EXPECT_EQ(MessageHandler::find_command(command.name), &command);
+        EXPECT_EQ(MessageHandler::find_command(lower_case_name), &command);
+    }
+
+    EXPECT_EQ(MessageHandler::find_command("GeT")->name, "GET");
+}
+
+TEST(CommandTable, unknownNamesAreNotFound) {
+    EXPECT_EQ(MessageHandler::find_command(""), nullptr);
+    EXPECT_EQ(MessageHandler::find_command("GETS"), nullptr);
+    EXPECT_EQ(MessageHandler::find_command("GE"), nullptr);
+    EXPECT_EQ(MessageHandler::find_command("HSET"), nullptr);
+    EXPECT_EQ(MessageHandler::find_command("G\xC5T"), nullptr);
+}
+
+TEST(CommandTable, arityAndKeys) {
+    const auto *get = MessageHandler::find_command("GET");
+    EXPECT_TRUE(get->accepts_number_of_arguments(2));
+    EXPECT_FALSE(get->accepts_number_of_arguments(1));
+    EXPECT_FALSE(get->accepts_number_of_arguments(3));
+    EXPECT_TRUE(get->has_flag(CommandFlag::read));
+    EXPECT_TRUE(get->has_flag(CommandFlag::fast));
+    EXPECT_FALSE(get->has_flag(CommandFlag::write));
+    EXPECT_EQ(get->first_key, 1);
+
+    const auto *set = MessageHandler::find_command("SET");
+    EXPECT_FALSE(set->accepts_number_of_arguments(2));
+    EXPECT_TRUE(set->accepts_number_of_arguments(3));
+    EXPECT_TRUE(set->accepts_number_of_arguments(5));
+    EXPECT_TRUE(set->has_flag(CommandFlag::write));
+
+    EXPECT_EQ(MessageHandler::find_command("PING")->first_key, 0);
+}
@@ -0,0 +1,102 @@
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "message_handler.hpp"
+#include "redis.hpp"
+#include "reply_builder.hpp"
+
+namespace {
+constexpr int LISTENING_PORT = 6010;
+
+// Heap allocations of the current thread, counted by the replaced operator new.
+thread_local std::size_t number_of_allocations{0};
+} // namespace
+
+void *operator new(std::size_t size) {
+    ++number_of_allocations;
+    if (auto *memory = std::malloc(size == 0 ? 1 : size); memory != nullptr) {
+        return memory;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+TEST(ReplyBuilder, encodesReplies) {
+    std::string output;
+    ReplyBuilder reply{output};
+
+    reply.add_encoded(ReplyBuilder::OK);
+    reply.add_simple_string("PONG");
+    reply.add_error("syntax error");
+    reply.add_integer(0);
+    reply.add_integer(-42);
+    reply.add_integer(std::numeric_limits<long long>::min());
+    reply.add_bulk("value");
+    reply.add_bulk("");
+    reply.add_bulk_header(70000);
+    reply.add_array_header(2);
+
+    EXPECT_EQ(output,
+              "+OK\r\n+PONG\r\n-ERR syntax error\r\n:0\r\n:-42\r\n:-9223372036854775808\r\n$5\r\nvalue\r\n$0\r\n\r\n"
+              "$70000\r\n*2\r\n");
+}
+
+TEST(ReplyBuilder, doesNotAllocateOnceTheOutputHasGrown) {
+    std::string output;
+    ReplyBuilder reply{output};
+    const std::string value(100, 'v');
+    const auto add_replies = [&]() {
+        reply.add_array_header(3);
+        reply.add_bulk(value);
+        reply.add_integer(123456789);
+        reply.add_encoded(ReplyBuilder::NULL_BULK);
+    };
+
+    add_replies();
+    output.clear();
+
+    const auto number_of_allocations_before = number_of_allocations;
+    add_replies();
+    EXPECT_EQ(number_of_allocations, number_of_allocations_before);
+}
+
+TEST(ReplyBuilder, getRepliesOfAPipelineDoNotAllocate) {
+    Redis redis{RedisConfig{{}, LISTENING_PORT, {}}};
+    DataManager<std::string, std::string> data_manager;
+    MessageHandler message_handler{redis, data_manager};
+
+    // The key is too long for the small string optimization.
+    const std::string key = "key:longer_than_a_small_string";
+    const std::string value(64, 'v');
+    const auto get = "*2\r\n$3\r\nGET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n";
+    const std::string get_missing_key = "*2\r\n$3\r\nGET\r\n$7\r\nmissing\r\n";
+    const std::string ping = "*1\r\n$4\r\nPING\r\n";
+    data_manager.set(key, value);
+
+    const auto pipeline = get + get_missing_key + ping + get;
+    const auto expected_responses = "$64\r\n" + value + "\r\n$-1\r\n+PONG\r\n$64\r\n" + value + "\r\n";
+
+    // The first pipeline grows the tokens and the responses.
+    std::string responses;
+    message_handler.generate_pipeline_response(pipeline, responses);
+    EXPECT_EQ(responses, expected_responses);
+    responses.clear();
+
+    const auto number_of_allocations_before = number_of_allocations;
+    const auto result = message_handler.generate_pipeline_response(pipeline, responses);
+    EXPECT_EQ(number_of_allocations, number_of_allocations_before);
+    EXPECT_EQ(result.number_of_commands, 4);
+    EXPECT_EQ(responses, expected_responses);
+}
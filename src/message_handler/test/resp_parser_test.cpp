@@ -0,0 +1,145 @@
+#include <span>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "resp_parser.hpp"
+
+namespace {
+const std::string SET_COMMAND = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n";
+const std::string PING_COMMAND = "*1\r\n$4\r\nPING\r\n";
+
+/**
+ * @return Size of the complete commands at the start of a copy of the input.
+ */
+std::size_t parse(RESPParser &parser, std::string input) {
+    return parser.parse(input).complete_size;
+}
+} // namespace
+
+TEST(RESPParser, completeCommandsOfPipeline) {
+    RESPParser parser{};
+    const auto input = SET_COMMAND + PING_COMMAND + SET_COMMAND.substr(0, 10);
+
+    EXPECT_EQ(parse(parser, input), SET_COMMAND.size() + PING_COMMAND.size());
+    EXPECT_FALSE(parser.has_error());
+}
+
+TEST(RESPParser, commandSplitAcrossReads) {
+    RESPParser parser{};
+    const auto input = PING_COMMAND + SET_COMMAND;
+
+    // The bytes arrive one by one, the complete commands are taken out of the buffer like a connection does.
+    std::string buffer;
+    std::string commands;
+    for (const auto byte : input) {
+        buffer += byte;
+        const auto complete_size = parser.parse(buffer).complete_size;
+        commands += buffer.substr(0, complete_size);
+        buffer.erase(0, complete_size);
+    }
+
+    EXPECT_EQ(commands, input);
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_FALSE(parser.has_error());
+}
+
+TEST(RESPParser, largeBulkStringArrivesInPieces) {
+    // Without streaming the payload stays in the input.
+    RESPParser parser{RESPParser::DEFAULT_MAX_BULK_LENGTH, 0};
+    const std::string value(1024 * 1024, 'v');
+    auto input = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+
+    constexpr std::size_t READ_SIZE = 64 * 1024;
+    for (std::size_t size{READ_SIZE}; size < input.size(); size += READ_SIZE) {
+        EXPECT_EQ(parser.parse(std::span<char>{input}.first(size)).complete_size, 0);
+    }
+    EXPECT_EQ(parser.parse(input).complete_size, input.size());
+}
+
+TEST(RESPParser, largeBulkStringIsStreamedOutOfTheInput) {
+    RESPParser parser{};
+    std::string value(1024 * 1024, 'v');
+    for (std::size_t idx{0}; idx < value.size(); idx += 1000) {
+        value[idx] = static_cast<char>('a' + (idx / 1000) % 26);
+    }
+    const std::string set_header = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n";
+    const auto length_header = std::to_string(value.size()) + "\r\n";
+    const auto input = set_header + "$" + length_header + value + "\r\n" + PING_COMMAND;
+
+    // The bytes arrive in reads like on a connection, the streamed payload does not pile up in the buffer.
+    constexpr std::size_t READ_SIZE = 10000;
+    std::string buffer;
+    std::string commands;
+    for (std::size_t position{0}; position < input.size(); position += READ_SIZE) {
+        buffer += input.substr(position, READ_SIZE);
+        const auto [complete_size, size] = parser.parse(buffer);
+        buffer.resize(size);
+        commands += buffer.substr(0, complete_size);
+        buffer.erase(0, complete_size);
+        EXPECT_LE(buffer.size(), READ_SIZE);
+    }
+
+    EXPECT_FALSE(parser.has_error());
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(commands, set_header + RESPParser::STREAMED_BULK_STRING_PREFIX + length_header + PING_COMMAND);
+
+    const auto streamed_values = parser.take_streamed_values();
+    ASSERT_EQ(streamed_values.size(), 1);
+    EXPECT_EQ(streamed_values.front(), value);
+    EXPECT_TRUE(parser.take_streamed_values().empty());
+}
+
+TEST(RESPParser, streamedValuesOfAPartialCommandAreKept) {
+    RESPParser parser{RESPParser::DEFAULT_MAX_BULK_LENGTH, 4};
+    std::string input = "*2\r\n$4\r\nECHO\r\n$5\r\nfirst\r\n*2\r\n$4\r\nECHO\r\n$6\r\nsecond\r\n";
+
+    // The second command is missing its last byte. The payloads are not part of the commands.
+    input.pop_back();
+    const auto [complete_size, size] = parser.parse(input);
+    EXPECT_EQ(input.substr(0, complete_size), "*2\r\n&4\r\n&5\r\n");
+    EXPECT_EQ(parser.take_streamed_values(), (std::vector<std::string>{"ECHO", "first"}));
+
+    auto pending = input.substr(complete_size, size - complete_size);
+    EXPECT_EQ(pending, "*2\r\n&4\r\n&6\r\n");
+    EXPECT_TRUE(parser.take_streamed_values().empty());
+
+    pending += "\n";
+    const auto result = parser.parse(pending);
+    EXPECT_EQ(result.complete_size, pending.size() - 1);
+    EXPECT_EQ(result.size, result.complete_size);
+    EXPECT_EQ(parser.take_streamed_values(), (std::vector<std::string>{"ECHO", "second"}));
+}
+
+TEST(RESPParser, invalidInputIsAnError) {
+    RESPParser inline_parser{};
+    EXPECT_EQ(parse(inline_parser, PING_COMMAND + "PING\r\n"), PING_COMMAND.size());
+    EXPECT_EQ(inline_parser.get_error(), "Protocol error: expected '*', got 'P'");
+
+    RESPParser length_parser{};
+    EXPECT_EQ(parse(length_parser, "*1\r\n$-3\r\n"), 0);
+    EXPECT_EQ(length_parser.get_error(), "Protocol error: invalid bulk length");
+
+    RESPParser header_parser{};
+    EXPECT_EQ(parse(header_parser, "*" + std::string(40, '1')), 0);
+    EXPECT_EQ(header_parser.get_error(), "Protocol error: too big multibulk header");
+
+    RESPParser payload_parser{};
+    EXPECT_EQ(parse(payload_parser, "*1\r\n$4\r\nPINGxx"), 0);
+    EXPECT_EQ(payload_parser.get_error(), "Protocol error: expected CRLF after bulk string");
+
+    RESPParser streamed_payload_parser{RESPParser::DEFAULT_MAX_BULK_LENGTH, 4};
+    EXPECT_EQ(parse(streamed_payload_parser, "*1\r\n$4\r\nPINGxx"), 0);
+    EXPECT_EQ(streamed_payload_parser.get_error(), "Protocol error: expected CRLF after bulk string");
+}
+
+TEST(RESPParser, bulkStringLongerThanTheLimitIsRejectedByItsHeader) {
+    RESPParser parser{1024};
+    EXPECT_EQ(parse(parser, "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$1024\r\n"), 0);
+    EXPECT_FALSE(parser.has_error());
+
+    RESPParser limited_parser{1024};
+    EXPECT_EQ(parse(limited_parser, "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$1025\r\n"), 0);
+    EXPECT_EQ(limited_parser.get_error(), "Protocol error: invalid bulk length");
+}
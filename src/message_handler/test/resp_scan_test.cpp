@@ -0,0 +1,75 @@
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "resp_scan.hpp"
+
+namespace {
+std::vector<SIMDLevel> get_simd_levels() {
+    std::vector<SIMDLevel> simd_levels{SIMDLevel::scalar};
+    if (get_supported_simd_level() != SIMDLevel::scalar) {
+        simd_levels.push_back(SIMDLevel::sse2);
+    }
+    if (get_supported_simd_level() == SIMDLevel::avx2) {
+        simd_levels.push_back(SIMDLevel::avx2);
+    }
+
+    return simd_levels;
+}
+} // namespace
+
+TEST(RESPScan, findCRLFAtEveryPosition) {
+    for (const auto simd_level : get_simd_levels()) {
+        const auto find_crlf = get_find_crlf(simd_level);
+        for (std::size_t crlf_position{0}; crlf_position < 100; ++crlf_position) {
+            // Carriage returns without a line feed before the CRLF must be skipped.
+            std::string input(crlf_position, 'x');
+            for (std::size_t idx{0}; idx < crlf_position; idx += 7) {
+                input[idx] = '\r';
+            }
+            input += "\r\n$3\r\n";
+
+            EXPECT_EQ(find_crlf(input, 0), crlf_position) << to_string(simd_level);
+            EXPECT_EQ(find_crlf(input, crlf_position + 1), crlf_position + 4) << to_string(simd_level);
+        }
+
+        // A carriage return at the end may be followed by a line feed of the next read.
+        const std::string incomplete = std::string(40, 'x') + '\r';
+        EXPECT_EQ(find_crlf(incomplete, 0), std::string_view::npos) << to_string(simd_level);
+        EXPECT_EQ(find_crlf(incomplete, incomplete.size()), std::string_view::npos);
+    }
+}
+
+TEST(RESPScan, parseLength) {
+    // Parses the digits alone and followed by a CRLF and more bytes of the input, which takes the SWAR path.
+    const auto parse = [](const std::string &digits) -> std::optional<int> {
+        int length{0};
+        const auto is_valid = parse_length(digits, length);
+
+        const auto header = digits + "\r\n$3\r\nGET\r\n";
+        int header_length{0};
+        const auto is_header_valid =
+          parse_length(std::string_view{header}.substr(0, digits.size()), header.size(), header_length);
+        EXPECT_EQ(is_valid, is_header_valid) << digits;
+        EXPECT_EQ(length, header_length) << digits;
+
+        return is_valid ? std::optional{length} : std::nullopt;
+    };
+
+    EXPECT_EQ(parse("0"), 0);
+    EXPECT_EQ(parse("7"), 7);
+    EXPECT_EQ(parse("1234"), 1234);
+    EXPECT_EQ(parse("00012"), 12);
+    EXPECT_EQ(parse("99999999"), 99999999);
+    EXPECT_EQ(parse("123456789"), 123456789);
+    EXPECT_EQ(parse("2147483647"), 2147483647);
+    EXPECT_EQ(parse("-1"), -1);
+
+    EXPECT_EQ(parse(""), std::nullopt);
+    EXPECT_EQ(parse("12a4"), std::nullopt);
+    EXPECT_EQ(parse("1:"), std::nullopt);
+    EXPECT_EQ(parse("/"), std::nullopt);
+    EXPECT_EQ(parse("2147483648"), std::nullopt);
+}
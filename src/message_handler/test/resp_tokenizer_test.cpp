@@ -70,3 +70,31 @@ TEST(RESPTokenizer, setWithExpiry) {
 
     EXPECT_EQ(tokens, expected_tokens);
 }
+
+TEST(RESPTokenizer, commandsOfPipeline) {
+    // Two commands sent with one write
+    const std::string resp_get = "*2\r\n$3\r\nGET\r\n$3\r\nkey\r\n";
+    const std::string resp_ping = "*1\r\n$4\r\nPING\r\n";
+    const std::string pipeline = resp_get + resp_ping;
+
+    RESPTokenizer tokenizer{};
+    const auto &get_tokens = tokenizer.generate_command_tokens(pipeline);
+    const std::vector<Token> expected_get_tokens{
+      Token{TokenType::ARRAY, 2}, Token{TokenType::BULK_STRING, "GET"}, Token{TokenType::BULK_STRING, "key"}};
+
+    EXPECT_EQ(get_tokens, expected_get_tokens);
+    EXPECT_EQ(tokenizer.get_number_of_bytes_consumed(), resp_get.size());
+
+    const auto &ping_tokens =
+      tokenizer.generate_command_tokens(std::string_view{pipeline}.substr(tokenizer.get_number_of_bytes_consumed()));
+    const std::vector<Token> expected_ping_tokens{Token{TokenType::ARRAY, 1}, Token{TokenType::BULK_STRING, "PING"}};
+
+    EXPECT_EQ(ping_tokens, expected_ping_tokens);
+    EXPECT_EQ(tokenizer.get_number_of_bytes_consumed(), resp_ping.size());
+}
+
+TEST(RESPTokenizer, truncatedCommandThrows) {
+    RESPTokenizer tokenizer{};
+    EXPECT_THROW(tokenizer.generate_command_tokens("*2\r\n$3\r\nGET\r\n$3\r\nke"), std::runtime_error);
+    EXPECT_THROW(tokenizer.generate_command_tokens("*2\r\n$3\r\nGET\r\n$3"), std::runtime_error);
+}
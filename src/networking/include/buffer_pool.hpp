@@ -0,0 +1,263 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A pool of power-of-two sized chunks that connection buffers are carved from. Chunks start small, are swapped
+ * for a bigger one when a buffer needs to grow and are returned to the pool when a buffer becomes empty or is
+ * destroyed, so the memory used by a server follows its working set instead of the number of connections.
+ *
+ * The pool is not thread safe, every server thread is expected to own its own pool.
+ */
+class BufferPool {
+  public:
+    static constexpr std::size_t MIN_CHUNK_SIZE = 4 * 1024;
+    static constexpr std::size_t MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+    static constexpr std::size_t DEFAULT_MAX_CACHED_BYTES = 64 * 1024 * 1024;
+
+    struct Stats {
+        // Bytes of the chunks currently handed out to buffers.
+        std::size_t bytes_in_use{0};
+        // Bytes of the free chunks kept around for reuse.
+        std::size_t bytes_cached{0};
+        // Number of chunks that had to be allocated from the heap.
+        std::size_t number_of_allocations{0};
+    };
+
+    explicit BufferPool(std::size_t max_cached_bytes = DEFAULT_MAX_CACHED_BYTES);
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool(const BufferPool &&) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &&) = delete;
+
+    /**
+     * @brief Get a chunk which can hold at least the given number of bytes.
+     *
+     * @param size Minimum number of bytes. It is rounded up to the next size class.
+     * @return std::unique_ptr<char[]> The chunk. Its size is chunk_size(size).
+     */
+    std::unique_ptr<char[]> acquire(std::size_t size);
+
+    /**
+     * @brief Give a chunk back to the pool. It is either cached for reuse or freed if the cache is full.
+     *
+     * @param chunk The chunk previously returned by acquire().
+     * @param size The size of the chunk.
+     */
+    void release(std::unique_ptr<char[]> chunk, std::size_t size) noexcept;
+
+    /**
+     * @brief Round the given size up to the size class of the pool.
+     */
+    static std::size_t chunk_size(std::size_t size) noexcept;
+
+    const Stats &get_stats() const {
+        return stats_;
+    }
+
+  private:
+    friend class BufferSlice;
+    friend class PooledBuffer;
+
+    static constexpr std::size_t NUMBER_OF_SIZE_CLASSES = 15;
+
+    /**
+     * @brief A chunk which is shared by slices, see BufferSlice.
+     *
+     */
+    struct SharedChunk {
+        std::unique_ptr<char[]> chunk{nullptr};
+        std::size_t size{0};
+        std::size_t number_of_references{0};
+    };
+
+    static std::size_t size_class(std::size_t chunk_size) noexcept;
+
+    /**
+     * @brief Share a chunk, with one reference to it. The bookkeeping is reused like the chunks, sharing a chunk does
+     * not allocate once the pool is warm.
+     *
+     * @param chunk Moved from only when the chunk is shared.
+     */
+    SharedChunk *share(std::unique_ptr<char[]> &&chunk, std::size_t size);
+
+    /**
+     * @brief Drop a reference to a shared chunk. The last one gives the chunk back to the pool.
+     */
+    void unshare(SharedChunk *shared_chunk) noexcept;
+
+    std::size_t max_cached_bytes_;
+    Stats stats_{};
+    std::array<std::vector<std::unique_ptr<char[]>>, NUMBER_OF_SIZE_CLASSES> free_chunks_;
+    // The deque does not move its elements, the slices point to them.
+    std::deque<SharedChunk> shared_chunks_;
+    std::vector<SharedChunk *> free_shared_chunks_;
+};
+
+/**
+ * @brief Bytes of a chunk which was taken out of a PooledBuffer without copying them, e.g. the requests which were
+ * received into it, see PooledBuffer::take_front(). Slices of the same chunk share it, the chunk goes back to the pool
+ * when the last of them is released.
+ *
+ * The references are not counted atomically. Slices are only created, copied and released by the thread which owns
+ * the pool. Another thread can read the bytes of a slice which is handed to it, and has to hand the slice back to be
+ * released.
+ */
+class BufferSlice {
+  public:
+    BufferSlice() = default;
+
+    BufferSlice(const BufferSlice &other) noexcept
+      : pool_{other.pool_}, shared_chunk_{other.shared_chunk_}, data_{other.data_}, size_{other.size_} {
+        if (shared_chunk_ != nullptr) {
+            ++shared_chunk_->number_of_references;
+        }
+    }
+
+    BufferSlice(BufferSlice &&other) noexcept
+      : pool_{other.pool_}, shared_chunk_{std::exchange(other.shared_chunk_, nullptr)},
+        data_{std::exchange(other.data_, nullptr)}, size_{std::exchange(other.size_, 0)} {
+    }
+
+    BufferSlice &operator=(BufferSlice other) noexcept {
+        std::swap(pool_, other.pool_);
+        std::swap(shared_chunk_, other.shared_chunk_);
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    ~BufferSlice() {
+        reset();
+    }
+
+    std::string_view view() const noexcept {
+        return {data_, size_};
+    }
+
+    std::size_t size() const noexcept {
+        return size_;
+    }
+
+    /**
+     * @brief Part of the slice, which holds its own reference to the chunk.
+     */
+    BufferSlice subslice(std::size_t offset, std::size_t size) const noexcept {
+        auto slice = *this;
+        slice.data_ += offset;
+        slice.size_ = size;
+        return slice;
+    }
+
+    /**
+     * @brief Release the reference to the chunk, the slice is empty afterwards.
+     */
+    void reset() noexcept {
+        if (shared_chunk_ != nullptr) {
+            pool_->unshare(shared_chunk_);
+        }
+        shared_chunk_ = nullptr;
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+  private:
+    friend class PooledBuffer;
+
+    BufferSlice(BufferPool *pool, BufferPool::SharedChunk *shared_chunk, std::size_t size) noexcept
+      : pool_{pool}, shared_chunk_{shared_chunk}, data_{shared_chunk->chunk.get()}, size_{size} {
+    }
+
+    BufferPool *pool_{nullptr};
+    BufferPool::SharedChunk *shared_chunk_{nullptr};
+    const char *data_{nullptr};
+    std::size_t size_{0};
+};
+
+/**
+ * @brief A growable byte buffer backed by a chunk of a BufferPool. No memory is held until the buffer is used.
+ *
+ */
+class PooledBuffer {
+  public:
+    explicit PooledBuffer(BufferPool &pool) : pool_{&pool} {
+    }
+
+    PooledBuffer(const PooledBuffer &) = delete;
+    PooledBuffer &operator=(const PooledBuffer &) = delete;
+    ~PooledBuffer() {
+        release();
+    }
+
+    char *data() noexcept {
+        return chunk_.get();
+    }
+
+    const char *data() const noexcept {
+        return chunk_.get();
+    }
+
+    char *begin() noexcept {
+        return data();
+    }
+
+    char *end() noexcept {
+        return data() + size_;
+    }
+
+    const char *begin() const noexcept {
+        return data();
+    }
+
+    const char *end() const noexcept {
+        return data() + size_;
+    }
+
+    /**
+     * @brief Capacity of the buffer in bytes.
+     */
+    std::size_t size() const noexcept {
+        return size_;
+    }
+
+    /**
+     * @brief Make sure the buffer can hold at least the given number of bytes.
+     *
+     * @param size Requested capacity.
+     * @param bytes_to_keep Number of bytes at the beginning of the buffer which have to survive a reallocation.
+     * @return false when the size is bigger than the largest chunk of the pool.
+     */
+    bool reserve(std::size_t size, std::size_t bytes_to_keep);
+
+    /**
+     * @brief Take the first bytes out of the buffer without copying them. The chunk goes to the returned slice, the
+     * buffer continues with a new chunk of the same size into which the bytes after the taken ones are copied. When
+     * there are none, the buffer holds no chunk until the next reserve(), as after release().
+     *
+     * @param size Number of bytes which are taken.
+     * @param number_of_bytes Number of bytes in the buffer, the ones after the taken bytes are kept.
+     */
+    BufferSlice take_front(std::size_t size, std::size_t number_of_bytes);
+
+    /**
+     * @brief Give the chunk back to the pool. The next reserve() starts with a chunk of the size that was released
+     * (up to MAX_SIZE_HINT), which avoids growing again step by step for connections with a steady traffic pattern.
+     *
+     */
+    void release() noexcept;
+
+  private:
+    static constexpr std::size_t MAX_SIZE_HINT = 64 * 1024;
+
+    BufferPool *pool_;
+    std::unique_ptr<char[]> chunk_{nullptr};
+    std::size_t size_{0};
+    std::size_t size_hint_{BufferPool::MIN_CHUNK_SIZE};
+};
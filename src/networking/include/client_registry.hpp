@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief Kind of a client, every kind has its own output buffer limits.
+ *
+ */
+enum class ClientClass : std::uint8_t { normal, replica };
+
+constexpr std::size_t NUMBER_OF_CLIENT_CLASSES = 2;
+
+/**
+ * @brief Bookkeeping of a connection which can be read by other threads than the one of the server (e.g. for CLIENT
+ * LIST). The numbers are updated by the server thread of the connection.
+ *
+ */
+struct ClientInfo {
+    ClientInfo(std::uint64_t id, int file_descriptor, std::string address);
+
+    const std::uint64_t id;
+    const int file_descriptor;
+    // <ip>:<port> of the peer.
+    const std::string address;
+    const std::chrono::steady_clock::time_point created_at;
+
+    std::atomic<ClientClass> client_class{ClientClass::normal};
+
+    // Bytes received but not consumed yet and the capacity of the receive buffer.
+    std::atomic<std::size_t> query_buffer_bytes{0};
+    std::atomic<std::size_t> query_buffer_capacity{0};
+    // Bytes waiting to be sent.
+    std::atomic<std::size_t> output_buffer_bytes{0};
+    // Time of the last received bytes, in nanoseconds of the steady clock.
+    std::atomic<std::int64_t> last_interaction_ns;
+
+    std::atomic<bool> is_kill_requested{false};
+
+    // Lower case name of the last command, nullptr before the first one. The commands of a client can be executed by
+    // several threads, the name has static storage so it can be replaced by any of them.
+    std::atomic<const char *> last_command{nullptr};
+};
+
+/**
+ * @brief The clients of a server. Connections are added and removed by the server thread, the list can be read and
+ * clients can be killed from any thread.
+ *
+ */
+class ClientRegistry {
+  public:
+    /**
+     * @brief Register a new connection. Its id is unique across all the registries of the process.
+     *
+     */
+    std::shared_ptr<ClientInfo> add(int file_descriptor, std::string address);
+
+    void remove(std::uint64_t client_id);
+
+    /**
+     * @return The client with the given id or nullptr when there is none.
+     */
+    std::shared_ptr<ClientInfo> find(std::uint64_t client_id) const;
+
+    /**
+     * @brief Call the given function for every registered client while the registry is locked.
+     *
+     */
+    template<typename Function>
+    void for_each(Function &&function) const {
+        std::lock_guard lock{mutex_};
+        for (const auto &[client_id, client_info] : clients_) {
+            function(*client_info);
+        }
+    }
+
+    std::size_t size() const {
+        std::lock_guard lock{mutex_};
+        return clients_.size();
+    }
+
+  private:
+    mutable std::mutex mutex_;
+    std::map<std::uint64_t, std::shared_ptr<ClientInfo>> clients_;
+};
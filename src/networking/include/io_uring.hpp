@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <memory>
+#include <string_view>
+
+/**
+ * @brief Minimal io_uring instance built directly on top of the io_uring system calls. Submission queue entries are
+ * collected with get_sqe() and handed to the kernel in one batch with submit(), completions are read from the shared
+ * completion queue without any system call.
+ *
+ * Not thread safe, an instance belongs to a single thread.
+ */
+class IOUring {
+  public:
+    explicit IOUring(unsigned number_of_entries);
+
+    IOUring(const IOUring &) = delete;
+    IOUring(const IOUring &&) = delete;
+    IOUring &operator=(const IOUring &) = delete;
+    IOUring &operator=(const IOUring &&) = delete;
+    ~IOUring();
+
+    /**
+     * @brief Get a zeroed submission queue entry. If the submission queue is full, the pending entries are submitted
+     * first.
+     *
+     */
+    io_uring_sqe *get_sqe();
+
+    /**
+     * @brief Submit the pending submission queue entries without waiting for any completion.
+     *
+     */
+    void submit();
+
+    /**
+     * @brief Submit the pending submission queue entries and block until there is at least one completion.
+     *
+     * @param timeout_ms Maximum time to wait, negative to wait without a limit.
+     */
+    void wait(int timeout_ms);
+
+    bool has_pending_submissions() const {
+        return sq_tail_ != sq_submitted_tail_;
+    }
+
+    /**
+     * @brief Call the given function for every available completion queue entry and mark them as seen.
+     *
+     * @return The number of completions which were handled.
+     */
+    template<typename Function>
+    unsigned for_each_cqe(Function &&function) {
+        auto head = std::atomic_ref<unsigned>{*cq_head_}.load(std::memory_order_relaxed);
+        const auto tail = std::atomic_ref<unsigned>{*cq_tail_}.load(std::memory_order_acquire);
+
+        unsigned number_of_completions{0};
+        for (; head != tail; ++head, ++number_of_completions) {
+            function(cqes_[head & cq_mask_]);
+        }
+
+        std::atomic_ref<unsigned>{*cq_head_}.store(head, std::memory_order_release);
+        return number_of_completions;
+    }
+
+    int get_file_descriptor() const {
+        return ring_file_descriptor_;
+    }
+
+  private:
+    void enter(unsigned min_complete, int timeout_ms);
+
+    int ring_file_descriptor_{-1};
+    bool has_ext_arg_{false};
+
+    void *sq_ring_{nullptr};
+    std::size_t sq_ring_size_{0};
+    void *cq_ring_{nullptr};
+    std::size_t cq_ring_size_{0};
+    io_uring_sqe *sqes_{nullptr};
+    std::size_t sqes_size_{0};
+
+    unsigned *sq_tail_pointer_{nullptr};
+    unsigned *sq_head_pointer_{nullptr};
+    unsigned *sq_array_{nullptr};
+    unsigned sq_mask_{0};
+    unsigned sq_entries_{0};
+    // Tail of the entries prepared by us and of the entries already handed to the kernel.
+    unsigned sq_tail_{0};
+    unsigned sq_submitted_tail_{0};
+
+    unsigned *cq_head_{nullptr};
+    unsigned *cq_tail_{nullptr};
+    io_uring_cqe *cqes_{nullptr};
+    unsigned cq_mask_{0};
+};
+
+/**
+ * @brief Equally sized buffers provided to an IOUring. Receive operations with buffer selection pick one of them, the
+ * buffer has to be recycled once its content is consumed.
+ *
+ * The buffers are handed to the kernel through a registered buffer ring. Kernels without buffer rings fall back to
+ * providing the buffers with IORING_OP_PROVIDE_BUFFERS operations.
+ */
+class ProvidedBufferRing {
+  public:
+    ProvidedBufferRing(IOUring &io_uring, std::uint16_t group_id, std::uint16_t number_of_buffers,
+                       std::size_t buffer_size);
+
+    ProvidedBufferRing(const ProvidedBufferRing &) = delete;
+    ProvidedBufferRing &operator=(const ProvidedBufferRing &) = delete;
+    ~ProvidedBufferRing();
+
+    std::string_view get_buffer(std::uint16_t buffer_id, std::size_t length) const {
+        return {buffers_.get() + buffer_id * buffer_size_, length};
+    }
+
+    /**
+     * @brief Give the buffer back to the kernel.
+     */
+    void recycle(std::uint16_t buffer_id);
+
+    std::uint16_t get_group_id() const {
+        return group_id_;
+    }
+
+    bool is_registered_ring() const {
+        return ring_ != nullptr;
+    }
+
+  private:
+    bool register_ring();
+    void unregister_ring();
+    void provide_buffers(std::uint16_t first_buffer_id, std::uint16_t number_of_buffers);
+
+    IOUring &io_uring_;
+    std::uint16_t group_id_;
+    std::uint16_t number_of_buffers_;
+    std::size_t buffer_size_;
+    io_uring_buf_ring *ring_{nullptr};
+    std::size_t ring_size_{0};
+    std::unique_ptr<char[]> buffers_;
+    std::uint16_t tail_{0};
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <sys/uio.h>
+
+#include "buffer_pool.hpp"
+
+enum class FlushResult {
+    // Everything that was queued is written to the socket.
+    done,
+    // The socket cannot take more data for now, the rest stays queued.
+    would_block,
+    // The connection is broken.
+    error
+};
+
+/**
+ * @brief Queue of pending outgoing bytes of a connection. The bytes are stored in a list of chunks taken from a
+ * BufferPool, a chunk is given back as soon as all of its bytes are written to the socket.
+ *
+ * Large payloads can be queued without a copy as external chunks. With zero copy enabled they are sent with
+ * MSG_ZEROCOPY, the kernel then reads them after the send returned and their memory is held until the completion
+ * notification of the send is read from the error queue of the socket.
+ */
+class OutputQueue {
+  public:
+    explicit OutputQueue(BufferPool &pool) : pool_{pool} {
+    }
+
+    OutputQueue(const OutputQueue &) = delete;
+    OutputQueue &operator=(const OutputQueue &) = delete;
+    ~OutputQueue();
+
+    /**
+     * @brief Append bytes to the end of the queue.
+     */
+    void append(std::string_view data);
+
+    /**
+     * @brief Append bytes which are sent straight from their memory instead of being copied into the queue.
+     *
+     * @param data The bytes. They must not change while they are queued or in flight.
+     * @param owner Keeps the memory of the bytes alive until the kernel is done with them.
+     */
+    void append_external(std::string_view data, std::shared_ptr<const void> owner);
+
+    /**
+     * @brief Send the external chunks with MSG_ZEROCOPY. SO_ZEROCOPY has to be set on the socket.
+     *
+     */
+    void enable_zero_copy() {
+        is_zero_copy_enabled_ = true;
+    }
+
+    /**
+     * @brief Read the completion notifications from the error queue of the socket and release the memory of the
+     * zero copy sends which are done.
+     *
+     * @param file_descriptor The socket the zero copy sends were made on.
+     */
+    void handle_zero_copy_completions(int file_descriptor) noexcept;
+
+    /**
+     * @brief Number of external chunks the kernel may still read from.
+     */
+    std::size_t get_number_of_zero_copy_chunks_in_flight() const {
+        return zero_copy_chunks_in_flight_.size();
+    }
+
+    /**
+     * @brief Write as much of the queue as the socket accepts with writev().
+     *
+     * @param file_descriptor The socket to write to.
+     * @return FlushResult
+     */
+    FlushResult flush(int file_descriptor) noexcept;
+
+    /**
+     * @brief Point the given io vectors at the pending bytes, one vector per chunk. The chunks stay valid until their
+     * bytes are consumed, new bytes are only appended behind the ones already handed out.
+     *
+     * @return The number of io vectors which were filled.
+     */
+    std::size_t get_pending_chunks(std::span<iovec> io_vectors) const noexcept;
+
+    /**
+     * @brief Drop the given number of bytes from the front of the queue after they were written to the socket.
+     */
+    void consume(std::size_t number_of_bytes) noexcept;
+
+    /**
+     * @brief Number of bytes waiting to be sent.
+     */
+    std::size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+  private:
+    // Chunks are at least this large, small replies are packed together into one chunk.
+    static constexpr std::size_t MIN_OUTPUT_CHUNK_SIZE = 16 * 1024;
+
+    struct Chunk {
+        // Memory from the pool, or nullptr for an external chunk.
+        std::unique_ptr<char[]> data;
+        std::size_t capacity{0};
+        // Bytes in [begin, end) are not sent yet.
+        std::size_t begin{0};
+        std::size_t end{0};
+        // Memory of an external chunk and its owner.
+        const char *external_data{nullptr};
+        std::shared_ptr<const void> owner;
+
+        const char *get_data() const {
+            return data != nullptr ? data.get() : external_data;
+        }
+    };
+
+    // Every MSG_ZEROCOPY call which sent bytes gets the next id, the kernel reports its completion with this id.
+    struct ZeroCopyChunk {
+        std::uint32_t id;
+        std::shared_ptr<const void> owner;
+    };
+
+    std::size_t get_chunks_to_send(std::span<iovec> io_vectors, bool &is_zero_copy) const noexcept;
+    void track_zero_copy_send(std::size_t bytes_sent);
+    void pop_front_chunk() noexcept;
+
+    BufferPool &pool_;
+    std::deque<Chunk> chunks_;
+    std::size_t size_{0};
+
+    bool is_zero_copy_enabled_{false};
+    std::uint32_t next_zero_copy_id_{0};
+    std::deque<ZeroCopyChunk> zero_copy_chunks_in_flight_;
+};
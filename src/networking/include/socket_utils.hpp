@@ -30,11 +30,17 @@ struct TCPSocketConfig {
     bool is_listening = false;
     bool is_blocking = false;
     bool needs_so_timestamp = false;
+    // Lets several listening sockets bind to the same port, the kernel spreads the new connections over them.
+    bool reuse_port = false;
+    // When set, a Unix domain stream socket at this path is used instead of ip and port. A listening socket replaces
+    // a stale socket file left at the path.
+    std::string unix_socket_path;
 
     auto toString() const {
         std::stringstream ss;
         ss << "SocketCfg[ip: " << ip << " port:" << port << " is listening: " << is_listening
-           << " is blocking: " << is_blocking << " needs_SO_timestamp: " << needs_so_timestamp << "]";
+           << " is blocking: " << is_blocking << " needs_SO_timestamp: " << needs_so_timestamp
+           << " reuse_port: " << reuse_port << " unix_socket_path: " << unix_socket_path << "]";
 
         return ss.str();
     }
@@ -42,5 +48,9 @@ struct TCPSocketConfig {
 
 bool set_non_blocking(int fd);
 
-// Create TCPSocket with provided attributes to either listen-on / connect-to.
+// Allow sends with MSG_ZEROCOPY on the socket.
+bool set_zero_copy(int fd);
+
+// Create TCPSocket with provided attributes to either listen-on / connect-to. With a unix socket path, the socket is a
+// Unix domain stream socket instead.
 [[nodiscard]] int create_socket(const TCPSocketConfig &socket_config);
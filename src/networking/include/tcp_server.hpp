@@ -1,14 +1,63 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/epoll.h>
 #include <unordered_map>
-#include <unordered_set>
+#include <vector>
 
+#include "buffer_pool.hpp"
+#include "client_registry.hpp"
+#include "io_uring.hpp"
 #include "tcp_socket.hpp"
+#include "timer_wheel.hpp"
+
+enum class IOBackend { epoll, io_uring };
+
+/**
+ * @brief Limits of the bytes waiting to be sent to a client. A client which is above the hard limit, or above the soft
+ * limit for the given duration, is disconnected. A limit of 0 is disabled.
+ *
+ */
+struct OutputBufferLimit {
+    std::size_t hard_limit_bytes{0};
+    std::size_t soft_limit_bytes{0};
+    std::chrono::seconds soft_limit_duration{0};
+};
+
+constexpr std::array<OutputBufferLimit, NUMBER_OF_CLIENT_CLASSES> DEFAULT_OUTPUT_BUFFER_LIMITS{
+  // normal, unlimited like in Redis: a reply can be as large as the largest value
+  OutputBufferLimit{0, 0, std::chrono::seconds{0}},
+  // replica
+  OutputBufferLimit{256 * 1024 * 1024, 64 * 1024 * 1024, std::chrono::seconds{60}}};
+
+struct TCPServerConfig {
+    int listening_port = -1;
+    // Needed when several servers listen on the same port, e.g. one server per network thread.
+    bool reuse_port = false;
+    // When io_uring is not available on the system, the server falls back to epoll.
+    IOBackend io_backend = IOBackend::epoll;
+    // Send the bytes enqueued without a copy with MSG_ZEROCOPY. Only used by the epoll backend.
+    bool zero_copy = false;
+    // Indexed by ClientClass.
+    std::array<OutputBufferLimit, NUMBER_OF_CLIENT_CLASSES> output_buffer_limits = DEFAULT_OUTPUT_BUFFER_LIMITS;
+    // When set, the server also accepts connections on a Unix domain socket at this path. Its clients are handled
+    // like the TCP ones but skip the TCP/IP stack.
+    std::string unix_socket_path{};
+    // Clients which did not send anything for this long are disconnected. 0 disables it.
+    std::chrono::milliseconds idle_timeout{0};
+};
 
 class TCPServer {
   public:
     explicit TCPServer(int listening_port);
+    explicit TCPServer(const TCPServerConfig &config);
 
     TCPServer() = delete;
     TCPServer(const TCPServer &) = delete;
@@ -18,31 +67,233 @@ class TCPServer {
     ~TCPServer();
 
     /**
-     * @brief Run the server
+     * @brief Run the server. Handles the pending events and flushes the sockets which have data enqueued.
+     *
+     * @param timeout_ms Time to wait for an event when there is none pending. 0 returns immediately, a negative value
+     * waits until there is an event or wake_up() is called. The wait can end early, e.g. when the thread is interrupted.
+     * @return true when any event (including a wake up) was handled or the before flush callback did any work.
+     */
+    bool poll(int timeout_ms = 0);
+
+    /**
+     * @brief Make a poll which is waiting for events return. Can be called from any thread. When the server is not
+     * waiting, the next poll returns immediately.
      *
      */
-    void poll();
+    void wake_up();
 
     /**
-     * @brief Enqueue a message to the send buffer of a clinet.
+     * @brief Enqueue a message to the send buffer of a clinet. The message is written to the socket at the end of the
+     * next poll.
      *
      * @param client_file_descriptor Socket file descriptor of the client.
      *
-     * @param message The message to be sent.
+     * @param message The message to be sent. It is copied into the send buffer, the caller can reuse its memory.
+     */
+    void enqueue_to_send_buffer(int client_file_descriptor, std::string_view message);
+
+    /**
+     * @brief Enqueue bytes to the send buffer of a client without copying them. They are sent straight from their
+     * memory, with MSG_ZEROCOPY when it is enabled.
+     *
+     * @param client_file_descriptor Socket file descriptor of the client.
+     *
+     * @param data The bytes to be sent. They must not change until the owner is released.
+     *
+     * @param owner Keeps the bytes alive, it is released once the kernel is done with them.
+     */
+    void enqueue_to_send_buffer(int client_file_descriptor, std::string_view data, std::shared_ptr<const void> owner);
+
+    /**
+     * @brief Stop reading from the clients, e.g. while the consumer of the received data cannot keep up. Their bytes
+     * wait in the kernel, where TCP flow control slows them down, and replies are still sent. Only from the thread of
+     * the server, also from the receive callback.
+     *
+     * Sockets are paused when they have something to read: under epoll their read interest is removed, under io_uring
+     * their receive is cancelled and what it already received is still delivered.
+     */
+    void pause_receiving();
+
+    /**
+     * @brief Read from the clients again, also what arrived while receiving was paused.
+     *
+     */
+    void resume_receiving();
+
+    bool is_receiving_paused() const {
+        return is_receiving_paused_;
+    }
+
+    /**
+     * @brief Socket of a client, e.g. to reach the protocol state of its connection. Only from the thread of the
+     * server.
+     *
+     * @return nullptr when there is no such client or its connection is being closed.
+     */
+    TCPSocket *get_socket_to_send_to(int client_file_descriptor);
+
+    std::size_t get_number_of_connections() const {
+        return file_descriptor_to_socket_.size();
+    }
+
+    const BufferPool::Stats &get_buffer_pool_stats() const {
+        return buffer_pool_.get_stats();
+    }
+
+    /**
+     * @brief Clients connected to this server. Can be read from any thread.
+     *
      */
-    void enqueue_to_send_buffer(int client_file_descriptor, const std::string &message);
+    const ClientRegistry &get_client_registry() const {
+        return client_registry_;
+    }
+
+    /**
+     * @brief Disconnect a client of this server during the next poll. Can be called from any thread.
+     *
+     * @return false when the server has no client with the given id.
+     */
+    bool kill_client(std::uint64_t client_id);
+
+    /**
+     * @brief Number of clients which were disconnected because they exceeded their output buffer limit. Can be read
+     * from any thread.
+     *
+     */
+    std::size_t get_number_of_output_buffer_limit_disconnections() const {
+        return number_of_output_buffer_limit_disconnections_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Run a callback once after the given delay. Timers run within poll() and can only be added and cancelled
+     * from the thread of the server, or before it starts polling.
+     *
+     * @return Id to cancel the timer.
+     */
+    TimerId add_timer(std::chrono::milliseconds delay, TimerWheel::Callback callback);
+
+    /**
+     * @brief Run a callback every interval until the timer is cancelled, see add_timer().
+     *
+     */
+    TimerId add_periodic_timer(std::chrono::milliseconds interval, TimerWheel::Callback callback);
+
+    /**
+     * @return false when the timer already ran or was cancelled.
+     */
+    bool cancel_timer(TimerId timer_id);
+
+    /**
+     * @brief Number of clients which were disconnected because of the idle timeout. Can be read from any thread.
+     *
+     */
+    std::size_t get_number_of_idle_timeout_disconnections() const {
+        return number_of_idle_timeout_disconnections_.load(std::memory_order_relaxed);
+    }
+
+    IOBackend get_io_backend() const {
+        return io_uring_ != nullptr ? IOBackend::io_uring : IOBackend::epoll;
+    }
 
     // Function wrapper to call back when data is available.
     std::function<void(TCPSocket *socket)> receive_callback = nullptr;
 
+    // Called by every poll after the events were handled and before the sockets are flushed, e.g. to enqueue the
+    // replies produced by other threads. They are sent by the same poll, also by one which was woken up for them.
+    // Returns whether it enqueued anything.
+    std::function<bool()> before_flush_callback = nullptr;
+
   private:
-    void add_new_connections();
+    bool run_before_flush_callback();
+    void setup_epoll();
+    void add_new_connections(TCPSocket &listening_socket);
+    void clear_wake_up();
+    void setup_timer();
+    void clear_timer();
+    void run_timers();
+    void arm_timer();
+    void schedule_idle_timeout(TCPSocket *socket, TimerWheel::Clock::duration delay);
+    void check_idle_timeout(TCPSocket *socket);
+    void register_client(TCPSocket *socket);
+    bool has_exceeded_output_buffer_limit(TCPSocket *socket, std::size_t bytes_to_add);
+    void disconnect_for_output_buffer_limit(TCPSocket *socket);
+    void update_query_buffer_info(TCPSocket *socket);
+    void update_output_buffer_info(TCPSocket *socket);
+    void schedule_flush(TCPSocket *socket);
+    void schedule_close(TCPSocket *socket);
+    void close_killed_clients();
+    void close_scheduled_connections();
+    void flush_sockets();
+    void flush(TCPSocket *socket);
+    void set_waiting_for_write(TCPSocket *socket, bool is_waiting_for_write);
+    void update_epoll_events(TCPSocket *socket);
+    void pause_socket_receiving(TCPSocket *socket);
+    void close_connection(TCPSocket *socket);
+
+    // io_uring backend, see tcp_server_io_uring.cpp.
+    void setup_io_uring();
+    bool poll_io_uring(int timeout_ms);
+    void handle_completion(const io_uring_cqe &completion);
+    void handle_accept_completion(TCPSocket &listening_socket, const io_uring_cqe &completion);
+    void handle_receive_completion(TCPSocket *socket, const io_uring_cqe &completion);
+    void handle_send_completion(TCPSocket *socket, const io_uring_cqe &completion);
+    void handle_wake_up_completion(const io_uring_cqe &completion);
+    void handle_timer_completion(const io_uring_cqe &completion);
+    void submit_accept(TCPSocket &listening_socket);
+    void submit_receive(TCPSocket *socket);
+    void submit_receive_cancel(TCPSocket *socket);
+    void submit_sends(TCPSocket *socket);
+    void submit_wake_up_read();
+    void submit_timer_read();
+    void finish_operation(TCPSocket *socket);
+
+    // Memory of the send and receive buffers of all sockets. It has to outlive the sockets.
+    BufferPool buffer_pool_;
+
+    bool is_zero_copy_enabled_;
+    std::array<OutputBufferLimit, NUMBER_OF_CLIENT_CLASSES> output_buffer_limits_;
+
+    ClientRegistry client_registry_;
+    std::atomic<bool> has_kill_requests_{false};
+    std::atomic<std::size_t> number_of_output_buffer_limit_disconnections_{0};
 
     // Socket on which this server is listening for new connections on.
     TCPSocket listening_socket_;
+    // Only set when the server also listens on a Unix domain socket.
+    std::string unix_socket_path_;
+    std::unique_ptr<TCPSocket> unix_listening_socket_;
     int epoll_file_descriptor_{-1};
+    std::array<epoll_event, 1024> events_;
+
+    // Event file descriptor which is written by wake_up(). The value is read into wake_up_counter_ to reset it.
+    int wake_up_file_descriptor_{-1};
+    std::uint64_t wake_up_counter_{0};
+
+    // Timers of the server. The timer file descriptor is armed for the next time the wheel has to advance, the number
+    // of expirations is read into timer_expirations_.
+    TimerWheel timer_wheel_;
+    int timer_file_descriptor_{-1};
+    std::uint64_t timer_expirations_{0};
+    std::optional<TimerWheel::Clock::time_point> armed_timer_time_;
+
+    std::chrono::milliseconds idle_timeout_;
+    std::atomic<std::size_t> number_of_idle_timeout_disconnections_{0};
 
     // Collection of all sockets.
     std::unordered_map<int, std::unique_ptr<TCPSocket>> file_descriptor_to_socket_;
-    std::unordered_set<TCPSocket *> receive_sockets_;
+
+    // Sockets which got new data enqueued since the last poll.
+    std::vector<TCPSocket *> sockets_to_flush_;
+    std::vector<TCPSocket *> sockets_being_flushed_;
+
+    // Sockets which are closed at the end of the poll, e.g. because of their output buffer limit.
+    std::vector<TCPSocket *> sockets_to_close_;
+
+    // See pause_receiving(). The sockets which were paused are resumed with the server.
+    bool is_receiving_paused_{false};
+    std::vector<TCPSocket *> sockets_with_paused_receiving_;
+
+    // Only set when the io_uring backend is used.
+    std::unique_ptr<IOUring> io_uring_;
+    std::unique_ptr<ProvidedBufferRing> receive_buffer_ring_;
 };
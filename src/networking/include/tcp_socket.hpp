@@ -1,14 +1,20 @@
 #pragma once
 
+#include <chrono>
 #include <cstddef>
 #include <functional>
-#include <vector>
+#include <memory>
+#include <string_view>
 
+#include "buffer_pool.hpp"
+#include "client_registry.hpp"
+#include "output_queue.hpp"
 #include "socket_utils.hpp"
+#include "timer_wheel.hpp"
 
 struct TCPSocket {
-    TCPSocket(const TCPSocketConfig &socket_config);
-    TCPSocket(int file_descriptor);
+    TCPSocket(const TCPSocketConfig &socket_config, BufferPool &buffer_pool);
+    TCPSocket(int file_descriptor, BufferPool &buffer_pool);
 
     TCPSocket() = delete;
     TCPSocket(const TCPSocket &) = delete;
@@ -18,34 +24,93 @@ struct TCPSocket {
     ~TCPSocket();
 
     /**
-     * @brief Receive bytes from the socket and return the number of bytes received.
+     * @brief Receive bytes from the socket until the kernel has nothing more to give (EAGAIN). The receive callback is
+     * called with everything that was read, and before the receive buffer grows when it is full.
      *
-     * @return int number of bytes received. (Returns the value from the recv system call)
+     * @return false when the peer closed the connection or the connection failed and the socket has to be removed.
      */
-    int receive() noexcept;
+    bool receive() noexcept;
 
     /**
-     * @brief Send the content of send buffer
+     * @brief Append bytes which were received outside of receive() (e.g. by io_uring) to the receive buffer and call
+     * the receive callback.
      *
+     * @return false when the bytes do not fit into the receive buffer even after the callback consumed it.
      */
-    void send() noexcept;
+    bool append_received_data(std::string_view data) noexcept;
+
+    /**
+     * @brief Write as much of the queued data as the socket accepts.
+     *
+     * @return FlushResult
+     */
+    FlushResult send() noexcept;
 
     /**
      * @brief Enqueue a message to the send buffer.
      *
      * @param message The message to be sent.
      */
-    void enqueue_to_send_buffer(const std::string &message);
+    void enqueue_to_send_buffer(std::string_view message);
+
+    /**
+     * @brief Enqueue bytes which are sent without copying them into the send buffer.
+     *
+     * @param data The bytes to be sent.
+     * @param owner Keeps the bytes alive until they are sent.
+     */
+    void enqueue_to_send_buffer(std::string_view data, std::shared_ptr<const void> owner);
 
     // File descriptor for the socket.
     int file_descriptor = -1;
 
-    // Send and receive buffers and trackers for read/write indices.
-    std::vector<char> receive_buffer;
-    std::vector<char> send_buffer;
+    // Receive buffer and tracker for its write index. The buffer grows on demand and gives its memory back to the pool
+    // once it is drained.
+    PooledBuffer receive_buffer;
     std::size_t next_valid_receive_index = 0;
-    std::size_t next_valid_send_index = 0;
+
+    // Bytes waiting to be written to the socket.
+    OutputQueue send_queue;
+
+    // True while the socket is registered for EPOLLOUT, which is only the case while the kernel send buffer is full.
+    bool is_waiting_for_write = false;
+
+    // True while the server does not read from the socket, see TCPServer::pause_receiving().
+    bool is_receive_paused = false;
+
+    // Flag of the server which pauses receiving, receive() stops reading as soon as it is set.
+    const bool *is_server_receiving_paused = nullptr;
+
+    // True while the socket is in the list of sockets which are flushed at the end of a poll.
+    bool is_flush_scheduled = false;
+
+    // True while the socket is in the list of sockets which are closed at the end of a poll. Nothing is sent to it
+    // anymore.
+    bool is_close_scheduled = false;
+
+    // Time since which the send queue is above the soft output buffer limit, or the epoch when it is not.
+    std::chrono::steady_clock::time_point soft_output_limit_reached_at{};
+
+    // Timer which checks whether the client was idle for too long, only set when the server has an idle timeout.
+    TimerId idle_timer_id = TimerWheel::INVALID_TIMER_ID;
+
+    // Bookkeeping shared with the client registry of the server. Not set for the listening socket.
+    std::shared_ptr<ClientInfo> client_info = nullptr;
+
+    // State of the protocol on top of the connection, e.g. a partially parsed request. Owned by the receive callback,
+    // the server only destroys it with the socket.
+    std::shared_ptr<void> protocol_state = nullptr;
+
+    // State used by the io_uring backend. The socket can only be destroyed once the kernel does not own any of its
+    // operations anymore, until then it is closing.
+    std::size_t number_of_pending_operations = 0;
+    std::size_t number_of_sends_in_flight = 0;
+    bool is_receive_armed = false;
+    bool is_closing = false;
 
     // Function wrapper to callback when there is data to be processed.
     std::function<void(TCPSocket *socket)> receive_callback = nullptr;
+
+  private:
+    void deliver_received_data() noexcept;
 };
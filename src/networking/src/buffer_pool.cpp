@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "buffer_pool.hpp"
+
+BufferPool::BufferPool(std::size_t max_cached_bytes) : max_cached_bytes_{max_cached_bytes} {
+}
+
+std::size_t BufferPool::chunk_size(std::size_t size) noexcept {
+    return std::bit_ceil(std::max(size, MIN_CHUNK_SIZE));
+}
+
+std::size_t BufferPool::size_class(std::size_t chunk_size) noexcept {
+    return std::countr_zero(chunk_size) - std::countr_zero(MIN_CHUNK_SIZE);
+}
+
+std::unique_ptr<char[]> BufferPool::acquire(std::size_t size) {
+    const auto rounded_size = chunk_size(size);
+    auto &free_chunks = free_chunks_[size_class(rounded_size)];
+    stats_.bytes_in_use += rounded_size;
+
+    if (!free_chunks.empty()) {
+        auto chunk = std::move(free_chunks.back());
+        free_chunks.pop_back();
+        stats_.bytes_cached -= rounded_size;
+        return chunk;
+    }
+
+    ++stats_.number_of_allocations;
+
+    // Default initialization on purpose, the pages are only touched when data is written to them.
+    return std::unique_ptr<char[]>(new char[rounded_size]);
+}
+
+void BufferPool::release(std::unique_ptr<char[]> chunk, std::size_t size) noexcept {
+    if (chunk == nullptr) {
+        return;
+    }
+
+    stats_.bytes_in_use -= size;
+    if (stats_.bytes_cached + size > max_cached_bytes_) {
+        return;
+    }
+
+    auto &free_chunks = free_chunks_[size_class(size)];
+    try {
+        free_chunks.push_back(std::move(chunk));
+        stats_.bytes_cached += size;
+    } catch (...) {
+        // Failing to cache a chunk is not an error, it is simply freed.
+    }
+}
+
+BufferPool::SharedChunk *BufferPool::share(std::unique_ptr<char[]> &&chunk, std::size_t size) {
+    if (free_shared_chunks_.empty()) {
+        // Room for every shared chunk, so that giving one back cannot fail.
+        free_shared_chunks_.reserve(shared_chunks_.size() + 1);
+        free_shared_chunks_.push_back(&shared_chunks_.emplace_back());
+    }
+
+    auto *shared_chunk = free_shared_chunks_.back();
+    free_shared_chunks_.pop_back();
+    shared_chunk->chunk = std::move(chunk);
+    shared_chunk->size = size;
+    shared_chunk->number_of_references = 1;
+    return shared_chunk;
+}
+
+void BufferPool::unshare(SharedChunk *shared_chunk) noexcept {
+    if (--shared_chunk->number_of_references != 0) {
+        return;
+    }
+
+    release(std::move(shared_chunk->chunk), shared_chunk->size);
+    free_shared_chunks_.push_back(shared_chunk);
+}
+
+bool PooledBuffer::reserve(std::size_t size, std::size_t bytes_to_keep) {
+    if (size <= size_) {
+        return true;
+    }
+
+    if (size > BufferPool::MAX_CHUNK_SIZE) {
+        return false;
+    }
+
+    // Grow at least by a factor of two so that appending stays amortized O(1).
+    const auto new_size = BufferPool::chunk_size(std::max({size, size_ * 2, size_hint_}));
+    auto new_chunk = pool_->acquire(new_size);
+    if (bytes_to_keep != 0) {
+        std::memcpy(new_chunk.get(), chunk_.get(), std::min(bytes_to_keep, size_));
+    }
+
+    pool_->release(std::move(chunk_), size_);
+    chunk_ = std::move(new_chunk);
+    size_ = new_size;
+    return true;
+}
+
+BufferSlice PooledBuffer::take_front(std::size_t size, std::size_t number_of_bytes) {
+    const auto bytes_to_keep = number_of_bytes - size;
+    std::unique_ptr<char[]> new_chunk{nullptr};
+    if (bytes_to_keep != 0) {
+        new_chunk = pool_->acquire(size_);
+        std::memcpy(new_chunk.get(), chunk_.get() + size, bytes_to_keep);
+    }
+
+    BufferSlice slice{pool_, pool_->share(std::move(chunk_), size_), size};
+    chunk_ = std::move(new_chunk);
+    if (chunk_ == nullptr) {
+        size_hint_ = std::min(size_, MAX_SIZE_HINT);
+        size_ = 0;
+    }
+    return slice;
+}
+
+void PooledBuffer::release() noexcept {
+    if (size_ != 0) {
+        size_hint_ = std::min(size_, MAX_SIZE_HINT);
+    }
+
+    pool_->release(std::move(chunk_), size_);
+    chunk_ = nullptr;
+    size_ = 0;
+}
@@ -0,0 +1,31 @@
+#include "client_registry.hpp"
+
+namespace {
+std::atomic<std::uint64_t> next_client_id{1};
+} // namespace
+
+ClientInfo::ClientInfo(std::uint64_t id, int file_descriptor, std::string address)
+  : id{id}, file_descriptor{file_descriptor}, address{std::move(address)},
+    created_at{std::chrono::steady_clock::now()},
+    last_interaction_ns{std::chrono::duration_cast<std::chrono::nanoseconds>(created_at.time_since_epoch()).count()} {
+}
+
+std::shared_ptr<ClientInfo> ClientRegistry::add(int file_descriptor, std::string address) {
+    const auto client_id = next_client_id.fetch_add(1, std::memory_order_relaxed);
+    auto client_info = std::make_shared<ClientInfo>(client_id, file_descriptor, std::move(address));
+
+    std::lock_guard lock{mutex_};
+    clients_.emplace(client_id, client_info);
+    return client_info;
+}
+
+void ClientRegistry::remove(std::uint64_t client_id) {
+    std::lock_guard lock{mutex_};
+    clients_.erase(client_id);
+}
+
+std::shared_ptr<ClientInfo> ClientRegistry::find(std::uint64_t client_id) const {
+    std::lock_guard lock{mutex_};
+    const auto client = clients_.find(client_id);
+    return client != clients_.end() ? client->second : nullptr;
+}
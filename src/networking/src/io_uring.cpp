@@ -0,0 +1,232 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "io_uring.hpp"
+#include "socket_utils.hpp"
+
+namespace {
+int io_uring_setup(unsigned entries, io_uring_params *params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int ring_file_descriptor, unsigned to_submit, unsigned min_complete, unsigned flags,
+                   void *arg = nullptr, std::size_t arg_size = 0) {
+    return static_cast<int>(
+      syscall(__NR_io_uring_enter, ring_file_descriptor, to_submit, min_complete, flags, arg, arg_size));
+}
+
+int io_uring_register(int ring_file_descriptor, unsigned opcode, void *arg, unsigned number_of_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, ring_file_descriptor, opcode, arg, number_of_args));
+}
+
+void *map_ring(int ring_file_descriptor, std::size_t size, off_t offset) {
+    auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_file_descriptor, offset);
+    if (memory == MAP_FAILED) {
+        throw SocketException("Mapping the io_uring rings failed");
+    }
+
+    return memory;
+}
+} // namespace
+
+IOUring::IOUring(unsigned number_of_entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    // Leave room in the completion queue for the multishot operations which complete many times per submission.
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = number_of_entries * 4;
+
+    ring_file_descriptor_ = io_uring_setup(number_of_entries, &params);
+    if (ring_file_descriptor_ < 0) {
+        throw SocketException("io_uring_setup() failed");
+    }
+
+    has_ext_arg_ = (params.features & IORING_FEAT_EXT_ARG) != 0;
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+    // Since 5.4 both rings can share a single mapping.
+    const auto has_single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (has_single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = map_ring(ring_file_descriptor_, sq_ring_size_, IORING_OFF_SQ_RING);
+    cq_ring_ = has_single_mmap ? sq_ring_ : map_ring(ring_file_descriptor_, cq_ring_size_, IORING_OFF_CQ_RING);
+    sqes_ = static_cast<io_uring_sqe *>(map_ring(ring_file_descriptor_, sqes_size_, IORING_OFF_SQES));
+
+    auto sq_ring = static_cast<char *>(sq_ring_);
+    sq_head_pointer_ = reinterpret_cast<unsigned *>(sq_ring + params.sq_off.head);
+    sq_tail_pointer_ = reinterpret_cast<unsigned *>(sq_ring + params.sq_off.tail);
+    sq_array_ = reinterpret_cast<unsigned *>(sq_ring + params.sq_off.array);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq_ring + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sq_tail_ = sq_submitted_tail_ = *sq_tail_pointer_;
+
+    auto cq_ring = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq_ring + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq_ring + params.cq_off.tail);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq_ring + params.cq_off.cqes);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq_ring + params.cq_off.ring_mask);
+}
+
+IOUring::~IOUring() {
+    munmap(sqes_, sqes_size_);
+    if (cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    munmap(sq_ring_, sq_ring_size_);
+    close(ring_file_descriptor_);
+}
+
+io_uring_sqe *IOUring::get_sqe() {
+    const auto head = std::atomic_ref<unsigned>{*sq_head_pointer_}.load(std::memory_order_acquire);
+    if (sq_tail_ - head == sq_entries_) {
+        submit();
+    }
+
+    const auto index = sq_tail_ & sq_mask_;
+    auto sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    ++sq_tail_;
+    return sqe;
+}
+
+void IOUring::submit() {
+    if (sq_tail_ != sq_submitted_tail_) {
+        enter(0, 0);
+    }
+}
+
+void IOUring::wait(int timeout_ms) {
+    enter(1, timeout_ms);
+}
+
+void IOUring::enter(unsigned min_complete, int timeout_ms) {
+    const auto to_submit = sq_tail_ - sq_submitted_tail_;
+
+    // Publish the new entries to the kernel.
+    std::atomic_ref<unsigned>{*sq_tail_pointer_}.store(sq_tail_, std::memory_order_release);
+
+    auto flags = min_complete != 0 ? IORING_ENTER_GETEVENTS : 0u;
+    int submitted;
+    if (min_complete != 0 && timeout_ms >= 0 && has_ext_arg_) {
+        __kernel_timespec timeout{timeout_ms / 1000, (timeout_ms % 1000) * 1000000ll};
+        io_uring_getevents_arg arg;
+        std::memset(&arg, 0, sizeof(arg));
+        arg.ts = reinterpret_cast<std::uint64_t>(&timeout);
+        flags |= IORING_ENTER_EXT_ARG;
+        submitted = io_uring_enter(ring_file_descriptor_, to_submit, min_complete, flags, &arg, sizeof(arg));
+    } else {
+        // Without EXT_ARG (before 5.11) a limited wait is not possible, the caller has to be woken up instead.
+        submitted = io_uring_enter(ring_file_descriptor_, to_submit, min_complete, flags);
+    }
+
+    if (submitted < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY || errno == ETIME) {
+            return;
+        }
+
+        throw SocketException("io_uring_enter() failed");
+    }
+
+    sq_submitted_tail_ += submitted;
+}
+
+ProvidedBufferRing::ProvidedBufferRing(IOUring &io_uring, std::uint16_t group_id, std::uint16_t number_of_buffers,
+                                       std::size_t buffer_size)
+  : io_uring_{io_uring}, group_id_{group_id}, number_of_buffers_{number_of_buffers}, buffer_size_{buffer_size},
+    buffers_{new char[number_of_buffers * buffer_size]} {
+    if ((number_of_buffers & (number_of_buffers - 1)) != 0) {
+        throw std::invalid_argument("Number of buffers must be a power of two");
+    }
+
+    // Buffer rings exist since 5.19, older kernels get the buffers with IORING_OP_PROVIDE_BUFFERS.
+    if (register_ring()) {
+        return;
+    }
+
+    provide_buffers(0, number_of_buffers_);
+}
+
+ProvidedBufferRing::~ProvidedBufferRing() {
+    unregister_ring();
+}
+
+void ProvidedBufferRing::recycle(std::uint16_t buffer_id) {
+    if (ring_ == nullptr) {
+        provide_buffers(buffer_id, 1);
+        return;
+    }
+
+    // The entries are not accessed through bufs, in C++ the flexible array of the uapi header does not start at offset
+    // 0 of the ring as it follows an empty struct.
+    auto &buffer = reinterpret_cast<io_uring_buf *>(ring_)[tail_ & (number_of_buffers_ - 1)];
+    buffer.addr = reinterpret_cast<std::uint64_t>(buffers_.get() + buffer_id * buffer_size_);
+    buffer.len = static_cast<std::uint32_t>(buffer_size_);
+    buffer.bid = buffer_id;
+
+    // The tail shares its memory with the first buffer, the kernel only sees the new buffer once the tail is stored.
+    ++tail_;
+    std::atomic_ref<std::uint16_t>{ring_->tail}.store(tail_, std::memory_order_release);
+}
+
+bool ProvidedBufferRing::register_ring() {
+    // The ring itself has to be page aligned.
+    ring_size_ = number_of_buffers_ * sizeof(io_uring_buf);
+    auto ring_memory = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ring_memory == MAP_FAILED) {
+        return false;
+    }
+    ring_ = static_cast<io_uring_buf_ring *>(ring_memory);
+
+    io_uring_buf_reg registration;
+    std::memset(&registration, 0, sizeof(registration));
+    registration.ring_addr = reinterpret_cast<std::uint64_t>(ring_);
+    registration.ring_entries = number_of_buffers_;
+    registration.bgid = group_id_;
+
+    if (io_uring_register(io_uring_.get_file_descriptor(), IORING_REGISTER_PBUF_RING, &registration, 1) != 0) {
+        munmap(ring_, ring_size_);
+        ring_ = nullptr;
+        return false;
+    }
+
+    for (std::uint16_t buffer_id{0}; buffer_id < number_of_buffers_; ++buffer_id) {
+        recycle(buffer_id);
+    }
+
+    return true;
+}
+
+void ProvidedBufferRing::unregister_ring() {
+    if (ring_ == nullptr) {
+        return;
+    }
+
+    io_uring_buf_reg registration;
+    std::memset(&registration, 0, sizeof(registration));
+    registration.bgid = group_id_;
+    io_uring_register(io_uring_.get_file_descriptor(), IORING_UNREGISTER_PBUF_RING, &registration, 1);
+    munmap(ring_, ring_size_);
+    ring_ = nullptr;
+}
+
+void ProvidedBufferRing::provide_buffers(std::uint16_t first_buffer_id, std::uint16_t number_of_buffers) {
+    auto sqe = io_uring_.get_sqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = number_of_buffers;
+    sqe->addr = reinterpret_cast<std::uint64_t>(buffers_.get() + first_buffer_id * buffer_size_);
+    sqe->len = static_cast<std::uint32_t>(buffer_size_);
+    sqe->off = first_buffer_id;
+    sqe->buf_group = group_id_;
+    // The completion is not interesting, it is skipped unless providing the buffers failed.
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+}
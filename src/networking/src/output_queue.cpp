@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "output_queue.hpp"
+
+namespace {
+// Maximum number of chunks handed to the kernel in one call.
+constexpr std::size_t MAX_IO_VECTORS = 64;
+} // namespace
+
+OutputQueue::~OutputQueue() {
+    while (!chunks_.empty()) {
+        pop_front_chunk();
+    }
+}
+
+void OutputQueue::append(std::string_view data) {
+    while (!data.empty()) {
+        if (chunks_.empty() || chunks_.back().end == chunks_.back().capacity || chunks_.back().data == nullptr) {
+            const auto capacity =
+              BufferPool::chunk_size(std::clamp(data.size(), MIN_OUTPUT_CHUNK_SIZE, BufferPool::MAX_CHUNK_SIZE));
+            chunks_.push_back(Chunk{pool_.acquire(capacity), capacity});
+        }
+
+        auto &chunk = chunks_.back();
+        const auto bytes_to_copy = std::min(data.size(), chunk.capacity - chunk.end);
+        std::memcpy(chunk.data.get() + chunk.end, data.data(), bytes_to_copy);
+        chunk.end += bytes_to_copy;
+        size_ += bytes_to_copy;
+        data.remove_prefix(bytes_to_copy);
+    }
+}
+
+void OutputQueue::append_external(std::string_view data, std::shared_ptr<const void> owner) {
+    if (data.empty()) {
+        return;
+    }
+
+    Chunk chunk;
+    chunk.capacity = chunk.end = data.size();
+    chunk.external_data = data.data();
+    chunk.owner = std::move(owner);
+    chunks_.push_back(std::move(chunk));
+    size_ += data.size();
+}
+
+FlushResult OutputQueue::flush(int file_descriptor) noexcept {
+    std::array<iovec, MAX_IO_VECTORS> io_vectors;
+    auto can_use_zero_copy = is_zero_copy_enabled_;
+
+    while (!empty()) {
+        auto is_zero_copy = false;
+
+        // sendmsg() is the writev() of sockets which also accepts MSG_NOSIGNAL, a closed peer must not raise SIGPIPE.
+        msghdr message{};
+        message.msg_iov = io_vectors.data();
+        message.msg_iovlen = can_use_zero_copy ? get_chunks_to_send(io_vectors, is_zero_copy)
+                                               : get_pending_chunks(io_vectors);
+        const auto flags = MSG_DONTWAIT | MSG_NOSIGNAL | (is_zero_copy ? MSG_ZEROCOPY : 0);
+        const auto bytes_sent = sendmsg(file_descriptor, &message, flags);
+
+        if (bytes_sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            // The socket ran out of memory for pinning pages, the rest is copied.
+            if (errno == ENOBUFS && is_zero_copy) {
+                can_use_zero_copy = false;
+                continue;
+            }
+
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? FlushResult::would_block : FlushResult::error;
+        }
+
+        if (is_zero_copy) {
+            track_zero_copy_send(static_cast<std::size_t>(bytes_sent));
+        }
+        consume(static_cast<std::size_t>(bytes_sent));
+    }
+
+    return FlushResult::done;
+}
+
+void OutputQueue::handle_zero_copy_completions(int file_descriptor) noexcept {
+    while (!zero_copy_chunks_in_flight_.empty()) {
+        std::array<char, CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))> control;
+        msghdr message{};
+        message.msg_control = control.data();
+        message.msg_controllen = control.size();
+
+        if (recvmsg(file_descriptor, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+
+        for (auto header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header)) {
+            const auto is_error = (header->cmsg_level == SOL_IP && header->cmsg_type == IP_RECVERR) ||
+                                  (header->cmsg_level == SOL_IPV6 && header->cmsg_type == IPV6_RECVERR);
+            if (!is_error) {
+                continue;
+            }
+
+            sock_extended_err error;
+            std::memcpy(&error, CMSG_DATA(header), sizeof(error));
+            if (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY || error.ee_errno != 0) {
+                continue;
+            }
+
+            // The sends with an id in [ee_info, ee_data] are done, the range can wrap around.
+            std::erase_if(zero_copy_chunks_in_flight_, [&error](const auto &chunk) {
+                return chunk.id - error.ee_info <= error.ee_data - error.ee_info;
+            });
+        }
+    }
+}
+
+std::size_t OutputQueue::get_pending_chunks(std::span<iovec> io_vectors) const noexcept {
+    const auto number_of_io_vectors = std::min(chunks_.size(), io_vectors.size());
+    for (std::size_t idx{0}; idx < number_of_io_vectors; ++idx) {
+        const auto &chunk = chunks_[idx];
+        io_vectors[idx] = iovec{const_cast<char *>(chunk.get_data()) + chunk.begin, chunk.end - chunk.begin};
+    }
+
+    return number_of_io_vectors;
+}
+
+std::size_t OutputQueue::get_chunks_to_send(std::span<iovec> io_vectors, bool &is_zero_copy) const noexcept {
+    // Chunks of the pool are reused as soon as they are consumed, the kernel must not read them after the send
+    // returned. A call either sends external chunks with MSG_ZEROCOPY or chunks of the pool with a copy.
+    is_zero_copy = chunks_.front().data == nullptr;
+
+    const auto number_of_io_vectors = get_pending_chunks(io_vectors);
+    for (std::size_t idx{1}; idx < number_of_io_vectors; ++idx) {
+        if ((chunks_[idx].data == nullptr) != is_zero_copy) {
+            return idx;
+        }
+    }
+
+    return number_of_io_vectors;
+}
+
+void OutputQueue::track_zero_copy_send(std::size_t bytes_sent) {
+    const auto id = next_zero_copy_id_++;
+    for (std::size_t idx{0}; bytes_sent != 0; ++idx) {
+        const auto &chunk = chunks_[idx];
+        zero_copy_chunks_in_flight_.push_back({id, chunk.owner});
+        bytes_sent -= std::min(bytes_sent, chunk.end - chunk.begin);
+    }
+}
+
+void OutputQueue::consume(std::size_t number_of_bytes) noexcept {
+    size_ -= number_of_bytes;
+    while (number_of_bytes != 0) {
+        auto &chunk = chunks_.front();
+        const auto bytes_of_chunk = std::min(number_of_bytes, chunk.end - chunk.begin);
+        chunk.begin += bytes_of_chunk;
+        number_of_bytes -= bytes_of_chunk;
+
+        if (chunk.begin == chunk.end) {
+            pop_front_chunk();
+        }
+    }
+}
+
+void OutputQueue::pop_front_chunk() noexcept {
+    auto &chunk = chunks_.front();
+    if (chunk.data != nullptr) {
+        pool_.release(std::move(chunk.data), chunk.capacity);
+    }
+    chunks_.pop_front();
+}
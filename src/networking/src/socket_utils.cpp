@@ -4,12 +4,55 @@
 #include <stdexcept>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include "socket_utils.hpp"
 
 namespace {
 /// Represents the maximum number of pending / unaccepted TCP connections.
 constexpr int MAX_TCP_SERVER_BACKLOG = 1024;
+
+int create_unix_socket(const TCPSocketConfig &socket_config) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    const auto &path = socket_config.unix_socket_path;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Unix socket path is too long: " + path);
+    }
+    memcpy(address.sun_path, path.c_str(), path.size());
+
+    const auto socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_fd == INVALID_SOCKET) {
+        throw SocketException("socket() failed.");
+    }
+
+    if (!socket_config.is_blocking) {
+        if (!set_non_blocking(socket_fd)) {
+            throw SocketException("setNonBlocking() failed.");
+        }
+    }
+
+    if (!socket_config.is_listening) {
+        connect(socket_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address));
+        return socket_fd;
+    }
+
+    // A socket file of a previous run makes bind() fail.
+    unlink(path.c_str());
+
+    if (bind(socket_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == -1) {
+        throw SocketException("bind() failed.");
+    }
+
+    if (listen(socket_fd, MAX_TCP_SERVER_BACKLOG) != 0) {
+        throw SocketException("listen() failed.");
+    }
+
+    return socket_fd;
+}
 } // namespace
 
 bool set_non_blocking(int fd) {
@@ -20,8 +63,17 @@ bool set_non_blocking(int fd) {
     return (fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1);
 }
 
+bool set_zero_copy(int fd) {
+    const int one = 1;
+    return setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+}
+
 // Create TCPSocket with provided attributes to either listen-on / connect-to.
 [[nodiscard]] int create_socket(const TCPSocketConfig &socket_config) {
+    if (!socket_config.unix_socket_path.empty()) {
+        return create_unix_socket(socket_config);
+    }
+
     const int input_flags = (socket_config.is_listening ? AI_PASSIVE : 0) | AI_NUMERICHOST | AI_NUMERICSERV;
 
     struct addrinfo hints;
@@ -64,6 +116,15 @@ bool set_non_blocking(int fd) {
             throw SocketException("setsockopt() SO_REUSEADDR failed.");
         }
 
+        if (socket_config.reuse_port) {
+            return_code =
+              setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const char *>(&one), sizeof(one));
+
+            if (return_code == -1) {
+                throw SocketException("setsockopt() SO_REUSEPORT failed.");
+            }
+        }
+
         return_code = bind(socket_fd, result->ai_addr, result->ai_addrlen);
         if (return_code == -1) {
             throw SocketException("bind() failed.");
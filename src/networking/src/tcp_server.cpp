@@ -1,6 +1,9 @@
 #include <array>
+#include <cerrno>
 #include <iostream>
-#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 
 #include "tcp_server.hpp"
 
@@ -10,10 +13,12 @@ constexpr auto LISTENING_SOCKET = true;
 constexpr auto BLOCKING = false;
 constexpr auto NO_TIME_STAMP = false;
 
-std::array<epoll_event, 1024> events;
+// Write interest is only added while a socket has data that the kernel could not take yet.
+constexpr std::uint32_t READ_EVENTS = EPOLLET | EPOLLIN | EPOLLRDHUP;
+constexpr std::uint32_t READ_WRITE_EVENTS = READ_EVENTS | EPOLLOUT;
 
 void add_to_epoll_list(TCPSocket *socket, int epoll_file_descriptor) {
-    epoll_event ev{EPOLLET | EPOLLIN | EPOLLOUT, {reinterpret_cast<void *>(socket)}};
+    epoll_event ev{READ_EVENTS, {reinterpret_cast<void *>(socket)}};
 
     if (epoll_ctl(epoll_file_descriptor, EPOLL_CTL_ADD, socket->file_descriptor, &ev)) {
         throw SocketException("Failed to add to epoll list");
@@ -21,8 +26,50 @@ void add_to_epoll_list(TCPSocket *socket, int epoll_file_descriptor) {
 }
 } // namespace
 
-TCPServer::TCPServer(int listening_port)
-  : listening_socket_{TCPSocketConfig{LOCAL_HOST, listening_port, LISTENING_SOCKET, BLOCKING, NO_TIME_STAMP}} {
+TCPServer::TCPServer(int listening_port) : TCPServer{TCPServerConfig{listening_port}} {
+}
+
+TCPServer::TCPServer(const TCPServerConfig &config)
+  : is_zero_copy_enabled_{config.zero_copy}, output_buffer_limits_{config.output_buffer_limits},
+    listening_socket_{TCPSocketConfig{LOCAL_HOST,
+                                      config.listening_port,
+                                      LISTENING_SOCKET,
+                                      BLOCKING,
+                                      NO_TIME_STAMP,
+                                      config.reuse_port},
+                      buffer_pool_},
+    unix_socket_path_{config.unix_socket_path}, timer_wheel_{TimerWheel::Clock::now()},
+    idle_timeout_{config.idle_timeout} {
+    if (!unix_socket_path_.empty()) {
+        auto socket_config = TCPSocketConfig{};
+        socket_config.is_listening = LISTENING_SOCKET;
+        socket_config.is_blocking = BLOCKING;
+        socket_config.unix_socket_path = unix_socket_path_;
+        unix_listening_socket_ = std::make_unique<TCPSocket>(socket_config, buffer_pool_);
+    }
+
+    wake_up_file_descriptor_ = eventfd(0, EFD_CLOEXEC);
+    if (wake_up_file_descriptor_ < 0) {
+        throw SocketException("eventfd() failed");
+    }
+
+    setup_timer();
+
+    if (config.io_backend == IOBackend::io_uring) {
+        try {
+            setup_io_uring();
+            return;
+        } catch (const SocketException &exception) {
+            std::cout << "io_uring is not available, falling back to epoll: " << exception.what() << std::endl;
+            receive_buffer_ring_.reset();
+            io_uring_.reset();
+        }
+    }
+
+    setup_epoll();
+}
+
+void TCPServer::setup_epoll() {
     epoll_file_descriptor_ = epoll_create(1);
 
     if (epoll_file_descriptor_ < 0) {
@@ -30,60 +77,369 @@ TCPServer::TCPServer(int listening_port)
     }
 
     add_to_epoll_list(&listening_socket_, epoll_file_descriptor_);
+    if (unix_listening_socket_ != nullptr) {
+        add_to_epoll_list(unix_listening_socket_.get(), epoll_file_descriptor_);
+    }
+
+    // Level triggered so that a wake up which happens before the wait is not lost. It has no socket.
+    epoll_event ev{EPOLLIN, {nullptr}};
+    if (epoll_ctl(epoll_file_descriptor_, EPOLL_CTL_ADD, wake_up_file_descriptor_, &ev)) {
+        throw SocketException("Failed to add to epoll list");
+    }
+
+    // The timer is told apart from the sockets by the address of the wheel.
+    epoll_event timer_event{EPOLLIN, {&timer_wheel_}};
+    if (epoll_ctl(epoll_file_descriptor_, EPOLL_CTL_ADD, timer_file_descriptor_, &timer_event)) {
+        throw SocketException("Failed to add to epoll list");
+    }
+}
+
+void TCPServer::setup_timer() {
+    timer_file_descriptor_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_file_descriptor_ < 0) {
+        throw SocketException("timerfd_create() failed");
+    }
 }
 
 TCPServer::~TCPServer() {
-    close(epoll_file_descriptor_);
+    // The ring has to be gone before the event and timer file descriptors, it may still read from them.
+    receive_buffer_ring_.reset();
+    io_uring_.reset();
+
+    if (epoll_file_descriptor_ != -1) {
+        close(epoll_file_descriptor_);
+    }
+    close(wake_up_file_descriptor_);
+    close(timer_file_descriptor_);
+
+    if (unix_listening_socket_ != nullptr) {
+        unlink(unix_socket_path_.c_str());
+    }
 }
 
-void TCPServer::poll() {
-    const auto number_of_events = epoll_wait(epoll_file_descriptor_, events.data(), events.size(), 0);
+bool TCPServer::poll(int timeout_ms) {
+    if (io_uring_ != nullptr) {
+        return poll_io_uring(timeout_ms);
+    }
+
+    close_killed_clients();
+
+    const auto number_of_events = epoll_wait(epoll_file_descriptor_, events_.data(), events_.size(), timeout_ms);
     if (number_of_events < 0) {
+        if (errno == EINTR) {
+            return false;
+        }
+
         throw SocketException("Epoll wait failed");
     }
 
     for (int event_number{0}; event_number < number_of_events; ++event_number) {
-        auto &event = events[event_number];
+        auto &event = events_[event_number];
         auto socket = reinterpret_cast<TCPSocket *>(event.data.ptr);
 
-        // Can be read
-        if (event.events & EPOLLIN) {
-            if (socket == &listening_socket_) {
-                add_new_connections();
+        if (socket == nullptr) {
+            clear_wake_up();
+            continue;
+        }
+
+        if (event.data.ptr == &timer_wheel_) {
+            clear_timer();
+            run_timers();
+            continue;
+        }
+
+        if (socket == &listening_socket_ || socket == unix_listening_socket_.get()) {
+            add_new_connections(*socket);
+            continue;
+        }
+
+        if (socket->is_close_scheduled) {
+            continue;
+        }
+
+        // The error queue holds completions of zero copy sends.
+        if (event.events & EPOLLERR) {
+            socket->send_queue.handle_zero_copy_completions(socket->file_descriptor);
+        }
+
+        // Can be read. A peer which closed its side is read to the end before the socket is removed.
+        if ((event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && !socket->is_receive_paused) {
+            if (!is_receiving_paused_ && !socket->receive()) {
+                close_connection(socket);
                 continue;
-            } else {
-                const auto bytes_received = socket->receive();
-                if (bytes_received <= 0) {
-                    file_descriptor_to_socket_.erase(file_descriptor_to_socket_.find(socket->file_descriptor));
-                    receive_sockets_.erase(socket);
-                    epoll_ctl(epoll_file_descriptor_, EPOLL_CTL_DEL, socket->file_descriptor, &event);
-                    continue;
-                }
+            }
+            update_query_buffer_info(socket);
+
+            // Also when the callback paused receiving while the socket was read.
+            if (is_receiving_paused_) {
+                pause_socket_receiving(socket);
             }
         }
-        // Can send
+
+        // Can send again after the kernel send buffer was full.
         if (event.events & EPOLLOUT) {
-            receive_sockets_.insert(socket);
+            flush(socket);
         }
     }
 
-    std::for_each(receive_sockets_.begin(), receive_sockets_.end(), [](const auto &socket_ptr) { socket_ptr->send(); });
+    const auto did_callback_work = run_before_flush_callback();
+    close_scheduled_connections();
+    flush_sockets();
+    arm_timer();
+    return number_of_events > 0 || did_callback_work;
 }
 
-void TCPServer::enqueue_to_send_buffer(int client_file_descriptor, const std::string &message) {
-    if (auto client = file_descriptor_to_socket_.find(client_file_descriptor);
-        client != file_descriptor_to_socket_.end()) {
-        client->second->enqueue_to_send_buffer(message);
+bool TCPServer::run_before_flush_callback() {
+    return before_flush_callback != nullptr && before_flush_callback();
+}
+
+void TCPServer::wake_up() {
+    const std::uint64_t value{1};
+    [[maybe_unused]] const auto result = write(wake_up_file_descriptor_, &value, sizeof(value));
+}
+
+void TCPServer::clear_wake_up() {
+    [[maybe_unused]] const auto result = read(wake_up_file_descriptor_, &wake_up_counter_, sizeof(wake_up_counter_));
+}
+
+void TCPServer::clear_timer() {
+    [[maybe_unused]] const auto result =
+      read(timer_file_descriptor_, &timer_expirations_, sizeof(timer_expirations_));
+}
+
+TimerId TCPServer::add_timer(std::chrono::milliseconds delay, TimerWheel::Callback callback) {
+    const auto timer_id = timer_wheel_.schedule(TimerWheel::Clock::now() + delay, std::move(callback));
+    arm_timer();
+    return timer_id;
+}
+
+TimerId TCPServer::add_periodic_timer(std::chrono::milliseconds interval, TimerWheel::Callback callback) {
+    const auto timer_id = timer_wheel_.schedule(TimerWheel::Clock::now() + interval, std::move(callback), interval);
+    arm_timer();
+    return timer_id;
+}
+
+bool TCPServer::cancel_timer(TimerId timer_id) {
+    // The timer file descriptor stays armed, an early expiry only advances the wheel.
+    return timer_wheel_.cancel(timer_id);
+}
+
+void TCPServer::run_timers() {
+    // The file descriptor expired and is not armed anymore.
+    armed_timer_time_.reset();
+    timer_wheel_.advance(TimerWheel::Clock::now());
+    arm_timer();
+}
+
+void TCPServer::arm_timer() {
+    const auto next_advance_time = timer_wheel_.get_next_advance_time();
+    if (next_advance_time == armed_timer_time_) {
+        return;
+    }
+
+    // An absolute time on the monotonic clock, which is the clock of std::chrono::steady_clock. Zero disarms it.
+    itimerspec timer_spec{};
+    if (next_advance_time.has_value()) {
+        const auto time_since_epoch = next_advance_time->time_since_epoch();
+        const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(time_since_epoch);
+        timer_spec.it_value.tv_sec = seconds.count();
+        timer_spec.it_value.tv_nsec = std::chrono::nanoseconds{time_since_epoch - seconds}.count();
+    }
+
+    if (timerfd_settime(timer_file_descriptor_, TFD_TIMER_ABSTIME, &timer_spec, nullptr) != 0) {
+        throw SocketException("timerfd_settime() failed");
+    }
+    armed_timer_time_ = next_advance_time;
+}
+
+void TCPServer::schedule_idle_timeout(TCPSocket *socket, TimerWheel::Clock::duration delay) {
+    socket->idle_timer_id =
+      timer_wheel_.schedule(TimerWheel::Clock::now() + delay, [this, socket]() { check_idle_timeout(socket); });
+}
+
+void TCPServer::check_idle_timeout(TCPSocket *socket) {
+    socket->idle_timer_id = TimerWheel::INVALID_TIMER_ID;
+    if (socket->is_closing || socket->is_close_scheduled) {
+        return;
+    }
+
+    // The time of the last request is only looked at when the timer expires, a request does not move the timer.
+    const auto last_interaction = TimerWheel::Clock::time_point{
+      std::chrono::nanoseconds{socket->client_info->last_interaction_ns.load(std::memory_order_relaxed)}};
+    const auto idle_duration = TimerWheel::Clock::now() - last_interaction;
+    if (idle_duration < idle_timeout_) {
+        schedule_idle_timeout(socket, idle_timeout_ - idle_duration);
+        return;
+    }
+
+    std::cout << "Closing client id=" << socket->client_info->id << " addr=" << socket->client_info->address
+              << " after being idle for " << std::chrono::duration_cast<std::chrono::seconds>(idle_duration).count()
+              << " s" << std::endl;
+    number_of_idle_timeout_disconnections_.fetch_add(1, std::memory_order_relaxed);
+    schedule_close(socket);
+}
+
+void TCPServer::enqueue_to_send_buffer(int client_file_descriptor, std::string_view message) {
+    auto socket = get_socket_to_send_to(client_file_descriptor);
+    if (socket == nullptr) {
+        return;
+    }
+
+    if (has_exceeded_output_buffer_limit(socket, message.size())) {
+        disconnect_for_output_buffer_limit(socket);
+        return;
+    }
+
+    socket->enqueue_to_send_buffer(message);
+    update_output_buffer_info(socket);
+    schedule_flush(socket);
+}
+
+void TCPServer::enqueue_to_send_buffer(int client_file_descriptor,
+                                       std::string_view data,
+                                       std::shared_ptr<const void> owner) {
+    auto socket = get_socket_to_send_to(client_file_descriptor);
+    if (socket == nullptr) {
+        return;
     }
+
+    if (has_exceeded_output_buffer_limit(socket, data.size())) {
+        disconnect_for_output_buffer_limit(socket);
+        return;
+    }
+
+    socket->enqueue_to_send_buffer(data, std::move(owner));
+    update_output_buffer_info(socket);
+    schedule_flush(socket);
 }
 
-void TCPServer::add_new_connections() {
+bool TCPServer::kill_client(std::uint64_t client_id) {
+    const auto client_info = client_registry_.find(client_id);
+    if (client_info == nullptr) {
+        return false;
+    }
+
+    client_info->is_kill_requested = true;
+    has_kill_requests_ = true;
+    wake_up();
+    return true;
+}
+
+void TCPServer::register_client(TCPSocket *socket) {
+    sockaddr_storage address;
+    socklen_t address_length = sizeof(address);
+    std::string peer_address;
+
+    if (getpeername(socket->file_descriptor, reinterpret_cast<sockaddr *>(&address), &address_length) == 0) {
+        if (address.ss_family == AF_INET) {
+            const auto &ipv4_address = reinterpret_cast<const sockaddr_in &>(address);
+            std::array<char, INET_ADDRSTRLEN> ip;
+            inet_ntop(AF_INET, &ipv4_address.sin_addr, ip.data(), ip.size());
+            peer_address = std::string{ip.data()} + ":" + std::to_string(ntohs(ipv4_address.sin_port));
+        } else if (address.ss_family == AF_UNIX) {
+            // The clients of a Unix domain socket are unnamed, they are listed with the path of the server.
+            peer_address = unix_socket_path_ + ":0";
+        }
+    }
+
+    socket->client_info = client_registry_.add(socket->file_descriptor, std::move(peer_address));
+}
+
+TCPSocket *TCPServer::get_socket_to_send_to(int client_file_descriptor) {
+    const auto client = file_descriptor_to_socket_.find(client_file_descriptor);
+    if (client == file_descriptor_to_socket_.end() || client->second->is_closing ||
+        client->second->is_close_scheduled) {
+        return nullptr;
+    }
+
+    return client->second.get();
+}
+
+bool TCPServer::has_exceeded_output_buffer_limit(TCPSocket *socket, std::size_t bytes_to_add) {
+    const auto client_class = socket->client_info->client_class.load(std::memory_order_relaxed);
+    const auto &limit = output_buffer_limits_[static_cast<std::size_t>(client_class)];
+    const auto output_buffer_bytes = socket->send_queue.size() + bytes_to_add;
+
+    if (limit.hard_limit_bytes != 0 && output_buffer_bytes > limit.hard_limit_bytes) {
+        return true;
+    }
+
+    if (limit.soft_limit_bytes == 0 || output_buffer_bytes <= limit.soft_limit_bytes) {
+        socket->soft_output_limit_reached_at = {};
+        return false;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (socket->soft_output_limit_reached_at == std::chrono::steady_clock::time_point{}) {
+        socket->soft_output_limit_reached_at = now;
+    }
+
+    return now - socket->soft_output_limit_reached_at >= limit.soft_limit_duration;
+}
+
+void TCPServer::disconnect_for_output_buffer_limit(TCPSocket *socket) {
+    const auto &client_info = *socket->client_info;
+    std::cout << "Closing client id=" << client_info.id << " addr=" << client_info.address
+              << " for exceeding its output buffer limit (" << socket->send_queue.size() << " bytes pending)"
+              << std::endl;
+
+    number_of_output_buffer_limit_disconnections_.fetch_add(1, std::memory_order_relaxed);
+    schedule_close(socket);
+}
+
+void TCPServer::update_query_buffer_info(TCPSocket *socket) {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    auto &client_info = *socket->client_info;
+    client_info.query_buffer_bytes.store(socket->next_valid_receive_index, std::memory_order_relaxed);
+    client_info.query_buffer_capacity.store(socket->receive_buffer.size(), std::memory_order_relaxed);
+    client_info.last_interaction_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(),
+                                          std::memory_order_relaxed);
+}
+
+void TCPServer::update_output_buffer_info(TCPSocket *socket) {
+    socket->client_info->output_buffer_bytes.store(socket->send_queue.size(), std::memory_order_relaxed);
+}
+
+void TCPServer::schedule_flush(TCPSocket *socket) {
+    if (!socket->is_flush_scheduled) {
+        socket->is_flush_scheduled = true;
+        sockets_to_flush_.push_back(socket);
+    }
+}
+
+void TCPServer::schedule_close(TCPSocket *socket) {
+    if (!socket->is_close_scheduled) {
+        socket->is_close_scheduled = true;
+        sockets_to_close_.push_back(socket);
+    }
+}
+
+void TCPServer::close_killed_clients() {
+    if (!has_kill_requests_.exchange(false)) {
+        return;
+    }
+
+    for (const auto &[file_descriptor, socket] : file_descriptor_to_socket_) {
+        if (socket->client_info->is_kill_requested) {
+            schedule_close(socket.get());
+        }
+    }
+}
+
+void TCPServer::close_scheduled_connections() {
+    // Closing a socket removes it from the list.
+    while (!sockets_to_close_.empty()) {
+        close_connection(sockets_to_close_.back());
+    }
+}
+
+void TCPServer::add_new_connections(TCPSocket &listening_socket) {
     for (;;) {
         struct sockaddr_storage client_address;
         socklen_t client_len = sizeof(client_address);
 
         const auto client_file_descriptor =
-          accept(listening_socket_.file_descriptor, (struct sockaddr *)&client_address, &client_len);
+          accept(listening_socket.file_descriptor, (struct sockaddr *)&client_address, &client_len);
         if (client_file_descriptor == INVALID_SOCKET) {
             break;
         }
@@ -93,9 +449,150 @@ void TCPServer::add_new_connections() {
             throw SocketException("setNonBlocking() failed.");
         }
 
-        auto socket = std::make_unique<TCPSocket>(client_file_descriptor);
+        auto socket = std::make_unique<TCPSocket>(client_file_descriptor, buffer_pool_);
         socket->receive_callback = receive_callback;
+        socket->is_server_receiving_paused = &is_receiving_paused_;
+        register_client(socket.get());
+        if (idle_timeout_ != std::chrono::milliseconds::zero()) {
+            schedule_idle_timeout(socket.get(), idle_timeout_);
+        }
+        // Fails on Unix domain sockets, their sends are always copied.
+        if (is_zero_copy_enabled_ && set_zero_copy(client_file_descriptor)) {
+            socket->send_queue.enable_zero_copy();
+        }
         add_to_epoll_list(socket.get(), epoll_file_descriptor_);
         file_descriptor_to_socket_.emplace(client_file_descriptor, std::move(socket));
     }
 }
+
+void TCPServer::flush_sockets() {
+    // The lists are swapped so that their capacity is reused by the next poll.
+    std::swap(sockets_to_flush_, sockets_being_flushed_);
+
+    for (auto socket : sockets_being_flushed_) {
+        socket->is_flush_scheduled = false;
+
+        if (io_uring_ != nullptr) {
+            submit_sends(socket);
+        } else {
+            flush(socket);
+        }
+    }
+
+    sockets_being_flushed_.clear();
+}
+
+void TCPServer::flush(TCPSocket *socket) {
+    const auto result = socket->send();
+    update_output_buffer_info(socket);
+
+    switch (result) {
+    case FlushResult::done:
+        if (socket->is_waiting_for_write) {
+            set_waiting_for_write(socket, false);
+        }
+        break;
+    case FlushResult::would_block:
+        if (!socket->is_waiting_for_write) {
+            set_waiting_for_write(socket, true);
+        }
+        break;
+    case FlushResult::error:
+        close_connection(socket);
+        break;
+    }
+}
+
+void TCPServer::set_waiting_for_write(TCPSocket *socket, bool is_waiting_for_write) {
+    socket->is_waiting_for_write = is_waiting_for_write;
+    update_epoll_events(socket);
+}
+
+void TCPServer::update_epoll_events(TCPSocket *socket) {
+    // A socket whose receiving is paused only waits for the kernel send buffer. Errors and hang ups are always
+    // reported, they are handled once it is read again.
+    auto events = socket->is_receive_paused ? std::uint32_t{EPOLLET} : READ_EVENTS;
+    if (socket->is_waiting_for_write) {
+        events |= EPOLLOUT;
+    }
+
+    epoll_event ev{events, {reinterpret_cast<void *>(socket)}};
+    if (epoll_ctl(epoll_file_descriptor_, EPOLL_CTL_MOD, socket->file_descriptor, &ev)) {
+        throw SocketException("Failed to modify epoll list");
+    }
+}
+
+void TCPServer::pause_receiving() {
+    is_receiving_paused_ = true;
+}
+
+void TCPServer::resume_receiving() {
+    is_receiving_paused_ = false;
+    for (auto *socket : sockets_with_paused_receiving_) {
+        socket->is_receive_paused = false;
+        if (io_uring_ != nullptr) {
+            // The cancelled receive may not have ended yet, it is restarted when it does.
+            if (!socket->is_receive_armed && !socket->is_closing) {
+                submit_receive(socket);
+            }
+        } else {
+            // Modifying the interest reports the socket again when it has something to read.
+            update_epoll_events(socket);
+        }
+    }
+    sockets_with_paused_receiving_.clear();
+}
+
+void TCPServer::pause_socket_receiving(TCPSocket *socket) {
+    if (socket->is_receive_paused || socket->is_closing) {
+        return;
+    }
+
+    socket->is_receive_paused = true;
+    sockets_with_paused_receiving_.push_back(socket);
+    if (io_uring_ != nullptr) {
+        submit_receive_cancel(socket);
+    } else {
+        update_epoll_events(socket);
+    }
+}
+
+void TCPServer::close_connection(TCPSocket *socket) {
+    if (socket->is_flush_scheduled) {
+        socket->is_flush_scheduled = false;
+        std::erase(sockets_to_flush_, socket);
+    }
+
+    if (socket->is_close_scheduled) {
+        socket->is_close_scheduled = false;
+        std::erase(sockets_to_close_, socket);
+    }
+
+    if (socket->is_receive_paused) {
+        socket->is_receive_paused = false;
+        std::erase(sockets_with_paused_receiving_, socket);
+    }
+
+    if (io_uring_ != nullptr) {
+        // The kernel still owns operations of the socket. Shutting it down makes them complete, the socket is
+        // destroyed once the last one is done.
+        if (socket->number_of_pending_operations != 0) {
+            if (!socket->is_closing) {
+                socket->is_closing = true;
+                shutdown(socket->file_descriptor, SHUT_RDWR);
+            }
+            return;
+        }
+    } else {
+        epoll_ctl(epoll_file_descriptor_, EPOLL_CTL_DEL, socket->file_descriptor, nullptr);
+    }
+
+    if (socket->idle_timer_id != TimerWheel::INVALID_TIMER_ID) {
+        timer_wheel_.cancel(socket->idle_timer_id);
+    }
+    client_registry_.remove(socket->client_info->id);
+
+    // Destroys the socket which closes its file descriptor.
+    const auto file_descriptor = socket->file_descriptor;
+    file_descriptor_to_socket_.erase(file_descriptor);
+}
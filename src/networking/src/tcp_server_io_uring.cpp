@@ -0,0 +1,286 @@
+#include <array>
+#include <cerrno>
+#include <iostream>
+#include <sys/socket.h>
+
+#include "tcp_server.hpp"
+
+namespace {
+// Number of submission queue entries of the ring.
+constexpr unsigned IO_URING_ENTRIES = 1024;
+
+// Received bytes land in one of these buffers before they are copied to the receive buffer of the socket.
+constexpr std::uint16_t RECEIVE_BUFFER_GROUP_ID = 0;
+constexpr std::uint16_t NUMBER_OF_RECEIVE_BUFFERS = 256;
+constexpr std::size_t RECEIVE_BUFFER_SIZE = 16 * 1024;
+
+// Maximum number of chunks of the send queue which are sent by one chain of linked sends.
+constexpr std::size_t MAX_LINKED_SENDS = 16;
+
+// The operation is stored in the lowest bits of the user data, the rest is the socket it belongs to.
+enum class Operation : std::uint64_t { accept = 1, receive = 2, send = 3, wake_up = 4, timer = 5, cancel = 6 };
+constexpr std::uint64_t OPERATION_MASK = 0b111;
+
+std::uint64_t to_user_data(TCPSocket *socket, Operation operation) {
+    return reinterpret_cast<std::uint64_t>(socket) | static_cast<std::uint64_t>(operation);
+}
+
+TCPSocket *get_socket(const io_uring_cqe &completion) {
+    return reinterpret_cast<TCPSocket *>(completion.user_data & ~OPERATION_MASK);
+}
+
+Operation get_operation(const io_uring_cqe &completion) {
+    return static_cast<Operation>(completion.user_data & OPERATION_MASK);
+}
+
+bool has_more_completions(const io_uring_cqe &completion) {
+    return (completion.flags & IORING_CQE_F_MORE) != 0;
+}
+} // namespace
+
+void TCPServer::setup_io_uring() {
+    io_uring_ = std::make_unique<IOUring>(IO_URING_ENTRIES);
+    receive_buffer_ring_ = std::make_unique<ProvidedBufferRing>(
+      *io_uring_, RECEIVE_BUFFER_GROUP_ID, NUMBER_OF_RECEIVE_BUFFERS, RECEIVE_BUFFER_SIZE);
+    submit_accept(listening_socket_);
+    if (unix_listening_socket_ != nullptr) {
+        submit_accept(*unix_listening_socket_);
+    }
+    submit_wake_up_read();
+    submit_timer_read();
+    io_uring_->submit();
+}
+
+bool TCPServer::poll_io_uring(int timeout_ms) {
+    const auto handle_completion = [this](const io_uring_cqe &completion) { this->handle_completion(completion); };
+
+    // Completions are read from the shared ring, there is no system call unless new operations have to be submitted.
+    close_killed_clients();
+
+    auto number_of_completions = io_uring_->for_each_cqe(handle_completion);
+    if (number_of_completions == 0 && timeout_ms != 0) {
+        io_uring_->wait(timeout_ms);
+        number_of_completions = io_uring_->for_each_cqe(handle_completion);
+    }
+
+    const auto did_callback_work = run_before_flush_callback();
+    close_scheduled_connections();
+    flush_sockets();
+    arm_timer();
+
+    // Everything queued during this poll (new receives, sends of the responses) goes to the kernel in one batch.
+    io_uring_->submit();
+    return number_of_completions != 0 || did_callback_work;
+}
+
+void TCPServer::handle_completion(const io_uring_cqe &completion) {
+    auto socket = get_socket(completion);
+
+    switch (get_operation(completion)) {
+    case Operation::accept:
+        handle_accept_completion(*socket, completion);
+        break;
+    case Operation::receive:
+        handle_receive_completion(socket, completion);
+        break;
+    case Operation::send:
+        handle_send_completion(socket, completion);
+        break;
+    case Operation::wake_up:
+        handle_wake_up_completion(completion);
+        break;
+    case Operation::timer:
+        handle_timer_completion(completion);
+        break;
+    case Operation::cancel:
+        // The cancelled receive completes on its own.
+        finish_operation(socket);
+        break;
+    }
+}
+
+void TCPServer::handle_accept_completion(TCPSocket &listening_socket, const io_uring_cqe &completion) {
+    // The multishot accept stopped, e.g. because of an error. Start a new one.
+    if (!has_more_completions(completion)) {
+        submit_accept(listening_socket);
+    }
+
+    if (completion.res < 0) {
+        return;
+    }
+
+    const auto client_file_descriptor = completion.res;
+    std::cout << "There is a new connection" << std::endl;
+
+    auto socket = std::make_unique<TCPSocket>(client_file_descriptor, buffer_pool_);
+    socket->receive_callback = receive_callback;
+    register_client(socket.get());
+    if (idle_timeout_ != std::chrono::milliseconds::zero()) {
+        schedule_idle_timeout(socket.get(), idle_timeout_);
+    }
+    submit_receive(socket.get());
+    file_descriptor_to_socket_.emplace(client_file_descriptor, std::move(socket));
+}
+
+void TCPServer::handle_receive_completion(TCPSocket *socket, const io_uring_cqe &completion) {
+    auto is_connection_alive = completion.res > 0 || completion.res == -ENOBUFS || completion.res == -ECANCELED;
+
+    if (completion.flags & IORING_CQE_F_BUFFER) {
+        const auto buffer_id = static_cast<std::uint16_t>(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+
+        if (completion.res > 0 && !socket->is_closing && !socket->is_close_scheduled) {
+            const auto data = receive_buffer_ring_->get_buffer(buffer_id, static_cast<std::size_t>(completion.res));
+            is_connection_alive = socket->append_received_data(data);
+            update_query_buffer_info(socket);
+        }
+
+        receive_buffer_ring_->recycle(buffer_id);
+    }
+
+    const auto has_more = has_more_completions(completion);
+    if (!has_more) {
+        socket->is_receive_armed = false;
+    }
+
+    if (is_receiving_paused_ && is_connection_alive) {
+        pause_socket_receiving(socket);
+    }
+
+    if (has_more) {
+        if (!is_connection_alive) {
+            close_connection(socket);
+        }
+        return;
+    }
+
+    // The multishot receive ended. It is restarted unless the connection is gone (ENOBUFS only means that all the
+    // provided buffers were in use, ECANCELED that receiving was paused). A paused socket is restarted on resume.
+    if (is_connection_alive && !socket->is_closing) {
+        if (!socket->is_receive_paused) {
+            submit_receive(socket);
+        }
+    } else {
+        close_connection(socket);
+    }
+
+    finish_operation(socket);
+}
+
+void TCPServer::handle_send_completion(TCPSocket *socket, const io_uring_cqe &completion) {
+    --socket->number_of_sends_in_flight;
+
+    // A short send cancels the rest of the chain (ECANCELED), those bytes are sent again by the next chain.
+    if (completion.res > 0) {
+        socket->send_queue.consume(static_cast<std::size_t>(completion.res));
+        update_output_buffer_info(socket);
+    } else if (completion.res < 0 && completion.res != -ECANCELED) {
+        close_connection(socket);
+    }
+
+    if (socket->number_of_sends_in_flight == 0 && !socket->is_closing) {
+        submit_sends(socket);
+    }
+
+    finish_operation(socket);
+}
+
+void TCPServer::handle_wake_up_completion(const io_uring_cqe &completion) {
+    // The read reset the event file descriptor, wait for the next wake up.
+    if (completion.res >= 0 || completion.res == -EINTR) {
+        submit_wake_up_read();
+    }
+}
+
+void TCPServer::handle_timer_completion(const io_uring_cqe &completion) {
+    // Same as for the wake ups, the read reset the timer file descriptor.
+    if (completion.res >= 0 || completion.res == -EINTR) {
+        submit_timer_read();
+    }
+
+    run_timers();
+}
+
+void TCPServer::submit_accept(TCPSocket &listening_socket) {
+    auto sqe = io_uring_->get_sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listening_socket.file_descriptor;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = to_user_data(&listening_socket, Operation::accept);
+}
+
+void TCPServer::submit_receive(TCPSocket *socket) {
+    auto sqe = io_uring_->get_sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = socket->file_descriptor;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = receive_buffer_ring_->get_group_id();
+    sqe->user_data = to_user_data(socket, Operation::receive);
+    ++socket->number_of_pending_operations;
+    socket->is_receive_armed = true;
+}
+
+void TCPServer::submit_receive_cancel(TCPSocket *socket) {
+    if (!socket->is_receive_armed) {
+        return;
+    }
+
+    auto sqe = io_uring_->get_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = to_user_data(socket, Operation::receive);
+    sqe->user_data = to_user_data(socket, Operation::cancel);
+    ++socket->number_of_pending_operations;
+}
+
+void TCPServer::submit_sends(TCPSocket *socket) {
+    // Only one chain per socket is in flight, otherwise bytes could be sent twice or out of order.
+    if (socket->number_of_sends_in_flight != 0 || socket->send_queue.empty()) {
+        return;
+    }
+
+    std::array<iovec, MAX_LINKED_SENDS> chunks;
+    const auto number_of_chunks = socket->send_queue.get_pending_chunks(chunks);
+
+    // The sends of a chain are executed one after the other in the order of submission.
+    for (std::size_t idx{0}; idx < number_of_chunks; ++idx) {
+        auto sqe = io_uring_->get_sqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = socket->file_descriptor;
+        sqe->addr = reinterpret_cast<std::uint64_t>(chunks[idx].iov_base);
+        sqe->len = static_cast<std::uint32_t>(chunks[idx].iov_len);
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        sqe->user_data = to_user_data(socket, Operation::send);
+        if (idx + 1 != number_of_chunks) {
+            sqe->flags = IOSQE_IO_LINK;
+        }
+    }
+
+    socket->number_of_sends_in_flight = number_of_chunks;
+    socket->number_of_pending_operations += number_of_chunks;
+}
+
+void TCPServer::submit_wake_up_read() {
+    auto sqe = io_uring_->get_sqe();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wake_up_file_descriptor_;
+    sqe->addr = reinterpret_cast<std::uint64_t>(&wake_up_counter_);
+    sqe->len = sizeof(wake_up_counter_);
+    sqe->user_data = to_user_data(nullptr, Operation::wake_up);
+}
+
+void TCPServer::submit_timer_read() {
+    auto sqe = io_uring_->get_sqe();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = timer_file_descriptor_;
+    sqe->addr = reinterpret_cast<std::uint64_t>(&timer_expirations_);
+    sqe->len = sizeof(timer_expirations_);
+    sqe->user_data = to_user_data(nullptr, Operation::timer);
+}
+
+void TCPServer::finish_operation(TCPSocket *socket) {
+    --socket->number_of_pending_operations;
+
+    if (socket->is_closing && socket->number_of_pending_operations == 0) {
+        close_connection(socket);
+    }
+}
@@ -1,67 +1,143 @@
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <iostream>
-#include <stdexcept>
 #include <unistd.h>
 
 #include "tcp_socket.hpp"
 
-namespace {
-// Size of our send and receive buffers in bytes.
-constexpr std::size_t TCP_BUFFER_SIZE = 64 * 1024 * 1024;
-} // namespace
-
-TCPSocket::TCPSocket(const TCPSocketConfig &socket_config)
-  : receive_buffer(TCP_BUFFER_SIZE), send_buffer(TCP_BUFFER_SIZE) {
+TCPSocket::TCPSocket(const TCPSocketConfig &socket_config, BufferPool &buffer_pool)
+  : receive_buffer{buffer_pool}, send_queue{buffer_pool} {
     file_descriptor = create_socket(socket_config);
 }
 
-TCPSocket::TCPSocket(int file_descriptor)
-  : file_descriptor{file_descriptor}, receive_buffer(TCP_BUFFER_SIZE), send_buffer(TCP_BUFFER_SIZE) {
+TCPSocket::TCPSocket(int file_descriptor, BufferPool &buffer_pool)
+  : file_descriptor{file_descriptor}, receive_buffer{buffer_pool}, send_queue{buffer_pool} {
 }
 
-int TCPSocket::receive() noexcept {
-    const auto bytes_received = recv(
-      file_descriptor, receive_buffer.data() + next_valid_receive_index, TCP_BUFFER_SIZE - next_valid_receive_index, 0);
+bool TCPSocket::receive() noexcept {
+    std::size_t total_bytes_received{0};
+    auto is_connection_alive = true;
+
+    // The socket is edge triggered, everything has to be read now as there will be no new event for it.
+    for (;;) {
+        // A full buffer is handed to the callback before it grows, the callback may take bytes out of it.
+        if (next_valid_receive_index == receive_buffer.size() && total_bytes_received != 0) {
+            deliver_received_data();
+            total_bytes_received = 0;
+        }
+
+        // The callback paused receiving, the rest of the bytes stay in the kernel until it is resumed.
+        if (is_server_receiving_paused != nullptr && *is_server_receiving_paused) {
+            break;
+        }
+
+        // Grow the buffer when it is still full. If it already has the size of the largest chunk of the pool, let the
+        // callback consume the pending bytes first.
+        if (!receive_buffer.reserve(next_valid_receive_index + 1, next_valid_receive_index)) {
+            deliver_received_data();
+            total_bytes_received = 0;
+
+            if (next_valid_receive_index == receive_buffer.size()) {
+                is_connection_alive = false;
+                break;
+            }
+        }
+
+        const auto bytes_received = recv(file_descriptor,
+                                         receive_buffer.data() + next_valid_receive_index,
+                                         receive_buffer.size() - next_valid_receive_index,
+                                         0);
+
+        if (bytes_received > 0) {
+            next_valid_receive_index += bytes_received;
+            total_bytes_received += bytes_received;
+            continue;
+        }
 
-    if (bytes_received <= 0) {
-        return bytes_received;
+        if (bytes_received < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (bytes_received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+
+        // Closed by the peer or failed.
+        is_connection_alive = false;
+        break;
+    }
+
+    if (total_bytes_received != 0) {
+        deliver_received_data();
     }
 
-    // std::cout << bytes_received << " bytes received:\n"
-    //           << std::string{receive_buffer.data() + next_valid_receive_index,
-    //                          receive_buffer.data() + next_valid_receive_index + bytes_received}
-    //           << std::endl;
+    // The whole message is consumed, the connection does not need to hold any memory while it is idle.
+    if (next_valid_receive_index == 0) {
+        receive_buffer.release();
+    }
 
-    next_valid_receive_index += bytes_received;
+    return is_connection_alive;
+}
 
+bool TCPSocket::append_received_data(std::string_view data) noexcept {
+    while (!data.empty()) {
+        // A full buffer is handed to the callback before it grows, the callback may take bytes out of it.
+        if (next_valid_receive_index != 0 && next_valid_receive_index == receive_buffer.size()) {
+            deliver_received_data();
+        }
+
+        receive_buffer.reserve(std::min(next_valid_receive_index + data.size(), BufferPool::MAX_CHUNK_SIZE),
+                               next_valid_receive_index);
+
+        const auto bytes_to_copy = std::min(data.size(), receive_buffer.size() - next_valid_receive_index);
+        if (bytes_to_copy == 0) {
+            // The buffer reached its maximum size, let the callback consume the pending bytes first.
+            deliver_received_data();
+            if (next_valid_receive_index == receive_buffer.size()) {
+                return false;
+            }
+            continue;
+        }
+
+        std::memcpy(receive_buffer.data() + next_valid_receive_index, data.data(), bytes_to_copy);
+        next_valid_receive_index += bytes_to_copy;
+        data.remove_prefix(bytes_to_copy);
+    }
+
+    deliver_received_data();
+    if (next_valid_receive_index == 0) {
+        receive_buffer.release();
+    }
+
+    return true;
+}
+
+void TCPSocket::deliver_received_data() noexcept {
     if (receive_callback != nullptr) {
         receive_callback(this);
     } else {
         std::cout << "No callback is set printing the received message:" << std::endl;
     }
-
-    return bytes_received;
 }
 
-void TCPSocket::send() noexcept {
-    auto message = std::string(send_buffer.data(), next_valid_send_index);
-    ::send(file_descriptor, send_buffer.data(), next_valid_send_index, MSG_DONTWAIT | MSG_NOSIGNAL);
-    next_valid_send_index = 0;
+FlushResult TCPSocket::send() noexcept {
+    return send_queue.flush(file_descriptor);
 }
 
-void TCPSocket::enqueue_to_send_buffer(const std::string &message) {
-    const auto buffer_size = send_buffer.size() - next_valid_send_index;
-    if (message.size() > buffer_size) {
-        throw std::overflow_error("Send buffer is full");
-    }
+void TCPSocket::enqueue_to_send_buffer(std::string_view message) {
+    // The message is built by another thread, which cannot write to the queue. It is packed into the current chunk
+    // with the other pending replies.
+    send_queue.append(message);
+}
 
-    // TODO Extra copy (message can be written to the send buffer directly)
-    std::copy(message.begin(), message.end(), send_buffer.begin() + next_valid_send_index);
-    next_valid_send_index = message.size();
-    auto message_ = std::string(send_buffer.data(), next_valid_send_index);
+void TCPSocket::enqueue_to_send_buffer(std::string_view data, std::shared_ptr<const void> owner) {
+    send_queue.append_external(data, std::move(owner));
 }
 
 TCPSocket::~TCPSocket() {
+    // Zero copy sends still in flight are released together with the send queue. The kernel pins the pages it sends
+    // from, once the connection is gone their content does not matter anymore.
     if (file_descriptor != -1) {
         close(file_descriptor);
     }
@@ -0,0 +1,86 @@
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include "buffer_pool.hpp"
+
+namespace {
+
+void write(PooledBuffer &buffer, std::string_view data) {
+    buffer.reserve(data.size(), 0);
+    std::memcpy(buffer.data(), data.data(), data.size());
+}
+
+} // namespace
+
+TEST(PooledBuffer, takenBytesAreNotCopiedAndTheRestIsKept) {
+    BufferPool pool;
+    PooledBuffer buffer{pool};
+    write(buffer, "*1\r\n$4\r\nPING\r\n*1\r\n$4");
+    const auto *chunk = buffer.data();
+
+    const auto slice = buffer.take_front(14, 20);
+
+    EXPECT_EQ(slice.view(), "*1\r\n$4\r\nPING\r\n");
+    EXPECT_EQ(slice.view().data(), chunk);
+    EXPECT_EQ(std::string_view(buffer.data(), 6), "*1\r\n$4");
+    EXPECT_EQ(buffer.size(), BufferPool::MIN_CHUNK_SIZE);
+    EXPECT_EQ(pool.get_stats().bytes_in_use, 2 * BufferPool::MIN_CHUNK_SIZE);
+}
+
+TEST(PooledBuffer, bufferHoldsNoChunkWhenEverythingIsTaken) {
+    BufferPool pool;
+    PooledBuffer buffer{pool};
+    write(buffer, "*1\r\n$4\r\nPING\r\n");
+
+    auto slice = buffer.take_front(14, 14);
+
+    EXPECT_EQ(buffer.size(), 0);
+    EXPECT_EQ(pool.get_stats().bytes_in_use, BufferPool::MIN_CHUNK_SIZE);
+
+    slice.reset();
+    EXPECT_TRUE(slice.view().empty());
+    EXPECT_EQ(pool.get_stats().bytes_in_use, 0);
+}
+
+TEST(BufferSlice, chunkGoesBackToThePoolWithTheLastSlice) {
+    BufferPool pool;
+    PooledBuffer buffer{pool};
+    write(buffer, "GET a\r\nGET b\r\n");
+
+    auto slice = buffer.take_front(14, 14);
+    auto first = slice.subslice(0, 7);
+    auto second = slice.subslice(7, 7);
+    auto copy = second;
+    slice.reset();
+
+    EXPECT_EQ(first.view(), "GET a\r\n");
+    EXPECT_EQ(copy.view(), "GET b\r\n");
+
+    first.reset();
+    second.reset();
+    EXPECT_EQ(pool.get_stats().bytes_in_use, BufferPool::MIN_CHUNK_SIZE);
+
+    auto moved = std::move(copy);
+    EXPECT_TRUE(copy.view().empty());
+    moved = BufferSlice{};
+    EXPECT_EQ(pool.get_stats().bytes_in_use, 0);
+    EXPECT_EQ(pool.get_stats().bytes_cached, BufferPool::MIN_CHUNK_SIZE);
+}
+
+TEST(BufferSlice, sharingAChunkDoesNotAllocateOnceThePoolIsWarm) {
+    BufferPool pool;
+    PooledBuffer buffer{pool};
+
+    for (int idx{0}; idx < 100; ++idx) {
+        write(buffer, "*1\r\n$4\r\nPING\r\n*1");
+        auto slice = buffer.take_front(14, 16);
+        auto part = slice.subslice(4, 10);
+        EXPECT_EQ(part.view(), "$4\r\nPING\r\n");
+    }
+
+    // The chunk which the buffer holds and the one which was taken by the slice.
+    EXPECT_EQ(pool.get_stats().number_of_allocations, 2);
+}
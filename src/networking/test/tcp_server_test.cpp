@@ -1,4 +1,6 @@
+#include <atomic>
 #include <chrono>
+#include <filesystem>
 #include <iostream>
 #include <queue>
 #include <stop_token>
@@ -13,6 +15,63 @@ namespace {
 
 using namespace std::chrono_literals;
 constexpr int LISTENING_PORT = 6030;
+constexpr int BACKEND_LISTENING_PORT = 6032;
+constexpr int BUFFER_POOL_LISTENING_PORT = 6033;
+constexpr auto UNIX_SOCKET_PATH = "/tmp/tcp_server_test.sock";
+constexpr std::size_t NUMBER_OF_BUFFER_POOL_CLIENTS = 100;
+constexpr auto POLL_TIMEOUT = 10s;
+
+std::vector<int> connect_clients(std::size_t number_of_clients, int port) {
+    TCPSocketConfig client_tcp_socket_config;
+    client_tcp_socket_config.ip = '0';
+    client_tcp_socket_config.is_listening = false;
+    client_tcp_socket_config.is_blocking = true;
+    client_tcp_socket_config.needs_so_timestamp = false;
+    client_tcp_socket_config.port = port;
+
+    std::vector<int> client_file_descriptors;
+    for (std::size_t idx{0}; idx < number_of_clients; ++idx) {
+        client_file_descriptors.push_back(create_socket(client_tcp_socket_config));
+    }
+
+    return client_file_descriptors;
+}
+
+int connect_unix_client(const std::string &path) {
+    TCPSocketConfig client_socket_config;
+    client_socket_config.is_blocking = true;
+    client_socket_config.unix_socket_path = path;
+    return create_socket(client_socket_config);
+}
+
+// Send a small request and wait for its reply, the given number of times. Returns the mean time of a round trip.
+std::chrono::nanoseconds measure_round_trips(int client, std::size_t number_of_round_trips) {
+    const std::string request = "*1\r\n$4\r\nPING\r\n";
+    std::string reply(request.size(), '\0');
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t idx{0}; idx < number_of_round_trips; ++idx) {
+        send(client, request.data(), request.size(), 0);
+        std::size_t bytes_received{0};
+        while (bytes_received < reply.size()) {
+            const auto result = recv(client, reply.data() + bytes_received, reply.size() - bytes_received, 0);
+            if (result <= 0) {
+                return std::chrono::nanoseconds::max();
+            }
+            bytes_received += result;
+        }
+    }
+
+    return (std::chrono::steady_clock::now() - start) / number_of_round_trips;
+}
+
+template<typename Predicate>
+void poll_until(TCPServer &server, Predicate predicate) {
+    const auto start = std::chrono::steady_clock::now();
+    while (!predicate() && (std::chrono::steady_clock::now() - start < POLL_TIMEOUT)) {
+        server.poll();
+    }
+}
 
 } // namespace
 
@@ -118,6 +177,11 @@ TEST_F(ServerTest, clientMessagesAreReceivedInServer) {
 
     client_one_thread.join();
 
+    // Let the server read the last messages before it is stopped.
+    std::this_thread::sleep_for(100ms);
+    server_thread_.request_stop();
+    server_thread_.join();
+
     std::vector<std::string> expected_messages{"client_one_message_one",
                                                "client_one_message_two",
                                                "client_one_message_three",
@@ -159,3 +223,428 @@ TEST_F(ServerTest, largeMessage) {
 
     EXPECT_EQ(received_string.size(), large_message.size());
 }
+
+// Every client sends a small message. Connections whose message is consumed give their buffer back to the pool,
+// connections with pending data hold a single small chunk.
+TEST(TCPServer, consumedMessagesGiveTheirBuffersBackToThePool) {
+    TCPServer server{BUFFER_POOL_LISTENING_PORT};
+    std::size_t number_of_received_messages{0};
+    bool consume_messages = true;
+    server.receive_callback = [&](auto tcp_socket) {
+        ++number_of_received_messages;
+        if (consume_messages) {
+            tcp_socket->next_valid_receive_index = 0;
+        }
+    };
+
+    const auto clients = connect_clients(NUMBER_OF_BUFFER_POOL_CLIENTS, BUFFER_POOL_LISTENING_PORT);
+    poll_until(server, [&server]() { return server.get_number_of_connections() == NUMBER_OF_BUFFER_POOL_CLIENTS; });
+    ASSERT_EQ(server.get_number_of_connections(), NUMBER_OF_BUFFER_POOL_CLIENTS);
+
+    // Idle connections do not hold any buffers.
+    EXPECT_EQ(server.get_buffer_pool_stats().bytes_in_use, 0);
+
+    const std::string message = "*1\r\n$4\r\nPING\r\n";
+    const auto send_from_all_clients = [&]() {
+        number_of_received_messages = 0;
+        std::for_each(clients.begin(), clients.end(), [&message](auto client) {
+            send(client, message.c_str(), message.size(), 0);
+        });
+        poll_until(server, [&]() { return number_of_received_messages == NUMBER_OF_BUFFER_POOL_CLIENTS; });
+    };
+
+    send_from_all_clients();
+    ASSERT_EQ(number_of_received_messages, NUMBER_OF_BUFFER_POOL_CLIENTS);
+    const auto consumed_stats = server.get_buffer_pool_stats();
+    EXPECT_EQ(consumed_stats.bytes_in_use, 0);
+    EXPECT_LE(consumed_stats.bytes_cached, BufferPool::MIN_CHUNK_SIZE);
+
+    consume_messages = false;
+    send_from_all_clients();
+    ASSERT_EQ(number_of_received_messages, NUMBER_OF_BUFFER_POOL_CLIENTS);
+    EXPECT_EQ(server.get_buffer_pool_stats().bytes_in_use, NUMBER_OF_BUFFER_POOL_CLIENTS * BufferPool::MIN_CHUNK_SIZE);
+
+    std::for_each(clients.begin(), clients.end(), [](auto client) { close(client); });
+
+    // Closed connections give their pending chunks back as well.
+    poll_until(server, [&server]() { return server.get_number_of_connections() == 0; });
+    EXPECT_EQ(server.get_buffer_pool_stats().bytes_in_use, 0);
+}
+
+// Both I/O backends have to deliver everything a client sends and write back everything that is enqueued, including
+// messages which are much larger than the kernel socket buffers.
+class TCPServerBackendTest : public ::testing::TestWithParam<IOBackend> {};
+
+TEST_P(TCPServerBackendTest, echo) {
+    TCPServer server{TCPServerConfig{BACKEND_LISTENING_PORT, false, GetParam()}};
+    server.receive_callback = [&server](auto tcp_socket) {
+        const auto message = std::string(tcp_socket->receive_buffer.data(), tcp_socket->next_valid_receive_index);
+        tcp_socket->next_valid_receive_index = 0;
+        server.enqueue_to_send_buffer(tcp_socket->file_descriptor, message);
+    };
+
+    auto server_thread = std::jthread([&server](std::stop_token stop_token) {
+        while (!stop_token.stop_requested()) {
+            server.poll();
+        }
+    });
+
+    const auto client = connect_clients(1, BACKEND_LISTENING_PORT).front();
+    const auto echo = [client](const std::string &message) {
+        std::jthread sender([&]() { send(client, message.c_str(), message.size(), 0); });
+
+        std::string response(message.size(), '\0');
+        std::size_t bytes_received{0};
+        while (bytes_received < response.size()) {
+            const auto result = recv(client, response.data() + bytes_received, response.size() - bytes_received, 0);
+            if (result <= 0) {
+                break;
+            }
+            bytes_received += result;
+        }
+
+        return response;
+    };
+
+    for (std::size_t idx{0}; idx < 100; ++idx) {
+        const auto message = "message_" + std::to_string(idx);
+        EXPECT_EQ(echo(message), message);
+    }
+
+    std::string large_message(16 * 1024 * 1024, 'x');
+    for (std::size_t idx{0}; idx < large_message.size(); idx += 4096) {
+        large_message[idx] = static_cast<char>('a' + (idx / 4096) % 26);
+    }
+    EXPECT_EQ(echo(large_message), large_message);
+
+    close(client);
+}
+
+TEST_P(TCPServerBackendTest, waitingPollIsWokenUp) {
+    TCPServer server{TCPServerConfig{BACKEND_LISTENING_PORT, false, GetParam()}};
+
+    // Nothing happens, the poll returns after the timeout.
+    EXPECT_FALSE(server.poll(10));
+
+    const auto start = std::chrono::steady_clock::now();
+    auto waker = std::jthread([&server]() {
+        std::this_thread::sleep_for(50ms);
+        server.wake_up();
+    });
+
+    while (!server.poll(-1)) {
+    }
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 50ms);
+
+    // A wake up before the wait is not lost.
+    waker.join();
+    server.wake_up();
+    EXPECT_TRUE(server.poll(-1));
+}
+
+// Replies of another thread are taken by the poll which the thread wakes up, and sent before it returns.
+TEST_P(TCPServerBackendTest, repliesOfTheBeforeFlushCallbackAreSentByTheWokenUpPoll) {
+    TCPServer server{TCPServerConfig{BACKEND_LISTENING_PORT, false, GetParam()}};
+
+    int client_file_descriptor{-1};
+    server.receive_callback = [&client_file_descriptor](auto tcp_socket) {
+        tcp_socket->next_valid_receive_index = 0;
+        client_file_descriptor = tcp_socket->file_descriptor;
+    };
+
+    std::atomic<bool> has_reply{false};
+    auto is_reply_enqueued = false;
+    server.before_flush_callback = [&]() {
+        if (!has_reply.exchange(false)) {
+            return false;
+        }
+
+        server.enqueue_to_send_buffer(client_file_descriptor, "reply");
+        is_reply_enqueued = true;
+        return true;
+    };
+
+    const auto client = connect_clients(1, BACKEND_LISTENING_PORT).front();
+    const timeval receive_timeout{1, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &receive_timeout, sizeof(receive_timeout));
+    send(client, "x", 1, 0);
+    poll_until(server, [&]() { return client_file_descriptor != -1; });
+
+    auto producer = std::jthread([&]() {
+        std::this_thread::sleep_for(50ms);
+        has_reply = true;
+        server.wake_up();
+    });
+    while (!is_reply_enqueued) {
+        server.poll(-1);
+    }
+
+    std::string reply(5, '\0');
+    std::size_t bytes_received{0};
+    while (bytes_received < reply.size()) {
+        const auto result = recv(client, reply.data() + bytes_received, reply.size() - bytes_received, 0);
+        if (result <= 0) {
+            break;
+        }
+        bytes_received += result;
+    }
+    EXPECT_EQ(reply, "reply");
+    close(client);
+}
+
+// The bytes enqueued without a copy are held until the kernel is done with them (with MSG_ZEROCOPY under epoll, that is
+// once the completion was read from the error queue).
+TEST_P(TCPServerBackendTest, externalBytesAreSentWithoutCopy) {
+    TCPServer server{TCPServerConfig{BACKEND_LISTENING_PORT, false, GetParam(), true}};
+
+    auto value = std::make_shared<std::string>(8 * 1024 * 1024, 'x');
+    for (std::size_t idx{0}; idx < value->size(); idx += 4096) {
+        (*value)[idx] = static_cast<char>('a' + (idx / 4096) % 26);
+    }
+
+    server.receive_callback = [&server, &value](auto tcp_socket) {
+        tcp_socket->next_valid_receive_index = 0;
+        server.enqueue_to_send_buffer(tcp_socket->file_descriptor, "header:");
+        server.enqueue_to_send_buffer(tcp_socket->file_descriptor, *value, value);
+        server.enqueue_to_send_buffer(tcp_socket->file_descriptor, ":trailer");
+    };
+
+    const auto client = connect_clients(1, BACKEND_LISTENING_PORT).front();
+    const auto expected_response = "header:" + *value + ":trailer";
+    std::string response(expected_response.size(), '\0');
+    std::atomic<bool> is_response_received{false};
+
+    auto receiver = std::jthread([&]() {
+        send(client, "x", 1, 0);
+
+        std::size_t bytes_received{0};
+        while (bytes_received < response.size()) {
+            const auto result = recv(client, response.data() + bytes_received, response.size() - bytes_received, 0);
+            if (result <= 0) {
+                break;
+            }
+            bytes_received += result;
+        }
+        is_response_received = true;
+    });
+
+    poll_until(server, [&]() { return is_response_received && value.use_count() == 1; });
+
+    EXPECT_EQ(response, expected_response);
+    EXPECT_EQ(value.use_count(), 1);
+    close(client);
+}
+
+// A client which does not read its replies is disconnected once they exceed the hard limit, without affecting the
+// server or the other clients.
+TEST_P(TCPServerBackendTest, clientAboveOutputBufferLimitIsDisconnected) {
+    auto config = TCPServerConfig{BACKEND_LISTENING_PORT, false, GetParam()};
+    config.output_buffer_limits[static_cast<std::size_t>(ClientClass::normal)] =
+      OutputBufferLimit{1024 * 1024, 0, std::chrono::seconds{0}};
+    TCPServer server{config};
+
+    const std::string chunk(64 * 1024, 'x');
+    server.receive_callback = [&server, &chunk](auto tcp_socket) {
+        const auto request = std::string(tcp_socket->receive_buffer.data(), tcp_socket->next_valid_receive_index);
+        tcp_socket->next_valid_receive_index = 0;
+
+        // Everything is enqueued before the server flushes anything.
+        const auto number_of_chunks = request == "flood" ? 32 : 1;
+        for (int idx{0}; idx < number_of_chunks; ++idx) {
+            server.enqueue_to_send_buffer(tcp_socket->file_descriptor, chunk);
+        }
+    };
+
+    const auto clients = connect_clients(2, BACKEND_LISTENING_PORT);
+    const auto &registry = server.get_client_registry();
+    poll_until(server, [&]() { return registry.size() == 2; });
+    ASSERT_EQ(registry.size(), 2);
+
+    send(clients[0], "flood", 5, 0);
+    poll_until(server, [&]() { return registry.size() == 1; });
+    EXPECT_EQ(registry.size(), 1);
+    EXPECT_EQ(server.get_number_of_output_buffer_limit_disconnections(), 1);
+
+    // The other client is still served.
+    std::string response(chunk.size(), '\0');
+    std::atomic<bool> is_response_received{false};
+    auto receiver = std::jthread([&]() {
+        send(clients[1], "x", 1, 0);
+        std::size_t bytes_received{0};
+        while (bytes_received < response.size()) {
+            const auto result =
+              recv(clients[1], response.data() + bytes_received, response.size() - bytes_received, 0);
+            if (result <= 0) {
+                break;
+            }
+            bytes_received += result;
+        }
+        is_response_received = true;
+    });
+
+    poll_until(server, [&]() { return is_response_received.load(); });
+    EXPECT_EQ(response, chunk);
+
+    for (const auto client : clients) {
+        close(client);
+    }
+}
+
+// A kill request from another thread closes the connection in the thread of the server.
+TEST_P(TCPServerBackendTest, killedClientIsDisconnected) {
+    TCPServer server{TCPServerConfig{BACKEND_LISTENING_PORT, false, GetParam()}};
+
+    const auto client = connect_clients(1, BACKEND_LISTENING_PORT).front();
+    const auto &registry = server.get_client_registry();
+    poll_until(server, [&]() { return registry.size() == 1; });
+
+    std::uint64_t client_id{0};
+    registry.for_each([&](const ClientInfo &client_info) { client_id = client_info.id; });
+    EXPECT_FALSE(server.kill_client(client_id + 1));
+
+    auto killer = std::jthread([&]() { EXPECT_TRUE(server.kill_client(client_id)); });
+    killer.join();
+    poll_until(server, [&]() { return registry.size() == 0; });
+    EXPECT_EQ(registry.size(), 0);
+
+    char byte;
+    EXPECT_EQ(recv(client, &byte, 1, 0), 0);
+    close(client);
+}
+
+// Clients of the Unix domain socket are served by the same loop as the TCP ones. The socket file is removed with the
+// server.
+TEST_P(TCPServerBackendTest, unixSocketClientsAreServed) {
+    auto config = TCPServerConfig{BACKEND_LISTENING_PORT, false, GetParam()};
+    config.unix_socket_path = UNIX_SOCKET_PATH;
+
+    {
+        TCPServer server{config};
+        server.receive_callback = [&server](auto tcp_socket) {
+            const auto message = std::string(tcp_socket->receive_buffer.data(), tcp_socket->next_valid_receive_index);
+            tcp_socket->next_valid_receive_index = 0;
+            server.enqueue_to_send_buffer(tcp_socket->file_descriptor, message);
+        };
+
+        auto server_thread = std::jthread([&server](std::stop_token stop_token) {
+            while (!stop_token.stop_requested()) {
+                server.poll(10);
+            }
+        });
+
+        const auto tcp_client = connect_clients(1, BACKEND_LISTENING_PORT).front();
+        const auto unix_clients = std::vector<int>{connect_unix_client(UNIX_SOCKET_PATH),
+                                                   connect_unix_client(UNIX_SOCKET_PATH)};
+        EXPECT_NE(measure_round_trips(tcp_client, 10), std::chrono::nanoseconds::max());
+        for (const auto unix_client : unix_clients) {
+            EXPECT_NE(measure_round_trips(unix_client, 10), std::chrono::nanoseconds::max());
+        }
+
+        std::size_t number_of_unix_clients{0};
+        server.get_client_registry().for_each([&](const ClientInfo &client_info) {
+            if (client_info.address == std::string{UNIX_SOCKET_PATH} + ":0") {
+                ++number_of_unix_clients;
+            }
+        });
+        EXPECT_EQ(number_of_unix_clients, 2);
+
+        close(tcp_client);
+        std::for_each(unix_clients.begin(), unix_clients.end(), [](auto client) { close(client); });
+    }
+
+    EXPECT_FALSE(std::filesystem::exists(UNIX_SOCKET_PATH));
+}
+
+// Timers run within the poll, a waiting poll returns for them.
+TEST_P(TCPServerBackendTest, timersRunInPoll) {
+    TCPServer server{TCPServerConfig{BACKEND_LISTENING_PORT, false, GetParam()}};
+
+    std::size_t number_of_periodic_runs{0};
+    std::vector<std::chrono::steady_clock::time_point> one_shot_runs;
+    const auto start = std::chrono::steady_clock::now();
+
+    const auto periodic_timer_id = server.add_periodic_timer(10ms, [&]() { ++number_of_periodic_runs; });
+    server.add_timer(50ms, [&]() { one_shot_runs.push_back(std::chrono::steady_clock::now()); });
+    const auto cancelled_timer_id = server.add_timer(20ms, [&]() { ADD_FAILURE() << "Cancelled timer ran"; });
+    EXPECT_TRUE(server.cancel_timer(cancelled_timer_id));
+
+    while (one_shot_runs.empty()) {
+        server.poll(-1);
+    }
+    EXPECT_GE(one_shot_runs.front() - start, 50ms);
+    EXPECT_GE(number_of_periodic_runs, 4);
+
+    EXPECT_TRUE(server.cancel_timer(periodic_timer_id));
+    const auto number_of_runs_when_cancelled = number_of_periodic_runs;
+    server.poll(30);
+    EXPECT_EQ(number_of_periodic_runs, number_of_runs_when_cancelled);
+    EXPECT_EQ(one_shot_runs.size(), 1);
+}
+
+// Only the clients which did not send anything for the idle timeout are disconnected.
+TEST_P(TCPServerBackendTest, idleClientIsDisconnected) {
+    auto config = TCPServerConfig{BACKEND_LISTENING_PORT, false, GetParam()};
+    config.idle_timeout = 200ms;
+    TCPServer server{config};
+    server.receive_callback = [](auto tcp_socket) { tcp_socket->next_valid_receive_index = 0; };
+
+    const auto clients = connect_clients(2, BACKEND_LISTENING_PORT);
+    const auto idle_client = clients[0];
+    const auto active_client = clients[1];
+    poll_until(server, [&]() { return server.get_number_of_connections() == 2; });
+
+    const auto start = std::chrono::steady_clock::now();
+    auto next_send = start;
+    while (server.get_number_of_connections() == 2 && std::chrono::steady_clock::now() - start < 2s) {
+        if (std::chrono::steady_clock::now() >= next_send) {
+            send(active_client, "x", 1, 0);
+            next_send += 50ms;
+        }
+        server.poll(10);
+    }
+
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 150ms);
+    EXPECT_EQ(server.get_number_of_connections(), 1);
+    EXPECT_EQ(server.get_number_of_idle_timeout_disconnections(), 1);
+
+    char byte;
+    EXPECT_EQ(recv(idle_client, &byte, 1, 0), 0);
+
+    close(idle_client);
+    close(active_client);
+}
+
+// A paused server leaves what the clients send in the kernel, it reads it once it is resumed.
+TEST_P(TCPServerBackendTest, pausedServerReadsOnceResumed) {
+    TCPServer server{TCPServerConfig{BACKEND_LISTENING_PORT, false, GetParam()}};
+    std::string received;
+    server.receive_callback = [&server, &received](auto tcp_socket) {
+        received.append(tcp_socket->receive_buffer.data(), tcp_socket->next_valid_receive_index);
+        tcp_socket->next_valid_receive_index = 0;
+        server.pause_receiving();
+    };
+
+    const auto client = connect_clients(1, BACKEND_LISTENING_PORT).front();
+    send(client, "first", 5, 0);
+    poll_until(server, [&]() { return received == "first"; });
+    EXPECT_TRUE(server.is_receiving_paused());
+
+    send(client, "second", 6, 0);
+    const auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < 100ms) {
+        server.poll(10);
+    }
+    EXPECT_EQ(received, "first");
+
+    server.resume_receiving();
+    poll_until(server, [&]() { return received == "firstsecond"; });
+    EXPECT_EQ(received, "firstsecond");
+    EXPECT_EQ(server.get_number_of_connections(), 1);
+
+    close(client);
+}
+
+INSTANTIATE_TEST_SUITE_P(TCPServer,
+                         TCPServerBackendTest,
+                         ::testing::Values(IOBackend::epoll, IOBackend::io_uring),
+                         [](const auto &info) { return info.param == IOBackend::epoll ? "epoll" : "io_uring"; });
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "data_manager.hpp"
@@ -12,7 +13,12 @@ struct RDBConfig {
 
 class RDBFileHandler {
   public:
-    RDBFileHandler(const RDBConfig &rdb_config, DataManager<std::string, std::string> &data_manager);
+    /**
+     * @brief Load the keys of the RDB file, if there is one.
+     *
+     * @param data_managers Shards of the keyspace, every key is stored in the one of get_key_shard().
+     */
+    RDBFileHandler(const RDBConfig &rdb_config, std::vector<DataManager<std::string, std::string> *> data_managers);
 
     const std::string &get_rdb_dir() const {
         return rdb_config_.dir;
@@ -24,7 +30,8 @@ class RDBFileHandler {
 
   private:
     void parse_file(const std::vector<unsigned char> buffer);
+    DataManager<std::string, std::string> &get_data_manager(std::string_view key);
 
     const RDBConfig &rdb_config_;
-    DataManager<std::string, std::string> &data_manager_;
+    std::vector<DataManager<std::string, std::string> *> data_managers_;
 };
@@ -66,8 +66,9 @@ unsigned long long get_time_stamp_ms(const std::vector<unsigned char> buffer, st
 }
 } // namespace
 
-RDBFileHandler::RDBFileHandler(const RDBConfig &rdb_config, DataManager<std::string, std::string> &data_manager)
-  : rdb_config_{rdb_config}, data_manager_{data_manager} {
+RDBFileHandler::RDBFileHandler(const RDBConfig &rdb_config,
+                               std::vector<DataManager<std::string, std::string> *> data_managers)
+  : rdb_config_{rdb_config}, data_managers_{std::move(data_managers)} {
     if (rdb_config.dbfilename.empty() || rdb_config.dir.empty()) {
         return;
     }
@@ -124,7 +125,8 @@ void RDBFileHandler::parse_file(const std::vector<unsigned char> buffer) {
         // "bazqux".
         if (byte == 0x00) {
             auto key_value = read_key_value(buffer, index);
-            data_manager_.set(std::move(key_value.first), std::move(key_value.second));
+            auto &data_manager = get_data_manager(key_value.first);
+            data_manager.set(std::move(key_value.first), std::move(key_value.second));
         }
 
         // Indicates that this key ("foo") has an expire,
@@ -142,7 +144,12 @@ void RDBFileHandler::parse_file(const std::vector<unsigned char> buffer) {
             const auto time_diff = std::chrono::duration_cast<std::chrono::milliseconds>(expiry_time_ms - now);
 
             auto key_value = read_key_value(buffer, index);
-            data_manager_.set(std::move(key_value.first), std::move(key_value.second), time_diff);
+            auto &data_manager = get_data_manager(key_value.first);
+            data_manager.set(std::move(key_value.first), std::move(key_value.second), time_diff);
         }
     }
 }
+
+DataManager<std::string, std::string> &RDBFileHandler::get_data_manager(std::string_view key) {
+    return *data_managers_[get_key_shard(key, data_managers_.size())];
+}
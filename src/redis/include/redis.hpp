@@ -1,14 +1,26 @@
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
+#include "background_jobs.hpp"
 #include "data_manager.hpp"
+#include "idle_strategy.hpp"
 #include "message_handler.hpp"
 #include "rdb_file_handler.hpp"
+#include "resp_parser.hpp"
+#include "resp_tokenizer.hpp"
 #include "spsc_queue.hpp"
 #include "tcp_server.hpp"
+#include "thread_placement.hpp"
 
 enum class Role { master, slave };
 
@@ -16,6 +28,42 @@ struct RedisConfig {
     RDBConfig rdb_config{};
     int listening_port{6379};
     Role role{Role::master};
+    // Number of network threads. Each of them has its own listening socket on the same port.
+    std::size_t number_of_reactors{1};
+    IOBackend io_backend{IOBackend::epoll};
+    // How the network threads and the message handler wait when there is nothing to do.
+    IdleConfig idle_config{};
+    // Bulk string replies of at least this many bytes are sent straight from the stored value, with MSG_ZEROCOPY
+    // under epoll. 0 disables it.
+    std::size_t zero_copy_threshold{64 * 1024};
+    // Limits of the pending replies per client class, clients above them are disconnected.
+    std::array<OutputBufferLimit, NUMBER_OF_CLIENT_CLASSES> output_buffer_limits = DEFAULT_OUTPUT_BUFFER_LIMITS;
+    // Also accept local clients on a Unix domain socket at this path. Empty disables it.
+    std::string unix_socket_path{};
+    // Clients which are idle for longer are disconnected. 0 disables it.
+    std::chrono::seconds client_idle_timeout{0};
+    // Requests with a longer bulk string are rejected with a protocol error as soon as its header arrives.
+    std::size_t proto_max_bulk_len{RESPParser::DEFAULT_MAX_BULK_LENGTH};
+    // Threads which execute the commands. The keyspace is split between them by the hash of the keys, each one owns
+    // its keys and executes the commands on them, so the commands of different shards run in parallel.
+    std::size_t number_of_shards{1};
+    // The network thread executes the commands itself and writes their replies in the same turn of its loop, without
+    // the hop to a shard thread and back. There is a single network thread, which owns the whole keyspace, the number
+    // of reactors and shards is ignored.
+    bool run_to_completion{false};
+    // Entries of each queue between a network thread and a shard, a power of two. A network thread whose request
+    // queue is full stops reading from its clients, a shard whose response queue is full waits.
+    std::size_t queue_size{1024};
+    // CPUs the network threads and the shard threads are pinned to, see place_current_thread(). Each thread allocates
+    // its buffers or its part of the keyspace itself, on the NUMA node of its CPU. Empty lists leave the threads to
+    // the scheduler.
+    std::vector<int> reactor_cpus{};
+    std::vector<int> shard_cpus{};
+    // CPUs of the background workers, one worker per type of job.
+    std::vector<int> background_cpus{};
+    // Expired values of at least this many bytes are freed by a background worker instead of the shard. 0 frees every
+    // value in the background.
+    std::size_t lazy_free_threshold{1024 * 1024};
 };
 
 class Redis {
@@ -44,20 +92,349 @@ class Redis {
         return replication_offset_;
     }
 
+    std::size_t get_zero_copy_threshold() const {
+        return zero_copy_threshold_;
+    }
+
+    std::size_t get_number_of_reactors() const {
+        return reactors_.size();
+    }
+
+    const IdleStats &get_reactor_idle_stats(std::size_t reactor_index) const {
+        return reactors_[reactor_index]->idle_stats;
+    }
+
+    const ThreadPlacement &get_reactor_placement(std::size_t reactor_index) const {
+        return reactors_[reactor_index]->placement;
+    }
+
+    std::size_t get_number_of_shards() const {
+        return shards_.size();
+    }
+
+    bool is_run_to_completion() const {
+        return run_to_completion_;
+    }
+
+    const IdleStats &get_shard_idle_stats(std::size_t shard_index) const {
+        return shards_[shard_index]->idle_stats;
+    }
+
+    const ThreadPlacement &get_shard_placement(std::size_t shard_index) const {
+        return shards_[shard_index]->placement;
+    }
+
+    /**
+     * @brief Workers for slow work which would otherwise stall the network threads or the shards.
+     *
+     */
+    BackgroundJobs &get_background_jobs() {
+        return background_jobs_;
+    }
+
+    const BackgroundJobs &get_background_jobs() const {
+        return background_jobs_;
+    }
+
+    /**
+     * @brief Call the given function for the clients of every network thread. The registry of a thread is locked while
+     * its clients are visited.
+     *
+     */
+    template<typename Function>
+    void for_each_client(Function &&function) const {
+        for (const auto &reactor : reactors_) {
+            reactor->server.get_client_registry().for_each(function);
+        }
+    }
+
+    std::size_t get_number_of_clients() const;
+    std::size_t get_number_of_output_buffer_limit_disconnections() const;
+    std::size_t get_number_of_idle_timeout_disconnections() const;
+
+    std::uint64_t get_number_of_commands_processed() const;
+
+    /**
+     * @brief Number of times a network thread stopped reading from its clients because a request queue was full.
+     *
+     */
+    std::uint64_t get_number_of_request_queue_full_pauses() const;
+
+    /**
+     * @brief Number of times a shard waited because a response queue was full.
+     *
+     */
+    std::uint64_t get_number_of_response_queue_full_pauses() const;
+
+    /**
+     * @brief Number of calls of a command by all shards.
+     *
+     * @param command_index Index of the command in MessageHandler::COMMANDS.
+     */
+    std::uint64_t get_number_of_calls(std::size_t command_index) const;
+
+    /**
+     * @brief Commands per second, averaged over the last samples.
+     *
+     */
+    std::uint64_t get_instantaneous_ops_per_sec() const {
+        return instantaneous_ops_per_sec_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Ask the network thread of the client to close its connection.
+     *
+     * @return true when a client with the id exists.
+     */
+    bool kill_client(std::uint64_t client_id);
+
+    /**
+     * @return Number of clients connected from the given <ip>:<port> which are closed.
+     */
+    std::size_t kill_clients_by_address(std::string_view address);
+
   private:
-    void run_tcp_server();
-    void run_message_handler();
+    /**
+     * @brief Strings whose memory is reused. The strings of the responses are passed back and forth between the
+     * threads: a network thread hands the strings of sent responses to the shards with the next requests, and the
+     * shards serialize the next responses into them. Once they have grown to the size of the messages, no message
+     * allocates.
+     *
+     */
+    class SpareBuffers {
+      public:
+        SpareBuffers();
+
+        /**
+         * @return An empty string, with the capacity of a spare one when there is one.
+         */
+        std::string take();
+
+        /**
+         * @brief Keep the memory of a string which is not needed anymore, unless enough strings are kept or it is too
+         * large.
+         *
+         */
+        void give_back(std::string &&buffer);
+
+      private:
+        std::vector<std::string> buffers_;
+    };
+
+    /**
+     * @brief State of a connection on its network thread: the parser of its requests and, when its commands are
+     * executed by several shards, the order of their replies.
+     *
+     */
+    struct ClientSession {
+        explicit ClientSession(std::size_t max_bulk_length);
+
+        /**
+         * @brief Replies of a command which every shard executed on its part of the keyspace, e.g. KEYS. The arrays
+         * of the shards are joined into one.
+         *
+         */
+        struct GatheredReply {
+            std::size_t number_of_missing_parts{0};
+            std::size_t number_of_elements{0};
+            std::string elements{};
+            // First reply of a shard which is not an array, e.g. an error. It is the reply then.
+            std::string other_reply{};
+        };
+
+        RESPParser parser;
+        // Sequence of the next request, see RequestMessage.
+        std::uint64_t next_request_sequence{0};
+        // Sequence of the request whose replies are sent next. Replies of later requests which arrive earlier wait.
+        std::uint64_t next_reply_sequence{0};
+        std::map<std::uint64_t, std::vector<ResponseMessage>> early_replies;
+        std::map<std::uint64_t, GatheredReply> gathered_replies;
+        // Reply to a protocol error, it takes the sequence after the last request and is only sent once the replies
+        // before it are. The client is disconnected then. Empty without an error.
+        std::string protocol_error_reply{};
+        std::uint64_t protocol_error_sequence{0};
+    };
+
+    /**
+     * @brief The queues between a network thread and a shard.
+     *
+     */
+    struct Channel {
+        explicit Channel(std::size_t queue_size);
+
+        SPSCQueue<RequestMessage> requests;
+        SPSCQueue<ResponseMessage> responses;
+        // Requests which did not fit into the full request queue, in order. Only used by the network thread, which
+        // does not read from its clients until they are queued.
+        std::deque<RequestMessage> request_backlog;
+    };
+
+    /**
+     * @brief A network thread with its own listening socket, epoll instance and connections. It exchanges requests and
+     * responses with every shard through its own pair of queues.
+     *
+     */
+    struct Reactor {
+        Reactor(const TCPServerConfig &server_config, std::size_t queue_size, std::size_t number_of_shards);
+
+        TCPServer server;
+        // Indexed by shard.
+        std::vector<std::unique_ptr<Channel>> channels;
+        IdleStats idle_stats;
+        // Set while the thread waits in the server, a shard has to wake it up after pushing a response.
+        std::atomic<bool> is_parked{false};
+        // Strings of the sent responses, they go to the shards with the next requests.
+        SpareBuffers spare_buffers;
+        // Responses popped at once from a response queue.
+        std::vector<ResponseMessage> response_messages;
+        // Finds the keys of the commands, to send them to their shards.
+        RESPTokenizer tokenizer;
+        // Only written by the network thread.
+        std::atomic<std::uint64_t> number_of_request_queue_full_pauses{0};
+        ThreadPlacement placement;
+        std::jthread thread;
+    };
+
+    /**
+     * @brief A thread which owns a part of the keyspace and executes the commands on it, for the clients of every
+     * network thread. The first shard runs on the thread which calls run().
+     *
+     */
+    struct Shard {
+        Shard(Redis &redis, std::size_t index, std::size_t lazy_free_threshold);
 
-    TCPServer server_;
+        const std::size_t index;
+        DataManager<std::string, std::string> data_manager;
+        MessageHandler message_handler;
+        IdleStats idle_stats;
+        // The shard parks on the wake up counter, the network threads increment it after pushing requests.
+        std::atomic<bool> is_parked{false};
+        std::atomic<std::uint32_t> wake_ups{0};
+        // Strings which came with the requests, the responses are serialized into them.
+        SpareBuffers spare_buffers;
+        // Only written by the shard, sampled periodically by the first network thread.
+        std::atomic<std::uint64_t> number_of_commands_processed{0};
+        // Only written by the shard.
+        std::atomic<std::uint64_t> number_of_response_queue_full_pauses{0};
+        ThreadPlacement placement;
+        std::jthread thread;
+    };
+
+    std::vector<std::unique_ptr<Shard>> create_shards(std::size_t number_of_shards, std::size_t lazy_free_threshold);
+    std::vector<DataManager<std::string, std::string> *> get_data_managers();
+
+    /**
+     * @brief Pass the complete commands a client sent to the shards. A command split across reads stays in the
+     * receive buffer of the client until the rest of it arrives.
+     *
+     */
+    void handle_received_data(Reactor &reactor, TCPSocket *client_socket);
+
+    /**
+     * @brief Send complete commands to the shards which own their keys. Consecutive commands of a shard are sent in
+     * one request. A command without a key is executed by the shard of the request before it, or the shard of the
+     * client, and a command on the whole keyspace by every shard.
+     *
+     * @param streamed_values Streamed payloads of the commands, see RequestMessage.
+     */
+    void dispatch_requests(Reactor &reactor,
+                           ClientSession &session,
+                           TCPSocket *client_socket,
+                           BufferSlice commands,
+                           std::vector<std::string> streamed_values);
+    void send_request(Reactor &reactor,
+                      std::size_t shard_index,
+                      TCPSocket *client_socket,
+                      BufferSlice commands,
+                      std::vector<std::string> streamed_values,
+                      std::uint64_t sequence);
+
+    /**
+     * @brief Queue the requests which waited for room in the request queues. Once all of them are queued, the network
+     * thread reads from its clients again.
+     *
+     */
+    void push_request_backlogs(Reactor &reactor);
+    /**
+     * @brief Execute complete commands on the network thread and enqueue their replies, see
+     * RedisConfig::run_to_completion.
+     *
+     */
+    void execute_commands(Reactor &reactor,
+                          TCPSocket *client_socket,
+                          std::string_view commands,
+                          std::vector<std::string> streamed_values);
+    void run_tcp_servers();
+    void run_shard(Shard &shard);
+
+    /**
+     * @brief Execute every command of a request. Their responses go back to the reactor in one message, or a few when
+     * large values are sent on their own. The last one hands the commands back.
+     *
+     */
+    void execute_pipeline(Shard &shard, Reactor &reactor, RequestMessage &request_message);
+
+    /**
+     * @brief Push a response to a network thread, waiting for room in the queue when it is full.
+     *
+     */
+    void push_response(Shard &shard, Reactor &reactor, ResponseMessage response_message);
+
+    /**
+     * @brief Enqueue the responses of the shards to the connections of a network thread. Runs at the end of every
+     * poll, the responses are sent by the same poll.
+     *
+     * @return true when there was any response.
+     */
+    bool enqueue_responses(Reactor &reactor);
+
+    /**
+     * @brief Send a response in the order of the requests of its client, see ClientSession.
+     *
+     */
+    void deliver_response(Reactor &reactor, ResponseMessage &response_message);
+
+    /**
+     * @brief Add the reply of one shard to a gathered reply.
+     *
+     * @return false while the replies of other shards are missing. Otherwise the response holds the whole reply.
+     */
+    static bool gather_response(ClientSession &session, ResponseMessage &response_message);
+    static void send_response(Reactor &reactor, ResponseMessage &response_message);
+
+    /**
+     * @brief Send the reply to a protocol error and disconnect the client, once every request before the error is
+     * answered.
+     *
+     */
+    static void send_protocol_error_when_due(Reactor &reactor, ClientSession &session, TCPSocket *client_socket);
+    void park_shard(Shard &shard);
+    static void wake_up_shard(Shard &shard);
+    static void wake_up_reactor(Reactor &reactor);
+    void sample_stats();
+
+    // Before the shards, which free values in it, and destroyed after them.
+    BackgroundJobs background_jobs_;
+    std::vector<std::unique_ptr<Reactor>> reactors_;
+    std::vector<std::unique_ptr<Shard>> shards_;
     std::atomic<bool> running_{true};
-    SPSCQueue<RequestMessage> message_queue_;
-    SPSCQueue<ResponseMessage> response_queue_;
 
-    DataManager<std::string, std::string> data_manager_;
+    IdleConfig idle_config_;
+    std::size_t zero_copy_threshold_;
+    std::size_t proto_max_bulk_len_;
+    bool run_to_completion_;
+    std::vector<int> reactor_cpus_;
+    std::vector<int> shard_cpus_;
+
+    // Sampled periodically by the first network thread.
+    std::array<std::uint64_t, 16> ops_per_sec_samples_{};
+    std::size_t next_ops_per_sec_sample_{0};
+    std::uint64_t last_sampled_number_of_commands_{0};
+    std::chrono::steady_clock::time_point last_sample_time_{std::chrono::steady_clock::now()};
+    std::atomic<std::uint64_t> instantaneous_ops_per_sec_{0};
+
     RDBFileHandler rdb_handler_;
     Role role_;
     std::string replication_id_{"8371b4fb1155b71f4a04d3e1bc3e18c4a990aeeb"};
     std::size_t replication_offset_{0};
-
-    std::jthread tcp_server_thread_;
 };
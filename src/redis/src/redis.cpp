@@ -1,62 +1,765 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
 #include "redis.hpp"
+#include "reply_builder.hpp"
+#include "resp_parser.hpp"
+#include "resp_scan.hpp"
 #include "tcp_socket.hpp"
 
 namespace {
-constexpr std::size_t SIZE_OF_MESSAGE_QUEUE = 1024;
+// Messages taken from a queue at once, a busy queue does not starve the other queues and the connections.
+constexpr std::size_t MAX_MESSAGES_PER_DRAIN = 256;
+constexpr auto STATS_SAMPLING_INTERVAL = std::chrono::milliseconds{100};
+constexpr std::size_t MAX_NUMBER_OF_SPARE_BUFFERS = 64;
+// Larger strings are freed, the memory of a single large request or response is not held.
+constexpr std::size_t MAX_SPARE_BUFFER_CAPACITY = 64 * 1024;
+
+// Targets of a command besides the index of a shard.
+constexpr auto NO_SHARD = std::numeric_limits<std::size_t>::max();
+constexpr auto ANY_SHARD = NO_SHARD - 1;
+constexpr auto ALL_SHARDS = NO_SHARD - 2;
+
+const std::vector<int> &check_cpus(const std::vector<int> &cpus) {
+    for (const auto cpu : cpus) {
+        if (!is_cpu_available(cpu)) {
+            throw std::invalid_argument("CPU " + std::to_string(cpu) + " is not available");
+        }
+    }
+
+    return cpus;
+}
+
+/**
+ * @brief Shard which executes a command.
+ *
+ * @return The shard of its key, ANY_SHARD when it has no key or is not valid (any shard can reply with the error), or
+ * ALL_SHARDS when it reads or writes the whole keyspace.
+ */
+std::size_t get_command_shard(const std::vector<Token> &tokens, std::size_t number_of_shards) {
+    if (tokens.size() < 2 || tokens[0].type != TokenType::ARRAY || tokens[1].type != TokenType::BULK_STRING) {
+        return ANY_SHARD;
+    }
+
+    const auto *command = MessageHandler::find_command(std::get<std::string_view>(tokens[1].value));
+    if (command == nullptr || !command->accepts_number_of_arguments(std::get<int>(tokens[0].value))) {
+        return ANY_SHARD;
+    }
+
+    if (command->first_key == 0) {
+        const auto uses_keyspace = command->has_flag(CommandFlag::read) || command->has_flag(CommandFlag::write);
+        return uses_keyspace ? ALL_SHARDS : ANY_SHARD;
+    }
+
+    // Every command of the table has a single key. One with keys of several shards would need a scatter of its own.
+    const auto key_position = static_cast<std::size_t>(command->first_key) + 1;
+    if (key_position >= tokens.size() || tokens[key_position].type != TokenType::BULK_STRING) {
+        return ANY_SHARD;
+    }
+
+    return get_key_shard(std::get<std::string_view>(tokens[key_position].value), number_of_shards);
+}
 } // namespace
 
+Redis::SpareBuffers::SpareBuffers() {
+    buffers_.reserve(MAX_NUMBER_OF_SPARE_BUFFERS);
+}
+
+std::string Redis::SpareBuffers::take() {
+    if (buffers_.empty()) {
+        return {};
+    }
+
+    auto buffer = std::move(buffers_.back());
+    buffers_.pop_back();
+    return buffer;
+}
+
+void Redis::SpareBuffers::give_back(std::string &&buffer) {
+    if (buffers_.size() == MAX_NUMBER_OF_SPARE_BUFFERS || buffer.capacity() > MAX_SPARE_BUFFER_CAPACITY) {
+        return;
+    }
+
+    buffer.clear();
+    buffers_.push_back(std::move(buffer));
+}
+
+Redis::ClientSession::ClientSession(std::size_t max_bulk_length) : parser{max_bulk_length} {
+}
+
+Redis::Channel::Channel(std::size_t queue_size) : requests{queue_size}, responses{queue_size} {
+}
+
+Redis::Reactor::Reactor(const TCPServerConfig &server_config, std::size_t queue_size, std::size_t number_of_shards)
+  : server{server_config}, response_messages(MAX_MESSAGES_PER_DRAIN) {
+    for (std::size_t idx{0}; idx < number_of_shards; ++idx) {
+        channels.push_back(std::make_unique<Channel>(queue_size));
+    }
+}
+
+Redis::Shard::Shard(Redis &redis, std::size_t index, std::size_t lazy_free_threshold)
+  : index{index}, data_manager{}, message_handler{redis, data_manager} {
+    data_manager.set_value_releaser(lazy_free_threshold, [&background_jobs = redis.background_jobs_](auto value) {
+        // The value goes away with the job, on the worker.
+        background_jobs.submit(BackgroundJobType::lazy_free, [value = std::move(value)]() {});
+    });
+}
+
 Redis::Redis(RedisConfig config)
-  : server_{config.listening_port}, message_queue_{SIZE_OF_MESSAGE_QUEUE}, response_queue_{SIZE_OF_MESSAGE_QUEUE},
-    data_manager_{}, rdb_handler_{config.rdb_config, data_manager_}, role_{config.role} {
+  : background_jobs_{check_cpus(config.background_cpus)},
+    shards_{create_shards(config.run_to_completion ? 1 : std::max<std::size_t>(config.number_of_shards, 1),
+                          config.lazy_free_threshold)},
+    idle_config_{config.idle_config}, zero_copy_threshold_{config.zero_copy_threshold},
+    proto_max_bulk_len_{config.proto_max_bulk_len}, run_to_completion_{config.run_to_completion},
+    reactor_cpus_{check_cpus(config.reactor_cpus)}, shard_cpus_{check_cpus(config.shard_cpus)},
+    rdb_handler_{config.rdb_config, get_data_managers()}, role_{config.role} {
+    const auto number_of_reactors =
+      run_to_completion_ ? std::size_t{1} : std::max<std::size_t>(config.number_of_reactors, 1);
+    // Without shard threads there are no queues.
+    const auto number_of_channels = run_to_completion_ ? 0 : shards_.size();
+    auto server_config = TCPServerConfig{config.listening_port,
+                                         number_of_reactors > 1,
+                                         config.io_backend,
+                                         config.zero_copy_threshold != 0,
+                                         config.output_buffer_limits};
+    server_config.idle_timeout = config.client_idle_timeout;
 
-    const auto server_receive_callback = [&](auto client_socket) {
-        const auto &socket_receive_buffer = client_socket->receive_buffer;
-        auto message = std::string(socket_receive_buffer.data(), client_socket->next_valid_receive_index);
-        client_socket->next_valid_receive_index = 0;
-        message_queue_.push({client_socket->file_descriptor, std::move(message)});
-    };
+    for (std::size_t idx{0}; idx < number_of_reactors; ++idx) {
+        // A Unix domain socket path cannot be shared, its clients are all served by the first reactor.
+        server_config.unix_socket_path = idx == 0 ? config.unix_socket_path : std::string{};
+        auto reactor = std::make_unique<Reactor>(server_config, config.queue_size, number_of_channels);
+
+        const auto server_receive_callback = [this, reactor = reactor.get()](auto client_socket) {
+            handle_received_data(*reactor, client_socket);
+        };
 
-    server_.receive_callback = server_receive_callback;
+        reactor->server.receive_callback = server_receive_callback;
+        reactor->server.before_flush_callback = [this, reactor = reactor.get()]() {
+            return enqueue_responses(*reactor);
+        };
+        reactors_.push_back(std::move(reactor));
+    }
+
+    reactors_.front()->server.add_periodic_timer(STATS_SAMPLING_INTERVAL, [this]() { sample_stats(); });
+}
+
+std::vector<std::unique_ptr<Redis::Shard>> Redis::create_shards(std::size_t number_of_shards,
+                                                                std::size_t lazy_free_threshold) {
+    std::vector<std::unique_ptr<Shard>> shards;
+    for (std::size_t idx{0}; idx < number_of_shards; ++idx) {
+        shards.push_back(std::make_unique<Shard>(*this, idx, lazy_free_threshold));
+    }
+
+    return shards;
+}
+
+std::vector<DataManager<std::string, std::string> *> Redis::get_data_managers() {
+    std::vector<DataManager<std::string, std::string> *> data_managers;
+    for (auto &shard : shards_) {
+        data_managers.push_back(&shard->data_manager);
+    }
+
+    return data_managers;
 }
 
 void Redis::run() {
-    run_tcp_server();
-    run_message_handler();
+    run_tcp_servers();
+    if (run_to_completion_) {
+        // The network thread executes the commands, there is no shard thread to run.
+        reactors_.front()->thread.join();
+        return;
+    }
+
+    for (std::size_t idx{1}; idx < shards_.size(); ++idx) {
+        shards_[idx]->thread = std::jthread([this, shard = shards_[idx].get()]() { run_shard(*shard); });
+    }
+
+    run_shard(*shards_.front());
+    for (auto &shard : shards_) {
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
 }
 
 void Redis::stop() {
     running_ = false;
-    tcp_server_thread_.request_stop();
+    for (auto &reactor : reactors_) {
+        reactor->thread.request_stop();
+        reactor->server.wake_up();
+    }
+
+    for (auto &shard : shards_) {
+        shard->wake_ups.fetch_add(1);
+        shard->wake_ups.notify_one();
+    }
 }
 
-void Redis::run_tcp_server() {
-    tcp_server_thread_ = std::jthread([this](std::stop_token stop_token) {
-        while (!stop_token.stop_requested()) {
-            ResponseMessage response_message;
-            if (response_queue_.pop(response_message)) {
-                server_.enqueue_to_send_buffer(response_message.client_id, response_message.message);
-            }
-            server_.poll();
+std::uint64_t Redis::get_number_of_commands_processed() const {
+    std::uint64_t number_of_commands{0};
+    for (const auto &shard : shards_) {
+        number_of_commands += shard->number_of_commands_processed.load(std::memory_order_relaxed);
+    }
+
+    return number_of_commands;
+}
+
+std::uint64_t Redis::get_number_of_request_queue_full_pauses() const {
+    std::uint64_t number_of_pauses{0};
+    for (const auto &reactor : reactors_) {
+        number_of_pauses += reactor->number_of_request_queue_full_pauses.load(std::memory_order_relaxed);
+    }
+
+    return number_of_pauses;
+}
+
+std::uint64_t Redis::get_number_of_response_queue_full_pauses() const {
+    std::uint64_t number_of_pauses{0};
+    for (const auto &shard : shards_) {
+        number_of_pauses += shard->number_of_response_queue_full_pauses.load(std::memory_order_relaxed);
+    }
+
+    return number_of_pauses;
+}
+
+std::uint64_t Redis::get_number_of_calls(std::size_t command_index) const {
+    std::uint64_t number_of_calls{0};
+    for (const auto &shard : shards_) {
+        number_of_calls += shard->message_handler.get_number_of_calls(command_index);
+    }
+
+    return number_of_calls;
+}
+
+std::size_t Redis::get_number_of_clients() const {
+    std::size_t number_of_clients{0};
+    for (const auto &reactor : reactors_) {
+        number_of_clients += reactor->server.get_client_registry().size();
+    }
+
+    return number_of_clients;
+}
+
+std::size_t Redis::get_number_of_output_buffer_limit_disconnections() const {
+    std::size_t number_of_disconnections{0};
+    for (const auto &reactor : reactors_) {
+        number_of_disconnections += reactor->server.get_number_of_output_buffer_limit_disconnections();
+    }
+
+    return number_of_disconnections;
+}
+
+std::size_t Redis::get_number_of_idle_timeout_disconnections() const {
+    std::size_t number_of_disconnections{0};
+    for (const auto &reactor : reactors_) {
+        number_of_disconnections += reactor->server.get_number_of_idle_timeout_disconnections();
+    }
+
+    return number_of_disconnections;
+}
+
+bool Redis::kill_client(std::uint64_t client_id) {
+    return std::ranges::any_of(reactors_, [client_id](auto &reactor) {
+        return reactor->server.kill_client(client_id);
+    });
+}
+
+std::size_t Redis::kill_clients_by_address(std::string_view address) {
+    // The ids are collected first, killing a client needs the lock of the registry.
+    std::vector<std::uint64_t> client_ids;
+    for_each_client([&](const ClientInfo &client) {
+        if (client.address == address) {
+            client_ids.push_back(client.id);
         }
     });
+
+    return std::ranges::count_if(client_ids, [this](auto client_id) {
+        return kill_client(client_id);
+    });
+}
+
+void Redis::handle_received_data(Reactor &reactor, TCPSocket *client_socket) {
+    if (client_socket->protocol_state == nullptr) {
+        client_socket->protocol_state = std::make_shared<ClientSession>(proto_max_bulk_len_);
+    }
+    auto &session = *static_cast<ClientSession *>(client_socket->protocol_state.get());
+    auto &parser = session.parser;
+
+    // The client is disconnected after a protocol error, what it sends until then is dropped.
+    if (parser.has_error()) {
+        client_socket->next_valid_receive_index = 0;
+        return;
+    }
+
+    // Large payloads are streamed out of the buffer, the bytes left in it shrink.
+    auto &receive_buffer = client_socket->receive_buffer;
+    const auto [complete_size, number_of_pending_bytes] =
+      parser.parse(std::span<char>{receive_buffer.data(), client_socket->next_valid_receive_index});
+    client_socket->next_valid_receive_index = number_of_pending_bytes;
+
+    if (complete_size != 0 && run_to_completion_) {
+        execute_commands(reactor,
+                         client_socket,
+                         std::string_view{receive_buffer.data(), complete_size},
+                         parser.take_streamed_values());
+
+        // The start of a partial command stays in the buffer until the rest of it arrives.
+        std::memmove(receive_buffer.data(),
+                     receive_buffer.data() + complete_size,
+                     number_of_pending_bytes - complete_size);
+        client_socket->next_valid_receive_index -= complete_size;
+    } else if (complete_size != 0) {
+        // The commands are handed over in the chunk they were received into. The start of a partial command moves to
+        // a new chunk until the rest of it arrives.
+        auto commands = receive_buffer.take_front(complete_size, number_of_pending_bytes);
+        client_socket->next_valid_receive_index -= complete_size;
+        dispatch_requests(reactor, session, client_socket, std::move(commands), parser.take_streamed_values());
+    }
+
+    if (parser.has_error()) {
+        // Nothing after the error can be parsed, the client is told why and disconnected after the replies to the
+        // commands before it.
+        session.protocol_error_reply = "-ERR " + parser.get_error() + "\r\n";
+        session.protocol_error_sequence = session.next_request_sequence++;
+        client_socket->next_valid_receive_index = 0;
+        send_protocol_error_when_due(reactor, session, client_socket);
+    }
+}
+
+void Redis::dispatch_requests(Reactor &reactor,
+                              ClientSession &session,
+                              TCPSocket *client_socket,
+                              BufferSlice commands,
+                              std::vector<std::string> streamed_values) {
+    // A single shard executes the commands as they are, without looking at them.
+    if (shards_.size() == 1) {
+        const auto sequence = session.next_request_sequence++;
+        send_request(reactor, 0, client_socket, std::move(commands), std::move(streamed_values), sequence);
+        return;
+    }
+
+    auto &tokenizer = reactor.tokenizer;
+    tokenizer.set_streamed_values(streamed_values);
+    const auto client_shard = static_cast<std::size_t>(client_socket->client_info->id % shards_.size());
+
+    // The request which is collected, it starts at the given command and streamed value.
+    auto request_shard = NO_SHARD;
+    std::size_t request_start{0};
+    std::size_t request_first_streamed_value{0};
+    const auto send_collected_request = [&](std::size_t end, std::size_t end_streamed_value) {
+        if (request_shard == NO_SHARD) {
+            return;
+        }
+
+        send_request(reactor,
+                     request_shard,
+                     client_socket,
+                     commands.subslice(request_start, end - request_start),
+                     {std::make_move_iterator(streamed_values.begin() + request_first_streamed_value),
+                      std::make_move_iterator(streamed_values.begin() + end_streamed_value)},
+                     session.next_request_sequence++);
+    };
+
+    const auto commands_view = commands.view();
+    std::size_t position{0};
+    while (position < commands_view.size()) {
+        const auto first_streamed_value = tokenizer.get_number_of_streamed_values_used();
+        auto shard =
+          get_command_shard(tokenizer.generate_command_tokens(commands_view.substr(position)), shards_.size());
+        const auto end = position + tokenizer.get_number_of_bytes_consumed();
+
+        if (shard == ALL_SHARDS) {
+            send_collected_request(position, first_streamed_value);
+            request_shard = NO_SHARD;
+
+            // Every shard gets the command, the network thread joins their replies.
+            const auto sequence = session.next_request_sequence++;
+            session.gathered_replies[sequence].number_of_missing_parts = shards_.size();
+            const auto first = streamed_values.begin() + first_streamed_value;
+            const auto last = streamed_values.begin() + tokenizer.get_number_of_streamed_values_used();
+            const auto command = commands.subslice(position, end - position);
+            for (std::size_t idx{0}; idx < shards_.size(); ++idx) {
+                send_request(reactor, idx, client_socket, command, {first, last}, sequence);
+            }
+        } else {
+            if (shard == ANY_SHARD) {
+                shard = request_shard != NO_SHARD ? request_shard : client_shard;
+            }
+
+            if (shard != request_shard) {
+                send_collected_request(position, first_streamed_value);
+                request_shard = shard;
+                request_start = position;
+                request_first_streamed_value = first_streamed_value;
+            }
+        }
+
+        position = end;
+    }
+
+    send_collected_request(commands.size(), streamed_values.size());
 }
 
-void Redis::run_message_handler() {
-    auto message_handler = MessageHandler{*this, data_manager_};
-    RequestMessage request_message;
+void Redis::send_request(Reactor &reactor,
+                         std::size_t shard_index,
+                         TCPSocket *client_socket,
+                         BufferSlice commands,
+                         std::vector<std::string> streamed_values,
+                         std::uint64_t sequence) {
+    auto &channel = *reactor.channels[shard_index];
+    RequestMessage request_message{client_socket->file_descriptor,
+                                   std::move(commands),
+                                   client_socket->client_info,
+                                   std::move(streamed_values),
+                                   sequence,
+                                   reactor.spare_buffers.take()};
+
+    // The requests which were read already wait in order, no more are read until the shard made room for them.
+    if (!channel.request_backlog.empty() || channel.requests.push_bulk(std::span{&request_message, 1}) == 0) {
+        channel.request_backlog.push_back(std::move(request_message));
+        if (!reactor.server.is_receiving_paused()) {
+            reactor.server.pause_receiving();
+            reactor.number_of_request_queue_full_pauses.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    wake_up_shard(*shards_[shard_index]);
+}
+
+void Redis::push_request_backlogs(Reactor &reactor) {
+    auto has_backlog = false;
+    for (std::size_t idx{0}; idx < reactor.channels.size(); ++idx) {
+        auto &channel = *reactor.channels[idx];
+        if (channel.request_backlog.empty()) {
+            continue;
+        }
+
+        while (!channel.request_backlog.empty() &&
+               channel.requests.push_bulk(std::span{&channel.request_backlog.front(), 1}) != 0) {
+            channel.request_backlog.pop_front();
+        }
+        wake_up_shard(*shards_[idx]);
+        has_backlog = has_backlog || !channel.request_backlog.empty();
+    }
+
+    if (!has_backlog) {
+        reactor.server.resume_receiving();
+    }
+}
+
+void Redis::execute_commands(Reactor &reactor,
+                             TCPSocket *client_socket,
+                             std::string_view commands,
+                             std::vector<std::string> streamed_values) {
+    auto &shard = *shards_.front();
+    auto &message_handler = shard.message_handler;
+    message_handler.set_streamed_values(streamed_values);
+    while (!commands.empty()) {
+        ResponseMessage response_message{client_socket->file_descriptor, reactor.spare_buffers.take()};
+        const auto result = message_handler.generate_pipeline_response(
+          commands, response_message.message, client_socket->client_info.get());
+        commands.remove_prefix(result.number_of_bytes);
+        shard.number_of_commands_processed.store(
+          shard.number_of_commands_processed.load(std::memory_order_relaxed) + result.number_of_commands,
+          std::memory_order_relaxed);
+
+        response_message.value = message_handler.take_response_value();
+        send_response(reactor, response_message);
+    }
+    message_handler.set_streamed_values({});
+}
+
+void Redis::run_tcp_servers() {
+    for (std::size_t idx{0}; idx < reactors_.size(); ++idx) {
+        reactors_[idx]->thread = std::jthread([this, idx, reactor = reactors_[idx].get()](std::stop_token stop_token) {
+            // Before the thread allocates its buffers.
+            if (!place_current_thread(reactor_cpus_, idx, reactor->placement)) {
+                std::cout << "Could not pin network thread " << idx << ", it runs on any CPU" << std::endl;
+            }
+            auto idle_strategy = IdleStrategy{idle_config_, reactor->idle_stats};
+
+            while (!stop_token.stop_requested()) {
+                // The poll takes the responses, see enqueue_responses().
+                if (!idle_strategy.on_iteration(reactor->server.poll())) {
+                    continue;
+                }
+
+                // A response pushed before the handler can see the flag would not wake the thread up, so the queue is
+                // checked again after the flag is set. The poll which is woken up sends the responses.
+                reactor->is_parked.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                const auto has_responses = std::ranges::any_of(reactor->channels, [](const auto &channel) {
+                    return !channel->responses.empty();
+                });
+                if (!has_responses && !stop_token.stop_requested()) {
+                    reactor->server.poll(-1);
+                }
+                reactor->is_parked.store(false, std::memory_order_relaxed);
+                idle_strategy.on_wake_up();
+            }
+        });
+    }
+}
+
+void Redis::run_shard(Shard &shard) {
+    // Before the shard inserts its first keys.
+    if (!place_current_thread(shard_cpus_, shard.index, shard.placement)) {
+        std::cout << "Could not pin shard " << shard.index << ", it runs on any CPU" << std::endl;
+    }
+    auto idle_strategy = IdleStrategy{idle_config_, shard.idle_stats};
+    std::vector<RequestMessage> request_messages(MAX_MESSAGES_PER_DRAIN);
     while (running_) {
-        if (message_queue_.pop(request_message)) {
-            std::cout << "message:\n" << request_message.message << std::endl;
-            auto response = message_handler.genera_response(request_message.message);
-            std::cout << "response:\n" << response << std::endl;
-            response_queue_.push({request_message.client_id, std::move(response)});
+        auto did_work = false;
+
+        // The requests of every reactor are served in turns, the response goes back to the reactor of the client.
+        // Everything a reactor queued is executed at once and the reactor is woken up once for all the responses.
+        for (auto &reactor : reactors_) {
+            auto &channel = *reactor->channels[shard.index];
+            const auto number_of_requests = channel.requests.pop_bulk(request_messages);
+            for (std::size_t idx{0}; idx < number_of_requests; ++idx) {
+                execute_pipeline(shard, *reactor, request_messages[idx]);
+                // The batch outlives the connection, it must not keep its bookkeeping alive.
+                request_messages[idx].client.reset();
+            }
+
+            if (number_of_requests != 0) {
+                wake_up_reactor(*reactor);
+                did_work = true;
+            }
+        }
+
+        if (idle_strategy.on_iteration(did_work)) {
+            park_shard(shard);
+            idle_strategy.on_wake_up();
+        }
+    }
+}
+
+void Redis::execute_pipeline(Shard &shard, Reactor &reactor, RequestMessage &request_message) {
+    auto &message_handler = shard.message_handler;
+    auto commands = request_message.message.view();
+    shard.spare_buffers.give_back(std::move(request_message.response_buffer));
+    message_handler.set_streamed_values(request_message.streamed_values);
+    while (!commands.empty()) {
+        auto responses = shard.spare_buffers.take();
+        const auto result =
+          message_handler.generate_pipeline_response(commands, responses, request_message.client.get());
+        commands.remove_prefix(result.number_of_bytes);
+        shard.number_of_commands_processed.store(
+          shard.number_of_commands_processed.load(std::memory_order_relaxed) + result.number_of_commands,
+          std::memory_order_relaxed);
+
+        const auto is_last = commands.empty();
+        push_response(shard,
+                      reactor,
+                      {request_message.client_id,
+                       std::move(responses),
+                       message_handler.take_response_value(),
+                       request_message.client->id,
+                       request_message.sequence,
+                       is_last,
+                       is_last ? std::move(request_message.message) : BufferSlice{}});
+    }
+    message_handler.set_streamed_values({});
+}
+
+void Redis::push_response(Shard &shard, Reactor &reactor, ResponseMessage response_message) {
+    // The slice of a request is released by the network thread only, a response cannot be dropped by the shard. The
+    // network thread is woken up to make room.
+    auto &responses = reactor.channels[shard.index]->responses;
+    if (responses.push_bulk(std::span{&response_message, 1}) != 0) {
+        return;
+    }
+
+    shard.number_of_response_queue_full_pauses.fetch_add(1, std::memory_order_relaxed);
+    do {
+        wake_up_reactor(reactor);
+        std::this_thread::yield();
+    } while (responses.push_bulk(std::span{&response_message, 1}) == 0 && running_);
+}
+
+bool Redis::enqueue_responses(Reactor &reactor) {
+    if (reactor.server.is_receiving_paused()) {
+        push_request_backlogs(reactor);
+    }
+
+    auto has_responses = false;
+    for (auto &channel : reactor.channels) {
+        const auto number_of_responses = channel->responses.pop_bulk(reactor.response_messages);
+        for (std::size_t idx{0}; idx < number_of_responses; ++idx) {
+            deliver_response(reactor, reactor.response_messages[idx]);
+            // The chunk of the commands goes back to the pool of the thread now, not when the slot is reused.
+            reactor.response_messages[idx].request.reset();
+        }
+        has_responses = has_responses || number_of_responses != 0;
+    }
+
+    return has_responses;
+}
+
+void Redis::deliver_response(Reactor &reactor, ResponseMessage &response_message) {
+    // The descriptor of a closed connection can belong to a new one already, which must not get the replies.
+    auto *client_socket = reactor.server.get_socket_to_send_to(response_message.client_id);
+    const auto is_connected =
+      client_socket != nullptr && client_socket->client_info->id == response_message.connection_id;
+    auto *session = is_connected ? static_cast<ClientSession *>(client_socket->protocol_state.get()) : nullptr;
+    if (session == nullptr || (shards_.size() > 1 && !gather_response(*session, response_message))) {
+        reactor.spare_buffers.give_back(std::move(response_message.message));
+        response_message.value.reset();
+        return;
+    }
+
+    // The responses of a single shard are in order already.
+    if (shards_.size() == 1) {
+        send_response(reactor, response_message);
+        session->next_reply_sequence += response_message.is_last ? 1 : 0;
+        send_protocol_error_when_due(reactor, *session, client_socket);
+        return;
+    }
+
+    if (response_message.sequence != session->next_reply_sequence) {
+        session->early_replies[response_message.sequence].push_back(std::move(response_message));
+        return;
+    }
+
+    send_response(reactor, response_message);
+    if (!response_message.is_last) {
+        return;
+    }
+    ++session->next_reply_sequence;
+
+    // Replies of the following requests which arrived before.
+    auto early_replies = session->early_replies.begin();
+    while (early_replies != session->early_replies.end() && early_replies->first == session->next_reply_sequence) {
+        const auto is_complete = early_replies->second.back().is_last;
+        for (auto &early_reply : early_replies->second) {
+            send_response(reactor, early_reply);
         }
+        early_replies = session->early_replies.erase(early_replies);
+
+        // The rest of them is sent as it arrives.
+        if (!is_complete) {
+            break;
+        }
+        ++session->next_reply_sequence;
+    }
+    send_protocol_error_when_due(reactor, *session, client_socket);
+}
+
+bool Redis::gather_response(ClientSession &session, ResponseMessage &response_message) {
+    const auto gathered_reply = session.gathered_replies.find(response_message.sequence);
+    if (gathered_reply == session.gathered_replies.end()) {
+        return true;
+    }
+
+    // *<number of elements>\r\n<elements>
+    auto &reply = gathered_reply->second;
+    const std::string_view part{response_message.message};
+    const auto header_end = part.starts_with('*') ? find_crlf(part, 1) : std::string_view::npos;
+    int number_of_elements{0};
+    if (header_end != std::string_view::npos && parse_length(part.substr(1, header_end - 1), number_of_elements) &&
+        number_of_elements >= 0) {
+        reply.number_of_elements += static_cast<std::size_t>(number_of_elements);
+        reply.elements.append(part.substr(header_end + 2));
+    } else if (reply.other_reply.empty()) {
+        reply.other_reply.assign(part);
+    }
+
+    if (--reply.number_of_missing_parts != 0) {
+        return false;
+    }
+
+    response_message.message.clear();
+    if (reply.other_reply.empty()) {
+        ReplyBuilder{response_message.message}.add_array_header(reply.number_of_elements);
+        response_message.message.append(reply.elements);
+    } else {
+        response_message.message.append(reply.other_reply);
+    }
+    session.gathered_replies.erase(gathered_reply);
+    return true;
+}
+
+void Redis::send_response(Reactor &reactor, ResponseMessage &response_message) {
+    const auto client_id = response_message.client_id;
+    reactor.server.enqueue_to_send_buffer(client_id, response_message.message);
+
+    if (const auto &value = response_message.value; value != nullptr) {
+        reactor.server.enqueue_to_send_buffer(client_id, *value, value);
+        reactor.server.enqueue_to_send_buffer(client_id, "\r\n");
+    }
+    reactor.spare_buffers.give_back(std::move(response_message.message));
+    // The send buffer holds its own reference to a large value, the batch must not keep it alive.
+    response_message.value.reset();
+}
+
+void Redis::send_protocol_error_when_due(Reactor &reactor, ClientSession &session, TCPSocket *client_socket) {
+    if (session.protocol_error_reply.empty() || session.next_reply_sequence != session.protocol_error_sequence) {
+        return;
+    }
+
+    reactor.server.enqueue_to_send_buffer(client_socket->file_descriptor, session.protocol_error_reply);
+    session.protocol_error_reply.clear();
+    reactor.server.kill_client(client_socket->client_info->id);
+}
+
+void Redis::park_shard(Shard &shard) {
+    const auto wake_ups = shard.wake_ups.load();
+
+    // Same handshake as for the network threads: set the flag, then check the queues again before waiting.
+    shard.is_parked.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    const auto has_requests = std::ranges::any_of(reactors_, [&shard](auto &reactor) {
+        return !reactor->channels[shard.index]->requests.empty();
+    });
+    if (!has_requests && running_) {
+        shard.wake_ups.wait(wake_ups);
+    }
+
+    shard.is_parked.store(false, std::memory_order_relaxed);
+}
+
+void Redis::wake_up_shard(Shard &shard) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (shard.is_parked.load(std::memory_order_relaxed)) {
+        shard.wake_ups.fetch_add(1);
+        shard.wake_ups.notify_one();
+    }
+}
+
+void Redis::wake_up_reactor(Reactor &reactor) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (reactor.is_parked.load(std::memory_order_relaxed)) {
+        reactor.server.wake_up();
+    }
+}
+
+void Redis::sample_stats() {
+    const auto now = std::chrono::steady_clock::now();
+    const auto number_of_commands = get_number_of_commands_processed();
+    const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_sample_time_).count();
+
+    if (elapsed_ms > 0) {
+        ops_per_sec_samples_[next_ops_per_sec_sample_] =
+          (number_of_commands - last_sampled_number_of_commands_) * 1000 / static_cast<std::uint64_t>(elapsed_ms);
+        next_ops_per_sec_sample_ = (next_ops_per_sec_sample_ + 1) % ops_per_sec_samples_.size();
+    }
+    last_sampled_number_of_commands_ = number_of_commands;
+    last_sample_time_ = now;
+
+    std::uint64_t sum{0};
+    for (const auto sample : ops_per_sec_samples_) {
+        sum += sample;
     }
+    instantaneous_ops_per_sec_.store(sum / ops_per_sec_samples_.size(), std::memory_order_relaxed);
 }
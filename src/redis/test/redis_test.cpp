@@ -2,9 +2,12 @@
 #include <iostream>
 #include <mutex>
 #include <queue>
+#include <sstream>
 #include <stop_token>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -13,17 +16,30 @@
 
 namespace {
 constexpr int LISTENING_PORT = 6000;
+constexpr int MULTI_REACTOR_LISTENING_PORT = 6001;
+constexpr int IDLE_LISTENING_PORT = 6002;
+constexpr int UNIX_SOCKET_LISTENING_PORT = 6003;
+constexpr int PROTOCOL_LISTENING_PORT = 6004;
+constexpr int SHARDED_LISTENING_PORT = 6005;
+constexpr int RUN_TO_COMPLETION_LISTENING_PORT = 6006;
+constexpr int BACKPRESSURE_LISTENING_PORT = 6009;
+constexpr int PLACEMENT_LISTENING_PORT = 6010;
+constexpr int LAZY_FREE_LISTENING_PORT = 6011;
+constexpr int REUSED_CONNECTION_LISTENING_PORT = 6012;
+// And the next two.
+constexpr int PROTOCOL_ERROR_LISTENING_PORT = 6013;
+constexpr auto UNIX_SOCKET_PATH = "/tmp/redis_test.sock";
 using namespace std::chrono_literals;
 
 class Client {
   public:
-    Client() {
+    explicit Client(int port = LISTENING_PORT) {
         TCPSocketConfig client_tcp_socket_config;
         client_tcp_socket_config.ip = '0';
         client_tcp_socket_config.is_listening = false;
         client_tcp_socket_config.is_blocking = false;
         client_tcp_socket_config.needs_so_timestamp = false;
-        client_tcp_socket_config.port = LISTENING_PORT;
+        client_tcp_socket_config.port = port;
 
         socket_fd_ = create_socket(client_tcp_socket_config);
         if (socket_fd_ < 0) {
@@ -31,6 +47,14 @@ class Client {
         }
     }
 
+    explicit Client(const std::string &unix_socket_path) {
+        TCPSocketConfig client_socket_config;
+        client_socket_config.is_blocking = false;
+        client_socket_config.unix_socket_path = unix_socket_path;
+
+        socket_fd_ = create_socket(client_socket_config);
+    }
+
     void enqueueMessage(const std::string &message) {
         messages_.push(message);
     }
@@ -75,6 +99,84 @@ class Client {
     std::queue<std::string> messages_;
 };
 
+int connect_blocking_client(int port) {
+    TCPSocketConfig client_tcp_socket_config;
+    client_tcp_socket_config.ip = '0';
+    client_tcp_socket_config.is_blocking = true;
+    client_tcp_socket_config.port = port;
+    return create_socket(client_tcp_socket_config);
+}
+
+void send_all(int client, std::string_view message) {
+    std::size_t bytes_sent{0};
+    while (bytes_sent < message.size()) {
+        const auto result = send(client, message.data() + bytes_sent, message.size() - bytes_sent, 0);
+        if (result <= 0) {
+            break;
+        }
+        bytes_sent += result;
+    }
+}
+
+// Receive exactly the given number of bytes, less only when the connection fails.
+std::string receive_all(int client, std::size_t size) {
+    std::string response(size, '\0');
+    std::size_t bytes_received{0};
+    while (bytes_received < size) {
+        const auto result = recv(client, response.data() + bytes_received, size - bytes_received, 0);
+        if (result <= 0) {
+            break;
+        }
+        bytes_received += result;
+    }
+    response.resize(bytes_received);
+    return response;
+}
+
+std::chrono::nanoseconds get_process_cpu_time() {
+    timespec cpu_time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_time);
+    return std::chrono::seconds{cpu_time.tv_sec} + std::chrono::nanoseconds{cpu_time.tv_nsec};
+}
+
+/**
+ * @brief Runs a server on its own thread for the lifetime of the object, like the RedisTest fixture does for its
+ * tests. The destructor stops the server before it joins the thread, also when a failed assertion returns early.
+ *
+ */
+class RunningRedis {
+  public:
+    explicit RunningRedis(RedisConfig config) : redis_server_{std::move(config)} {
+        server_thread_ = std::jthread([this]() { redis_server_.run(); });
+    }
+
+    ~RunningRedis() {
+        stop();
+    }
+
+    RunningRedis(const RunningRedis &) = delete;
+    RunningRedis &operator=(const RunningRedis &) = delete;
+
+    /**
+     * @brief Stop the server and wait for its thread. The statistics of the server can still be read afterwards.
+     *
+     */
+    void stop() {
+        if (server_thread_.joinable()) {
+            redis_server_.stop();
+            server_thread_.join();
+        }
+    }
+
+    Redis *operator->() {
+        return &redis_server_;
+    }
+
+  private:
+    Redis redis_server_;
+    std::jthread server_thread_;
+};
+
 } // namespace
 
 class RedisTest : public ::testing::Test {
@@ -176,6 +278,249 @@ TEST_F(RedisTest, setCommandWithExpiry) {
     client.run(expected_responses, delays);
 }
 
+// Values above the zero copy threshold are sent from the memory of the data manager instead of being copied into the
+// response, the reply has to look the same.
+TEST_F(RedisTest, largeValueIsSentWithoutCopy) {
+    TCPSocketConfig client_tcp_socket_config;
+    client_tcp_socket_config.ip = '0';
+    client_tcp_socket_config.is_blocking = true;
+    client_tcp_socket_config.port = LISTENING_PORT;
+    const auto client = create_socket(client_tcp_socket_config);
+
+    const auto receive = [client](std::size_t size) {
+        std::string response(size, '\0');
+        std::size_t bytes_received{0};
+        while (bytes_received < size) {
+            const auto result = recv(client, response.data() + bytes_received, size - bytes_received, 0);
+            if (result <= 0) {
+                break;
+            }
+            bytes_received += result;
+        }
+        return response;
+    };
+
+    std::string value(RedisConfig{}.zero_copy_threshold, 'v');
+    for (std::size_t idx{0}; idx < value.size(); idx += 1000) {
+        value[idx] = static_cast<char>('a' + (idx / 1000) % 26);
+    }
+    const auto bulk_value = "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+
+    const auto set_command = "*3\r\n$3\r\nSET\r\n$9\r\nlarge_key\r\n" + bulk_value;
+    send(client, set_command.data(), set_command.size(), 0);
+    EXPECT_EQ(receive(5), "+OK\r\n");
+
+    const std::string get_command = "*2\r\n$3\r\nGET\r\n$9\r\nlarge_key\r\n";
+    for (std::size_t idx{0}; idx < 3; ++idx) {
+        send(client, get_command.data(), get_command.size(), 0);
+        EXPECT_EQ(receive(bulk_value.size()), bulk_value);
+    }
+
+    close(client);
+}
+
+// Normal clients have no output buffer limit by default, a value larger than the largest buffer chunk is sent in full.
+TEST_F(RedisTest, valueAboveSixtyFourMebibytesIsSent) {
+    const auto client = connect_blocking_client(LISTENING_PORT);
+    std::string value(65 * 1024 * 1024, 'v');
+    for (std::size_t idx{0}; idx < value.size(); idx += 4096) {
+        value[idx] = static_cast<char>('a' + (idx / 4096) % 26);
+    }
+    const auto bulk_value = "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+
+    send_all(client, "*3\r\n$3\r\nSET\r\n$10\r\nhuge_value\r\n" + bulk_value);
+    EXPECT_EQ(receive_all(client, 5), "+OK\r\n");
+
+    send_all(client, "*2\r\n$3\r\nGET\r\n$10\r\nhuge_value\r\n");
+    EXPECT_TRUE(receive_all(client, bulk_value.size()) == bulk_value);
+
+    close(client);
+}
+
+// Commands sent with one write are all executed, in order, and answered together.
+TEST_F(RedisTest, pipelinedCommands) {
+    TCPSocketConfig client_tcp_socket_config;
+    client_tcp_socket_config.ip = '0';
+    client_tcp_socket_config.is_blocking = true;
+    client_tcp_socket_config.port = LISTENING_PORT;
+    const auto client = create_socket(client_tcp_socket_config);
+
+    std::string pipeline = "*1\r\n$4\r\nPING\r\n";
+    pipeline += "*3\r\n$3\r\nSET\r\n$12\r\npipeline_key\r\n$5\r\nvalue\r\n";
+    pipeline += "*2\r\n$3\r\nGET\r\n$12\r\npipeline_key\r\n";
+    pipeline += "*5\r\n$3\r\nSET\r\n$14\r\npipeline_key_2\r\n$5\r\nother\r\n$2\r\npx\r\n$5\r\n10000\r\n";
+    pipeline += "*2\r\n$4\r\nECHO\r\n$5\r\nhello\r\n";
+    pipeline += "*2\r\n$3\r\nGET\r\n$14\r\npipeline_key_2\r\n";
+    const std::string expected_responses = "+PONG\r\n+OK\r\n$5\r\nvalue\r\n+OK\r\n$5\r\nhello\r\n$5\r\nother\r\n";
+
+    send(client, pipeline.data(), pipeline.size(), 0);
+    std::string responses(expected_responses.size(), '\0');
+    std::size_t bytes_received{0};
+    while (bytes_received < responses.size()) {
+        const auto result = recv(client, responses.data() + bytes_received, responses.size() - bytes_received, 0);
+        if (result <= 0) {
+            break;
+        }
+        bytes_received += result;
+    }
+    EXPECT_EQ(responses, expected_responses);
+
+    close(client);
+}
+
+// A command which arrives in several reads is executed once it is complete.
+TEST_F(RedisTest, commandSplitAcrossReads) {
+    TCPSocketConfig client_tcp_socket_config;
+    client_tcp_socket_config.ip = '0';
+    client_tcp_socket_config.is_blocking = true;
+    client_tcp_socket_config.port = LISTENING_PORT;
+    const auto client = create_socket(client_tcp_socket_config);
+
+    const auto execute = [client](const std::string &command) {
+        send(client, command.data(), command.size(), 0);
+        std::string response(1024, '\0');
+        response.resize(std::max<ssize_t>(recv(client, response.data(), response.size(), 0), 0));
+        return response;
+    };
+
+    const std::string set_command = "*3\r\n$3\r\nSET\r\n$9\r\nsplit_key\r\n$11\r\nsplit_value\r\n";
+    const std::string ping_command = "*1\r\n$4\r\nPING\r\n";
+    for (const auto split : {2, 10, 30}) {
+        send(client, set_command.data(), split, 0);
+        std::this_thread::sleep_for(20ms);
+        const auto rest = set_command.substr(split);
+        if (split == 2) {
+            EXPECT_EQ(execute(rest), "+OK\r\n");
+        } else {
+            // A complete command and the start of the next one in a read.
+            EXPECT_EQ(execute(rest + ping_command.substr(0, 5)), "-ERR Key already exists: split_key\r\n");
+            EXPECT_EQ(execute(ping_command.substr(5)), "+PONG\r\n");
+        }
+    }
+    EXPECT_EQ(execute("*2\r\n$3\r\nGET\r\n$9\r\nsplit_key\r\n"), "$11\r\nsplit_value\r\n");
+
+    // Invalid input is answered with an error and the client is disconnected.
+    EXPECT_EQ(execute("GET split_key\r\n"), "-ERR Protocol error: expected '*', got 'G'\r\n");
+    char byte;
+    EXPECT_EQ(recv(client, &byte, 1, 0), 0);
+
+    close(client);
+}
+
+TEST_F(RedisTest, clientListAndKill) {
+    TCPSocketConfig client_tcp_socket_config;
+    client_tcp_socket_config.ip = '0';
+    client_tcp_socket_config.is_blocking = true;
+    client_tcp_socket_config.port = LISTENING_PORT;
+    const auto idle_client = create_socket(client_tcp_socket_config);
+    const auto client = create_socket(client_tcp_socket_config);
+
+    const auto execute = [client](const std::string &command) {
+        send(client, command.data(), command.size(), 0);
+        std::string response(4096, '\0');
+        const auto bytes_received = recv(client, response.data(), response.size(), 0);
+        response.resize(std::max<ssize_t>(bytes_received, 0));
+        return response;
+    };
+
+    EXPECT_EQ(execute("*1\r\n$4\r\nPING\r\n"), "+PONG\r\n");
+
+    const auto client_list = execute("*2\r\n$6\r\nCLIENT\r\n$4\r\nLIST\r\n");
+    ASSERT_EQ(client_list.front(), '$');
+    std::istringstream lines{client_list.substr(client_list.find("\r\n") + 2)};
+    std::string line;
+    std::string idle_client_id;
+    std::size_t number_of_clients{0};
+    while (std::getline(lines, line) && line != "\r") {
+        ++number_of_clients;
+        EXPECT_NE(line.find(" addr=127.0.0.1:"), std::string::npos) << line;
+        EXPECT_NE(line.find(" qbuf="), std::string::npos) << line;
+        EXPECT_NE(line.find(" omem="), std::string::npos) << line;
+        if (line.ends_with(" cmd=NULL")) {
+            idle_client_id = line.substr(3, line.find(' ') - 3);
+        } else {
+            EXPECT_TRUE(line.ends_with(" cmd=client")) << line;
+        }
+    }
+    EXPECT_EQ(number_of_clients, 2);
+    ASSERT_FALSE(idle_client_id.empty());
+
+    const auto kill_command = "*4\r\n$6\r\nCLIENT\r\n$4\r\nKILL\r\n$2\r\nID\r\n$" +
+                              std::to_string(idle_client_id.size()) + "\r\n" + idle_client_id + "\r\n";
+    EXPECT_EQ(execute(kill_command), ":1\r\n");
+
+    char byte;
+    EXPECT_EQ(recv(idle_client, &byte, 1, 0), 0);
+    EXPECT_EQ(execute(kill_command), ":0\r\n");
+    EXPECT_EQ(execute("*3\r\n$6\r\nCLIENT\r\n$4\r\nKILL\r\n$9\r\n1.2.3.4:5\r\n"), "-ERR No such client\r\n");
+
+    close(idle_client);
+    close(client);
+}
+
+TEST_F(RedisTest, commandTable) {
+    TCPSocketConfig client_tcp_socket_config;
+    client_tcp_socket_config.ip = '0';
+    client_tcp_socket_config.is_blocking = true;
+    client_tcp_socket_config.port = LISTENING_PORT;
+    const auto client = create_socket(client_tcp_socket_config);
+
+    const auto execute = [client](const std::string &command) {
+        send(client, command.data(), command.size(), 0);
+        std::string response(4096, '\0');
+        response.resize(std::max<ssize_t>(recv(client, response.data(), response.size(), 0), 0));
+        return response;
+    };
+
+    EXPECT_EQ(execute("*1\r\n$4\r\nping\r\n"), "+PONG\r\n");
+    EXPECT_EQ(execute("*2\r\n$4\r\nPiNg\r\n$5\r\nhello\r\n"), "$5\r\nhello\r\n");
+    EXPECT_EQ(execute("*2\r\n$3\r\nSET\r\n$3\r\nkey\r\n"), "-ERR wrong number of arguments for 'set' command\r\n");
+    EXPECT_EQ(execute("*3\r\n$3\r\nGET\r\n$3\r\nkey\r\n$3\r\nkey\r\n"),
+              "-ERR wrong number of arguments for 'get' command\r\n");
+    EXPECT_EQ(execute("*4\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n$2\r\npx\r\n"), "-ERR syntax error\r\n");
+    EXPECT_EQ(execute("*1\r\n$4\r\nHSET\r\n"), "-ERR Unknown command: HSET\r\n");
+
+    EXPECT_EQ(execute("*2\r\n$7\r\nCOMMAND\r\n$5\r\nCOUNT\r\n"), ":9\r\n");
+    EXPECT_EQ(execute("*4\r\n$7\r\nCOMMAND\r\n$4\r\nINFO\r\n$3\r\nget\r\n$4\r\nnope\r\n"),
+              "*2\r\n*6\r\n$3\r\nget\r\n:2\r\n*2\r\n+readonly\r\n+fast\r\n:1\r\n:1\r\n:1\r\n*-1\r\n");
+
+    // Only commands which were executed are counted.
+    const auto command_stats = execute("*2\r\n$4\r\nINFO\r\n$12\r\ncommandstats\r\n");
+    EXPECT_NE(command_stats.find("cmdstat_ping:calls=2\n"), std::string::npos) << command_stats;
+    EXPECT_NE(command_stats.find("cmdstat_set:calls=1\n"), std::string::npos) << command_stats;
+    EXPECT_EQ(command_stats.find("cmdstat_get"), std::string::npos) << command_stats;
+
+    close(client);
+}
+
+TEST_F(RedisTest, infoStats) {
+    std::queue<std::string> expected_responses;
+    for (std::size_t idx{0}; idx < 3; ++idx) {
+        expected_responses.push("+PONG\r\n");
+    }
+    const std::string stats = "total_commands_processed:3\ninstantaneous_ops_per_sec:";
+
+    Client client;
+    for (std::size_t idx{0}; idx < 3; ++idx) {
+        client.enqueueMessage("*1\r\n$4\r\nPING\r\n");
+    }
+    client.run(expected_responses);
+
+    TCPSocketConfig client_tcp_socket_config;
+    client_tcp_socket_config.ip = '0';
+    client_tcp_socket_config.is_blocking = true;
+    client_tcp_socket_config.port = LISTENING_PORT;
+    const auto info_client = create_socket(client_tcp_socket_config);
+
+    const std::string info_command = "*2\r\n$4\r\nINFO\r\n$5\r\nstats\r\n";
+    send(info_client, info_command.data(), info_command.size(), 0);
+    std::string response(1024, '\0');
+    response.resize(std::max<ssize_t>(recv(info_client, response.data(), response.size(), 0), 0));
+    EXPECT_NE(response.find(stats), std::string::npos) << response;
+
+    close(info_client);
+}
+
 TEST_F(RedisTest, stressTest) {
     const auto create_client = [](std::string message, std::size_t repeat) {
         std::string echo_command = "*2\r\n$4\r\nECHO\r\n";
@@ -232,3 +577,448 @@ TEST_F(RedisTest, stressTest) {
 
     std::this_thread::sleep_for(std::chrono::seconds(1));
 }
+
+// Local clients can use the Unix domain socket next to the TCP port, also when there are several reactors.
+TEST(RedisUnixSocketTest, commandsOverUnixSocket) {
+    auto config = RedisConfig{{}, UNIX_SOCKET_LISTENING_PORT, {}, 2};
+    config.unix_socket_path = UNIX_SOCKET_PATH;
+    RunningRedis redis_server{config};
+
+    std::queue<std::string> expected_responses;
+    expected_responses.push("+PONG\r\n");
+    expected_responses.push("+OK\r\n");
+    expected_responses.push("$5\r\nvalue\r\n");
+
+    Client client{UNIX_SOCKET_PATH};
+    client.enqueueMessage("*1\r\n$4\r\nPING\r\n");
+    client.enqueueMessage("*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n");
+    client.enqueueMessage("*2\r\n$3\r\nGET\r\n$3\r\nkey\r\n");
+    client.run(expected_responses);
+}
+
+// Several reactors listen on the same port and the kernel spreads the clients over them. Every client has to get its
+// own response back regardless of the reactor it landed on.
+TEST(RedisMultiReactorTest, clientsOfAllReactorsAreServed) {
+    constexpr std::size_t number_of_reactors = 4;
+    constexpr std::size_t number_of_clients = 16;
+
+    RunningRedis redis_server{RedisConfig{{}, MULTI_REACTOR_LISTENING_PORT, {}, number_of_reactors}};
+
+    std::vector<std::jthread> client_threads;
+    for (std::size_t idx{0}; idx < number_of_clients; ++idx) {
+        client_threads.emplace_back([idx]() {
+            const auto message = "client_" + std::to_string(idx);
+            const auto bulk_string = "$" + std::to_string(message.size()) + "\r\n" + message + "\r\n";
+
+            std::queue<std::string> expected_responses;
+            expected_responses.push(bulk_string);
+
+            Client client{MULTI_REACTOR_LISTENING_PORT};
+            client.enqueueMessage("*2\r\n$4\r\nECHO\r\n" + bulk_string);
+            client.run(expected_responses);
+        });
+    }
+
+    for (auto &client_thread : client_threads) {
+        client_thread.join();
+    }
+}
+
+// Large values are streamed out of the receive buffer of the connection. A bulk string above proto-max-bulk-len is
+// rejected as soon as its header arrives, before its payload is sent.
+TEST(RedisProtocolTest, largeBulkStringsUpToTheLimit) {
+    RedisConfig config{{}, PROTOCOL_LISTENING_PORT, {}};
+    config.proto_max_bulk_len = 4 * 1024 * 1024;
+    RunningRedis redis_server{config};
+
+    TCPSocketConfig client_tcp_socket_config;
+    client_tcp_socket_config.ip = '0';
+    client_tcp_socket_config.is_blocking = true;
+    client_tcp_socket_config.port = PROTOCOL_LISTENING_PORT;
+    const auto client = create_socket(client_tcp_socket_config);
+
+    const auto receive = [client](std::size_t size) {
+        std::string response(size, '\0');
+        std::size_t bytes_received{0};
+        while (bytes_received < size) {
+            const auto result = recv(client, response.data() + bytes_received, size - bytes_received, 0);
+            if (result <= 0) {
+                break;
+            }
+            bytes_received += result;
+        }
+        response.resize(bytes_received);
+        return response;
+    };
+
+    std::string value(config.proto_max_bulk_len, 'v');
+    for (std::size_t idx{0}; idx < value.size(); idx += 1000) {
+        value[idx] = static_cast<char>('a' + (idx / 1000) % 26);
+    }
+    const auto bulk_value = "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+
+    const auto set_command = "*3\r\n$3\r\nSET\r\n$9\r\nlarge_key\r\n" + bulk_value;
+    send(client, set_command.data(), set_command.size(), 0);
+    EXPECT_EQ(receive(5), "+OK\r\n");
+
+    const std::string get_command = "*2\r\n$3\r\nGET\r\n$9\r\nlarge_key\r\n";
+    send(client, get_command.data(), get_command.size(), 0);
+    EXPECT_EQ(receive(bulk_value.size()), bulk_value);
+
+    const auto too_large_set_command =
+      "*3\r\n$3\r\nSET\r\n$9\r\nlarge_key\r\n$" + std::to_string(value.size() + 1) + "\r\n";
+    send(client, too_large_set_command.data(), too_large_set_command.size(), 0);
+    const std::string error = "-ERR Protocol error: invalid bulk length\r\n";
+    EXPECT_EQ(receive(error.size()), error);
+    EXPECT_EQ(receive(1), "");
+
+    close(client);
+}
+
+// The commands of a pipeline are executed by the shards of their keys, the client gets the replies in the order of
+// the commands. KEYS is executed by every shard and its replies are joined.
+TEST(RedisShardTest, pipelineAcrossShardsIsAnsweredInOrder) {
+    RedisConfig config{{}, SHARDED_LISTENING_PORT, {}, 2};
+    config.number_of_shards = 4;
+    RunningRedis redis_server{config};
+
+    TCPSocketConfig client_tcp_socket_config;
+    client_tcp_socket_config.ip = '0';
+    client_tcp_socket_config.is_blocking = true;
+    client_tcp_socket_config.port = SHARDED_LISTENING_PORT;
+    const auto client = create_socket(client_tcp_socket_config);
+
+    const auto send_all = [client](const std::string &message) {
+        std::size_t bytes_sent{0};
+        while (bytes_sent < message.size()) {
+            const auto result = send(client, message.data() + bytes_sent, message.size() - bytes_sent, 0);
+            if (result <= 0) {
+                break;
+            }
+            bytes_sent += result;
+        }
+    };
+    const auto receive = [client](std::size_t size) {
+        std::string response(size, '\0');
+        std::size_t bytes_received{0};
+        while (bytes_received < size) {
+            const auto result = recv(client, response.data() + bytes_received, size - bytes_received, 0);
+            if (result <= 0) {
+                break;
+            }
+            bytes_received += result;
+        }
+        response.resize(bytes_received);
+        return response;
+    };
+    const auto to_bulk_string = [](const std::string &value) {
+        return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+    };
+
+    // The value of the last key is streamed out of the receive buffer.
+    constexpr std::size_t NUMBER_OF_KEYS = 200;
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+    for (std::size_t idx{0}; idx < NUMBER_OF_KEYS; ++idx) {
+        keys.push_back("key_" + std::to_string(idx));
+        values.push_back(idx + 1 == NUMBER_OF_KEYS ? std::string(64 * 1024, 'v') : "value_" + std::to_string(idx));
+    }
+
+    std::string pipeline;
+    std::string expected_responses;
+    for (std::size_t idx{0}; idx < NUMBER_OF_KEYS; ++idx) {
+        pipeline += "*3\r\n$3\r\nSET\r\n" + to_bulk_string(keys[idx]) + to_bulk_string(values[idx]);
+        expected_responses += "+OK\r\n";
+        if (idx % 10 == 0) {
+            pipeline += "*2\r\n$4\r\nECHO\r\n" + to_bulk_string(keys[idx]);
+            expected_responses += to_bulk_string(keys[idx]);
+        }
+    }
+    for (std::size_t idx{0}; idx < NUMBER_OF_KEYS; ++idx) {
+        pipeline += "*2\r\n$3\r\nGET\r\n" + to_bulk_string(keys[idx]);
+        expected_responses += to_bulk_string(values[idx]);
+    }
+    pipeline += "*2\r\n$3\r\nGET\r\n$7\r\nmissing\r\n*1\r\n$4\r\nPING\r\n";
+    expected_responses += "$-1\r\n+PONG\r\n";
+
+    send_all(pipeline);
+    EXPECT_EQ(receive(expected_responses.size()), expected_responses);
+
+    // The keys of every shard, in any order, in one array.
+    send_all("*2\r\n$4\r\nKEYS\r\n$1\r\n*\r\n");
+    std::string expected_keys_reply = "*" + std::to_string(NUMBER_OF_KEYS) + "\r\n";
+    for (const auto &key : keys) {
+        expected_keys_reply += to_bulk_string(key);
+    }
+    auto keys_reply = receive(expected_keys_reply.size());
+    EXPECT_TRUE(keys_reply.starts_with("*" + std::to_string(NUMBER_OF_KEYS) + "\r\n")) << keys_reply.substr(0, 16);
+    for (const auto &key : keys) {
+        EXPECT_NE(keys_reply.find(to_bulk_string(key)), std::string::npos) << key;
+    }
+
+    // The calls of every shard are counted.
+    EXPECT_EQ(redis_server->get_number_of_shards(), 4);
+    send_all("*2\r\n$4\r\nINFO\r\n$12\r\ncommandstats\r\n");
+    std::string command_stats(1024, '\0');
+    command_stats.resize(std::max<ssize_t>(recv(client, command_stats.data(), command_stats.size(), 0), 0));
+    EXPECT_NE(command_stats.find("cmdstat_set:calls=" + std::to_string(NUMBER_OF_KEYS) + "\n"), std::string::npos)
+      << command_stats;
+    EXPECT_NE(command_stats.find("cmdstat_keys:calls=4\n"), std::string::npos) << command_stats;
+
+    close(client);
+}
+
+// The network thread executes the commands itself, large values are still streamed in and sent without a copy.
+TEST(RedisRunToCompletionTest, commandsAreExecutedOnTheNetworkThread) {
+    RedisConfig config{{}, RUN_TO_COMPLETION_LISTENING_PORT, {}, 2};
+    config.number_of_shards = 4;
+    config.run_to_completion = true;
+    RunningRedis redis_server{config};
+
+    EXPECT_EQ(redis_server->get_number_of_reactors(), 1);
+    EXPECT_EQ(redis_server->get_number_of_shards(), 1);
+
+    const auto client = connect_blocking_client(RUN_TO_COMPLETION_LISTENING_PORT);
+    const std::string large_value(256 * 1024, 'v');
+    const auto large_bulk_string = "$" + std::to_string(large_value.size()) + "\r\n" + large_value + "\r\n";
+
+    // The pipeline is split across reads, the commands of each read are answered in order.
+    const std::string pipeline = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n"
+                                 "*3\r\n$3\r\nSET\r\n$5\r\nlarge\r\n" +
+                                 large_bulk_string +
+                                 "*2\r\n$3\r\nGET\r\n$3\r\nkey\r\n"
+                                 "*2\r\n$3\r\nGET\r\n$5\r\nlarge\r\n"
+                                 "*1\r\n$4\r\nPING\r\n";
+    const auto expected_responses = "+OK\r\n+OK\r\n$5\r\nvalue\r\n" + large_bulk_string + "+PONG\r\n";
+    send_all(client, pipeline.substr(0, 20));
+    std::this_thread::sleep_for(10ms);
+    send_all(client, pipeline.substr(20));
+    EXPECT_EQ(receive_all(client, expected_responses.size()), expected_responses);
+
+    send_all(client, "*2\r\n$4\r\nINFO\r\n$7\r\nthreads\r\n");
+    std::string threads(1024, '\0');
+    threads.resize(std::max<ssize_t>(recv(client, threads.data(), threads.size(), 0), 0));
+    EXPECT_NE(threads.find("execution_mode:run_to_completion\n"), std::string::npos) << threads;
+    EXPECT_NE(threads.find("reactor_0:"), std::string::npos) << threads;
+    EXPECT_EQ(threads.find("shard_0:"), std::string::npos) << threads;
+    EXPECT_EQ(redis_server->get_number_of_commands_processed(), 6);
+
+    close(client);
+}
+
+// With queues of a single entry the network thread stops reading while a shard is busy and the shard waits for the
+// network thread to take its responses. Every command is still answered, in order.
+TEST(RedisBackpressureTest, fullQueuesDelayCommandsWithoutLosingThem) {
+    RedisConfig config{{}, BACKPRESSURE_LISTENING_PORT, {}};
+    config.number_of_shards = 4;
+    config.queue_size = 1;
+    RunningRedis redis_server{config};
+
+    const auto client = connect_blocking_client(BACKPRESSURE_LISTENING_PORT);
+    const auto to_bulk_string = [](const std::string &value) {
+        return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+    };
+
+    // Consecutive keys are mostly owned by different shards, each command is a request of its own. The large values
+    // end the responses of a request, the repeated GET at the end is a request with several responses.
+    constexpr std::size_t NUMBER_OF_KEYS = 500;
+    std::string pipeline;
+    std::string expected_responses;
+    std::string gets;
+    std::string expected_values;
+    for (std::size_t idx{0}; idx < NUMBER_OF_KEYS; ++idx) {
+        const auto key = to_bulk_string("key_" + std::to_string(idx));
+        const auto value = to_bulk_string(idx % 50 == 0 ? std::string(64 * 1024, 'v') : "value_" + std::to_string(idx));
+        pipeline += "*3\r\n$3\r\nSET\r\n" + key + value;
+        expected_responses += "+OK\r\n";
+        gets += "*2\r\n$3\r\nGET\r\n" + key;
+        expected_values += value;
+    }
+    for (std::size_t idx{0}; idx < 4; ++idx) {
+        gets += "*2\r\n$3\r\nGET\r\n$5\r\nkey_0\r\n";
+        expected_values += to_bulk_string(std::string(64 * 1024, 'v'));
+    }
+    pipeline += gets;
+    expected_responses += expected_values;
+
+    auto sender = std::jthread([&]() { send_all(client, pipeline); });
+    EXPECT_EQ(receive_all(client, expected_responses.size()), expected_responses);
+    sender.join();
+
+    EXPECT_GT(redis_server->get_number_of_request_queue_full_pauses(), 0);
+    EXPECT_GT(redis_server->get_number_of_response_queue_full_pauses(), 0);
+    EXPECT_EQ(redis_server->get_number_of_commands_processed(), 2 * NUMBER_OF_KEYS + 4);
+
+    send_all(client, "*2\r\n$4\r\nINFO\r\n$5\r\nstats\r\n");
+    std::string stats(1024, '\0');
+    stats.resize(std::max<ssize_t>(recv(client, stats.data(), stats.size(), 0), 0));
+    EXPECT_NE(stats.find("request_queue_full_pauses:"), std::string::npos) << stats;
+    EXPECT_NE(stats.find("response_queue_full_pauses:"), std::string::npos) << stats;
+
+    close(client);
+}
+
+TEST(RedisPlacementTest, threadsArePinnedToTheirCpus) {
+    RedisConfig config{{}, PLACEMENT_LISTENING_PORT};
+    config.number_of_shards = 2;
+    config.reactor_cpus = {0};
+    config.shard_cpus = {0};
+    RunningRedis redis_server{config};
+
+    // Every thread places itself when it starts.
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while ((redis_server->get_reactor_placement(0).cpu.load() == -1 ||
+            redis_server->get_shard_placement(0).cpu.load() == -1 ||
+            redis_server->get_shard_placement(1).cpu.load() == -1) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    const auto client = connect_blocking_client(PLACEMENT_LISTENING_PORT);
+    send_all(client, "*2\r\n$4\r\nINFO\r\n$7\r\nthreads\r\n");
+    std::string threads(1024, '\0');
+    threads.resize(std::max<ssize_t>(recv(client, threads.data(), threads.size(), 0), 0));
+    const auto placement = ",cpu=0,numa_node=" + std::to_string(get_numa_node(0)) + '\n';
+    for (const auto *thread_name : {"reactor_0:", "shard_0:", "shard_1:"}) {
+        const auto line = threads.find(thread_name);
+        EXPECT_NE(line, std::string::npos) << threads;
+        if (line == std::string::npos) {
+            continue;
+        }
+        EXPECT_EQ(threads.substr(threads.find(",cpu=", line), placement.size()), placement) << threads;
+    }
+
+    close(client);
+}
+
+TEST(RedisPlacementTest, unavailableCpuIsRejected) {
+    RedisConfig config{{}, PLACEMENT_LISTENING_PORT};
+    config.shard_cpus = {0, CPU_SETSIZE};
+
+    EXPECT_THROW(Redis{config}, std::invalid_argument);
+}
+
+TEST(RedisLazyFreeTest, expiredLargeValuesAreFreedInTheBackground) {
+    RedisConfig config{{}, LAZY_FREE_LISTENING_PORT};
+    config.lazy_free_threshold = 4096;
+    RunningRedis redis_server{config};
+
+    const auto client = connect_blocking_client(LAZY_FREE_LISTENING_PORT);
+    const std::string large_value(4096, 'v');
+    send_all(client, "*5\r\n$3\r\nSET\r\n$5\r\nlarge\r\n$4096\r\n" + large_value + "\r\n$2\r\npx\r\n$2\r\n10\r\n" +
+                       "*5\r\n$3\r\nSET\r\n$5\r\nsmall\r\n$5\r\nvalue\r\n$2\r\npx\r\n$2\r\n10\r\n");
+    EXPECT_EQ(receive_all(client, 10), "+OK\r\n+OK\r\n");
+
+    std::this_thread::sleep_for(20ms);
+    send_all(client, "*2\r\n$3\r\nGET\r\n$5\r\nlarge\r\n*2\r\n$3\r\nGET\r\n$5\r\nsmall\r\n");
+    EXPECT_EQ(receive_all(client, 10), "$-1\r\n$-1\r\n");
+
+    // Only the large value went to the worker.
+    auto &background_jobs = redis_server->get_background_jobs();
+    background_jobs.wait_for_completion(BackgroundJobType::lazy_free);
+    EXPECT_EQ(background_jobs.get_number_of_processed_jobs(BackgroundJobType::lazy_free), 1);
+
+    send_all(client, "*2\r\n$4\r\nINFO\r\n$7\r\nthreads\r\n");
+    std::string threads(2048, '\0');
+    threads.resize(std::max<ssize_t>(recv(client, threads.data(), threads.size(), 0), 0));
+    EXPECT_NE(threads.find("background_lazy_free:pending=0,processed=1,"), std::string::npos) << threads;
+    EXPECT_NE(threads.find("background_fsync:pending=0,processed=0,"), std::string::npos) << threads;
+
+    close(client);
+}
+
+// The commands before a protocol error are answered, then the error is sent and the client is disconnected.
+TEST(RedisProtocolTest, commandsBeforeAProtocolErrorAreAnswered) {
+    const std::string pipeline = "*1\r\n$4\r\nPING\r\n*2\r\n$4\r\nECHO\r\n$2\r\nhi\r\n#garbage\r\n";
+    const std::string expected_responses = "+PONG\r\n$2\r\nhi\r\n-ERR Protocol error: expected '*', got '#'\r\n";
+
+    for (int idx{0}; idx < 3; ++idx) {
+        const auto port = PROTOCOL_ERROR_LISTENING_PORT + idx;
+        RedisConfig config{{}, port};
+        config.number_of_shards = idx == 1 ? 2 : 1;
+        config.run_to_completion = idx == 2;
+        RunningRedis redis_server{config};
+
+        const auto client = connect_blocking_client(port);
+        send_all(client, pipeline);
+        EXPECT_EQ(receive_all(client, expected_responses.size()), expected_responses) << idx;
+        char byte;
+        EXPECT_EQ(recv(client, &byte, 1, 0), 0) << idx;
+
+        close(client);
+    }
+}
+
+// Replies which are still queued for a closed connection are not sent to a new connection with the same descriptor.
+TEST(RedisConnectionTest, repliesOfAClosedConnectionAreDropped) {
+    RunningRedis redis_server{RedisConfig{{}, REUSED_CONNECTION_LISTENING_PORT}};
+
+    const std::string payload(1024, 'p');
+    std::string pipeline;
+    for (std::size_t idx{0}; idx < 2000; ++idx) {
+        pipeline += "*2\r\n$4\r\nECHO\r\n$1024\r\n" + payload + "\r\n";
+    }
+
+    for (std::size_t round{0}; round < 10; ++round) {
+        const auto closed_client = connect_blocking_client(REUSED_CONNECTION_LISTENING_PORT);
+        send_all(closed_client, pipeline);
+        close(closed_client);
+
+        const auto client = connect_blocking_client(REUSED_CONNECTION_LISTENING_PORT);
+        send_all(client, "*2\r\n$4\r\nECHO\r\n$5\r\nfresh\r\n");
+        EXPECT_EQ(receive_all(client, 11), "$5\r\nfresh\r\n");
+        close(client);
+    }
+}
+
+// With spin-then-park an idle server blocks its threads instead of burning a core each, and still answers requests.
+TEST(RedisIdleTest, idleThreadsAreParked) {
+    RedisConfig config{{}, IDLE_LISTENING_PORT, {}, 2};
+    config.idle_config = IdleConfig{IdlePolicy::spin_then_park, 100us};
+
+    RunningRedis redis_server{config};
+
+    std::queue<std::string> expected_responses;
+    expected_responses.push("+PONG\r\n");
+    Client client{IDLE_LISTENING_PORT};
+    client.enqueueMessage("*1\r\n$4\r\nPING\r\n");
+    client.run(expected_responses);
+
+    std::this_thread::sleep_for(10ms);
+    const auto cpu_time_before = get_process_cpu_time();
+    std::this_thread::sleep_for(500ms);
+    const auto cpu_time = get_process_cpu_time() - cpu_time_before;
+
+    // Three busy polling threads would use 1.5s, parked threads close to nothing.
+    EXPECT_LT(cpu_time, 50ms);
+
+    // Parked threads are woken up by a new request.
+    expected_responses.push("+PONG\r\n");
+    client.enqueueMessage("*1\r\n$4\r\nPING\r\n");
+    client.run(expected_responses);
+
+    redis_server.stop();
+
+    const auto &shard_stats = redis_server->get_shard_idle_stats(0);
+    EXPECT_GT(shard_stats.number_of_parks.load(), 0);
+    EXPECT_GT(shard_stats.parked_ns.load(), shard_stats.spinning_ns.load());
+    for (std::size_t idx{0}; idx < redis_server->get_number_of_reactors(); ++idx) {
+        const auto &stats = redis_server->get_reactor_idle_stats(idx);
+        EXPECT_GT(stats.number_of_parks.load(), 0);
+        EXPECT_GT(stats.parked_ns.load(), stats.spinning_ns.load());
+    }
+}
+
+TEST(RedisIdleTest, busyPollingThreadsNeverPark) {
+    RedisConfig config{{}, IDLE_LISTENING_PORT, {}, 1};
+    config.idle_config.policy = IdlePolicy::busy_poll;
+
+    RunningRedis redis_server{config};
+    std::this_thread::sleep_for(100ms);
+
+    redis_server.stop();
+
+    EXPECT_EQ(redis_server->get_shard_idle_stats(0).number_of_parks.load(), 0);
+    EXPECT_EQ(redis_server->get_reactor_idle_stats(0).number_of_parks.load(), 0);
+    EXPECT_GT(redis_server->get_reactor_idle_stats(0).spinning_ns.load(), 0);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "thread_placement.hpp"
+
+enum class BackgroundJobType : std::size_t {
+    // Free large values which were removed from the keyspace.
+    lazy_free,
+    // Close file descriptors whose last close may block, e.g. of an unlinked file.
+    close_file,
+    // Flush written files to the disk.
+    fsync,
+};
+
+inline constexpr std::size_t NUMBER_OF_BACKGROUND_JOB_TYPES = 3;
+inline constexpr std::array<std::string_view, NUMBER_OF_BACKGROUND_JOB_TYPES> BACKGROUND_JOB_TYPE_NAMES{
+  "lazy_free", "close_file", "fsync"};
+
+/**
+ * @brief Runs slow work off the threads which serve the clients. Every type of job has its own queue and worker
+ * thread, the jobs of a type run one after another in the order they were submitted. A slow fsync does not hold up
+ * freeing memory.
+ *
+ * Jobs are submitted from any thread. Queued jobs still run when the executor is destroyed.
+ */
+class BackgroundJobs {
+  public:
+    using Job = std::function<void()>;
+
+    /**
+     * @param cpus CPUs the workers are pinned to, the worker of a type gets the CPU at its index. Empty leaves them to
+     * the scheduler.
+     */
+    explicit BackgroundJobs(std::vector<int> cpus = {});
+    ~BackgroundJobs();
+    BackgroundJobs(const BackgroundJobs &) = delete;
+    BackgroundJobs &operator=(const BackgroundJobs &) = delete;
+
+    void submit(BackgroundJobType type, Job job);
+
+    /**
+     * @brief Block until every job of the type which was submitted before the call has run.
+     *
+     */
+    void wait_for_completion(BackgroundJobType type);
+
+    /**
+     * @return Jobs of the type which were submitted and did not finish yet.
+     */
+    std::size_t get_number_of_pending_jobs(BackgroundJobType type) const;
+    std::uint64_t get_number_of_processed_jobs(BackgroundJobType type) const;
+    const ThreadPlacement &get_placement(BackgroundJobType type) const;
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+        // Guarded by the mutex, a waiter waits until the jobs before its ticket are done.
+        std::uint64_t number_of_submitted_jobs{0};
+        // The worker parks on the wake up counter, a submit increments it.
+        std::atomic<std::uint32_t> wake_ups{0};
+        // Waiters park on it.
+        std::atomic<std::uint64_t> number_of_done_jobs{0};
+        std::atomic<std::size_t> number_of_pending_jobs{0};
+        ThreadPlacement placement;
+        std::jthread thread;
+    };
+
+    Queue &get_queue(BackgroundJobType type) const {
+        return *queues_[static_cast<std::size_t>(type)];
+    }
+
+    void run_worker(Queue &queue, std::size_t index, std::stop_token stop_token);
+
+    std::vector<int> cpus_;
+    std::array<std::unique_ptr<Queue>, NUMBER_OF_BACKGROUND_JOB_TYPES> queues_;
+};
@@ -0,0 +1,455 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief A hash map with open addressing, all entries are stored in one array instead of a node each.
+ *
+ * The slots are split into groups of 16. Every slot has a control byte, which says whether the slot is empty, deleted
+ * or full, and for a full slot holds 7 bits of the hash of its key. A lookup compares the control bytes of a whole
+ * group at once with SSE2 and only compares the keys of the slots whose bits match, so a lookup usually touches one
+ * cache line of control bytes and the slot of the key. The groups are probed quadratically, the table grows when it is
+ * 7/8 full.
+ *
+ * Lookups and insertions take anything the hash and the key equal accept, e.g. a std::string_view for std::string keys
+ * with transparent functors. A key is only constructed when it is inserted.
+ *
+ * Insertions invalidate the iterators and references, an erase only the iterators and references to the erased entry.
+ *
+ * @tparam Key Type of the keys, which must not be modified through an iterator.
+ */
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap {
+  public:
+    using value_type = std::pair<Key, Value>;
+
+  private:
+    using Control = std::int8_t;
+
+    static constexpr Control EMPTY = -128;
+    static constexpr Control DELETED = -2;
+    static constexpr std::size_t GROUP_SIZE = 16;
+
+    /**
+     * @brief Control bytes of a group, matched against a control byte. Bit n of a mask is set when slot n of the group
+     * matches.
+     *
+     */
+    class Group {
+      public:
+        explicit Group(const Control *control) {
+#ifdef __SSE2__
+            control_ = _mm_load_si128(reinterpret_cast<const __m128i *>(control));
+#else
+            std::memcpy(control_, control, GROUP_SIZE);
+#endif
+        }
+
+        std::uint32_t match(Control control) const {
+#ifdef __SSE2__
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(control), control_)));
+#else
+            std::uint32_t mask{0};
+            for (std::size_t idx{0}; idx < GROUP_SIZE; ++idx) {
+                mask |= static_cast<std::uint32_t>(control_[idx] == control) << idx;
+            }
+            return mask;
+#endif
+        }
+
+        std::uint32_t match_empty() const {
+            return match(EMPTY);
+        }
+
+        // Empty and deleted are the only negative control bytes.
+        std::uint32_t match_empty_or_deleted() const {
+#ifdef __SSE2__
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(control_));
+#else
+            std::uint32_t mask{0};
+            for (std::size_t idx{0}; idx < GROUP_SIZE; ++idx) {
+                mask |= static_cast<std::uint32_t>(control_[idx] < 0) << idx;
+            }
+            return mask;
+#endif
+        }
+
+      private:
+#ifdef __SSE2__
+        __m128i control_;
+#else
+        Control control_[GROUP_SIZE];
+#endif
+    };
+
+    template<bool IsConst>
+    class Iterator {
+        using Map = std::conditional_t<IsConst, const FlatHashMap, FlatHashMap>;
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<IsConst, const value_type *, value_type *>;
+        using reference = std::conditional_t<IsConst, const value_type &, value_type &>;
+
+        Iterator() = default;
+
+        Iterator(Map *map, std::size_t index) : map_{map}, index_{index} {
+            skip_free_slots();
+        }
+
+        // A mutable iterator converts to a const one.
+        operator Iterator<true>() const {
+            return Iterator<true>{map_, index_};
+        }
+
+        reference operator*() const {
+            return map_->slots_[index_];
+        }
+
+        pointer operator->() const {
+            return &map_->slots_[index_];
+        }
+
+        Iterator &operator++() {
+            ++index_;
+            skip_free_slots();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return index_ == other.index_;
+        }
+
+      private:
+        friend class FlatHashMap;
+
+        void skip_free_slots() {
+            while (index_ < map_->capacity_ && map_->control_[index_] < 0) {
+                ++index_;
+            }
+        }
+
+        Map *map_{nullptr};
+        std::size_t index_{0};
+    };
+
+  public:
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    FlatHashMap() = default;
+
+    FlatHashMap(const FlatHashMap &) = delete;
+    FlatHashMap &operator=(const FlatHashMap &) = delete;
+
+    FlatHashMap(FlatHashMap &&other) noexcept
+      : control_{std::exchange(other.control_, nullptr)}, slots_{std::exchange(other.slots_, nullptr)},
+        capacity_{std::exchange(other.capacity_, 0)}, size_{std::exchange(other.size_, 0)},
+        growth_left_{std::exchange(other.growth_left_, 0)}, hash_{std::move(other.hash_)},
+        key_equal_{std::move(other.key_equal_)} {
+    }
+
+    FlatHashMap &operator=(FlatHashMap &&other) noexcept {
+        if (this != &other) {
+            destroy();
+            control_ = std::exchange(other.control_, nullptr);
+            slots_ = std::exchange(other.slots_, nullptr);
+            capacity_ = std::exchange(other.capacity_, 0);
+            size_ = std::exchange(other.size_, 0);
+            growth_left_ = std::exchange(other.growth_left_, 0);
+            hash_ = std::move(other.hash_);
+            key_equal_ = std::move(other.key_equal_);
+        }
+        return *this;
+    }
+
+    ~FlatHashMap() {
+        destroy();
+    }
+
+    iterator begin() {
+        return iterator{this, 0};
+    }
+
+    iterator end() {
+        return iterator{this, capacity_};
+    }
+
+    const_iterator begin() const {
+        return const_iterator{this, 0};
+    }
+
+    const_iterator end() const {
+        return const_iterator{this, capacity_};
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    std::size_t capacity() const {
+        return capacity_;
+    }
+
+    template<typename LookupKey>
+    iterator find(const LookupKey &key) {
+        return iterator{this, find_index(key)};
+    }
+
+    template<typename LookupKey>
+    const_iterator find(const LookupKey &key) const {
+        return const_iterator{this, find_index(key)};
+    }
+
+    /**
+     * @brief Insert an entry for the key unless it exists already. The key and the value are only constructed when the
+     * entry is inserted, the value from the given arguments.
+     *
+     * @return The entry of the key and whether it was inserted.
+     */
+    template<typename LookupKey, typename... Args>
+    std::pair<iterator, bool> try_emplace(LookupKey &&key, Args &&...args) {
+        const auto hash = get_hash(key);
+        if (const auto index = find_index(key, hash); index != capacity_) {
+            return {iterator{this, index}, false};
+        }
+
+        auto index = find_free_index(hash);
+        // A deleted slot is reused without taking from the growth left.
+        if (capacity_ == 0 || (growth_left_ == 0 && control_[index] != DELETED)) {
+            rehash(get_capacity_after_growth());
+            index = find_free_index(hash);
+        }
+
+        std::construct_at(&slots_[index], std::piecewise_construct,
+                          std::forward_as_tuple(std::forward<LookupKey>(key)),
+                          std::forward_as_tuple(std::forward<Args>(args)...));
+        growth_left_ -= control_[index] == EMPTY ? 1 : 0;
+        control_[index] = get_h2(hash);
+        ++size_;
+        return {iterator{this, index}, true};
+    }
+
+    void erase(const_iterator position) {
+        const auto index = position.index_;
+        std::destroy_at(&slots_[index]);
+        --size_;
+
+        // A probe only goes past a group without an empty slot, a slot of a group with an empty one cannot be on the
+        // path to another key and becomes empty again.
+        if (Group{&control_[index - index % GROUP_SIZE]}.match_empty() != 0) {
+            control_[index] = EMPTY;
+            ++growth_left_;
+        } else {
+            control_[index] = DELETED;
+        }
+    }
+
+    void erase(iterator position) {
+        erase(const_iterator{position});
+    }
+
+    template<typename LookupKey>
+    std::size_t erase(const LookupKey &key) {
+        const auto index = find_index(key);
+        if (index == capacity_) {
+            return 0;
+        }
+
+        erase(const_iterator{this, index});
+        return 1;
+    }
+
+    /**
+     * @brief Make room for the number of entries, they are then inserted without a rehash.
+     *
+     */
+    void reserve(std::size_t number_of_entries) {
+        if (number_of_entries > size_ + growth_left_) {
+            rehash(get_capacity_for(number_of_entries));
+        }
+    }
+
+    void clear() {
+        destroy();
+    }
+
+  private:
+    static std::size_t get_max_load(std::size_t capacity) {
+        return capacity - capacity / 8;
+    }
+
+    static std::size_t get_capacity_for(std::size_t number_of_entries) {
+        auto capacity = GROUP_SIZE;
+        while (get_max_load(capacity) < number_of_entries) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    // 7 bits of the hash are kept in the control byte, the rest picks the group. The hash is mixed so that a weak
+    // hash, e.g. of integers, still spreads over all the groups.
+    std::size_t get_hash(const auto &key) const {
+        return static_cast<std::size_t>(static_cast<std::uint64_t>(hash_(key)) * 0xC2B2AE3D27D4EB4F);
+    }
+
+    static Control get_h2(std::size_t hash) {
+        return static_cast<Control>(hash & 0x7F);
+    }
+
+    std::size_t get_first_group(std::size_t hash) const {
+        return (hash >> 7) & (capacity_ / GROUP_SIZE - 1);
+    }
+
+    template<typename LookupKey>
+    std::size_t find_index(const LookupKey &key) const {
+        return find_index(key, get_hash(key));
+    }
+
+    /**
+     * @return Index of the slot of the key, the capacity when it does not exist.
+     */
+    template<typename LookupKey>
+    std::size_t find_index(const LookupKey &key, std::size_t hash) const {
+        if (capacity_ == 0) {
+            return capacity_;
+        }
+
+        const auto group_mask = capacity_ / GROUP_SIZE - 1;
+        auto group_index = get_first_group(hash);
+        // Triangular steps visit every group of a power of two number of groups.
+        for (std::size_t step{1};; ++step) {
+            const auto *group_control = &control_[group_index * GROUP_SIZE];
+            const Group group{group_control};
+            for (auto matches = group.match(get_h2(hash)); matches != 0; matches &= matches - 1) {
+                const auto index = group_index * GROUP_SIZE + static_cast<std::size_t>(std::countr_zero(matches));
+                if (key_equal_(slots_[index].first, key)) {
+                    return index;
+                }
+            }
+
+            // The key would have been inserted into the empty slot.
+            if (group.match_empty() != 0) {
+                return capacity_;
+            }
+            group_index = (group_index + step) & group_mask;
+        }
+    }
+
+    /**
+     * @return Index of the first empty or deleted slot on the probe path of the hash, the capacity when the table has
+     * no slots.
+     */
+    std::size_t find_free_index(std::size_t hash) const {
+        if (capacity_ == 0) {
+            return capacity_;
+        }
+
+        const auto group_mask = capacity_ / GROUP_SIZE - 1;
+        auto group_index = get_first_group(hash);
+        for (std::size_t step{1};; ++step) {
+            const auto matches = Group{&control_[group_index * GROUP_SIZE]}.match_empty_or_deleted();
+            if (matches != 0) {
+                return group_index * GROUP_SIZE + static_cast<std::size_t>(std::countr_zero(matches));
+            }
+            group_index = (group_index + step) & group_mask;
+        }
+    }
+
+    // A table with many deleted slots is cleaned up at the same size instead of grown.
+    std::size_t get_capacity_after_growth() const {
+        if (capacity_ == 0) {
+            return GROUP_SIZE;
+        }
+        return size_ * 2 <= get_max_load(capacity_) ? capacity_ : capacity_ * 2;
+    }
+
+    void rehash(std::size_t new_capacity) {
+        auto *old_control = control_;
+        auto *old_slots = slots_;
+        const auto old_capacity = capacity_;
+
+        control_ = static_cast<Control *>(::operator new(new_capacity, std::align_val_t{GROUP_SIZE}));
+        try {
+            slots_ = std::allocator<value_type>{}.allocate(new_capacity);
+        } catch (...) {
+            ::operator delete(control_, std::align_val_t{GROUP_SIZE});
+            control_ = old_control;
+            throw;
+        }
+        std::memset(control_, EMPTY, new_capacity);
+        capacity_ = new_capacity;
+        growth_left_ = get_max_load(new_capacity) - size_;
+
+        for (std::size_t idx{0}; idx < old_capacity; ++idx) {
+            if (old_control[idx] < 0) {
+                continue;
+            }
+
+            const auto hash = get_hash(old_slots[idx].first);
+            const auto index = find_free_index(hash);
+            std::construct_at(&slots_[index], std::move(old_slots[idx]));
+            std::destroy_at(&old_slots[idx]);
+            control_[index] = get_h2(hash);
+        }
+
+        if (old_capacity != 0) {
+            ::operator delete(old_control, std::align_val_t{GROUP_SIZE});
+            std::allocator<value_type>{}.deallocate(old_slots, old_capacity);
+        }
+    }
+
+    void destroy() {
+        if (capacity_ == 0) {
+            return;
+        }
+
+        for (std::size_t idx{0}; idx < capacity_; ++idx) {
+            if (control_[idx] >= 0) {
+                std::destroy_at(&slots_[idx]);
+            }
+        }
+        ::operator delete(control_, std::align_val_t{GROUP_SIZE});
+        std::allocator<value_type>{}.deallocate(slots_, capacity_);
+        control_ = nullptr;
+        slots_ = nullptr;
+        capacity_ = 0;
+        size_ = 0;
+        growth_left_ = 0;
+    }
+
+    Control *control_{nullptr};
+    value_type *slots_{nullptr};
+    std::size_t capacity_{0};
+    std::size_t size_{0};
+    // Empty slots which can still be filled before the table is 7/8 full.
+    std::size_t growth_left_{0};
+    [[no_unique_address]] Hash hash_{};
+    [[no_unique_address]] KeyEqual key_equal_{};
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+enum class IdlePolicy {
+    // Never block, lowest latency at the cost of a full core per thread.
+    busy_poll,
+    // Spin for a while after the last work was done, then block until woken up.
+    spin_then_park
+};
+
+struct IdleConfig {
+    IdlePolicy policy{IdlePolicy::spin_then_park};
+    std::chrono::microseconds spin_duration{100};
+};
+
+/**
+ * @brief Time a thread spent in each of its states. Written by the thread itself, can be read by any other thread.
+ *
+ */
+struct IdleStats {
+    std::atomic<std::uint64_t> working_ns{0};
+    std::atomic<std::uint64_t> spinning_ns{0};
+    std::atomic<std::uint64_t> parked_ns{0};
+    std::atomic<std::uint64_t> number_of_parks{0};
+};
+
+/**
+ * @brief Decides when a polling loop goes to sleep and accounts the time of the loop to its stats.
+ *
+ * The loop reports after every iteration whether it did any work. Once it did not have any work for longer than the
+ * spin duration, it is told to park. After a park the loop reports that it woke up.
+ */
+class IdleStrategy {
+  public:
+    IdleStrategy(const IdleConfig &config, IdleStats &stats);
+
+    /**
+     * @brief Account the time since the previous call as working or spinning.
+     *
+     * @param did_work Whether the iteration handled anything.
+     * @return true when the thread is idle for longer than the spin duration and should park.
+     */
+    bool on_iteration(bool did_work);
+
+    /**
+     * @brief Account the time since the previous call as parked. The time of a park is only known once it ended.
+     *
+     */
+    void on_wake_up();
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    std::uint64_t get_elapsed_ns(Clock::time_point now) const;
+
+    IdleConfig config_;
+    IdleStats &stats_;
+    Clock::time_point last_update_;
+    Clock::time_point idle_since_;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Histogram of latencies (or any other non-negative values) with a bounded relative error, to get percentiles
+ * without keeping every value.
+ *
+ * Values below 32 have their own bucket. Above, every power of two is split into 32 buckets, a value is off by less
+ * than 1/32 of itself.
+ */
+class LatencyHistogram {
+  public:
+    void record(std::uint64_t value);
+
+    /**
+     * @brief Add the values of another histogram, e.g. of another thread.
+     *
+     */
+    void merge(const LatencyHistogram &other);
+
+    /**
+     * @param percentile Between 0 and 100, e.g. 99.9.
+     * @return Upper bound of the bucket which holds the value at the percentile, 0 without values.
+     */
+    std::uint64_t get_percentile(double percentile) const;
+
+    std::uint64_t get_count() const {
+        return count_;
+    }
+
+    std::uint64_t get_min() const {
+        return count_ != 0 ? min_ : 0;
+    }
+
+    std::uint64_t get_max() const {
+        return max_;
+    }
+
+    double get_mean() const {
+        return count_ != 0 ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0;
+    }
+
+  private:
+    static constexpr std::size_t SUB_BUCKET_BITS = 5;
+    static constexpr std::size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr std::size_t NUMBER_OF_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static std::size_t get_bucket_index(std::uint64_t value);
+    static std::uint64_t get_bucket_upper_bound(std::size_t bucket_index);
+
+    std::array<std::uint64_t, NUMBER_OF_BUCKETS> buckets_{};
+    std::uint64_t count_{0};
+    std::uint64_t sum_{0};
+    std::uint64_t min_{UINT64_MAX};
+    std::uint64_t max_{0};
+};
@@ -1,24 +1,58 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
+#include <memory>
 #include <new>
-#include <vector>
+#include <span>
+#include <stdexcept>
+
+#ifdef __cpp_lib_hardware_interference_size
+// GCC warns that the value depends on -mtune, every target of the project is built with the same flags.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winterference-size"
+#endif
+inline constexpr std::size_t CACHE_LINE_SIZE = std::hardware_destructive_interference_size;
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#else
+inline constexpr std::size_t CACHE_LINE_SIZE = 64;
+#endif
 
 /**
  * @brief A fixed size single producer, single consumer and thread safe queue which is lock free.
  * For performance reasons, the capacity should be a power of two.
  *
+ * The index of each side is on a cache line of its own, next to the copy of the index of the other side which it last
+ * read. The other index is only read again when the copy says that the queue is full (or empty), so the cache line of
+ * the other side is rarely touched. The bulk operations move a batch of objects with one update of the index.
+ *
  * @tparam T Type of the objects stored in the queue.
  */
 template<typename T>
 class SPSCQueue {
   public:
-    explicit SPSCQueue(std::size_t capacity) : capacity_{capacity}, store_(capacity * sizeof(T)) {
-        const auto is_power_of_two = ((capacity) & (capacity - 1)) == 0;
+    explicit SPSCQueue(std::size_t capacity) : capacity_{capacity} {
+        const auto is_power_of_two = capacity != 0 && ((capacity) & (capacity - 1)) == 0;
         if (!is_power_of_two) {
             throw std::invalid_argument("Size must be a power of two");
         }
+
+        store_ = std::allocator<T>{}.allocate(capacity_);
+    }
+
+    SPSCQueue(const SPSCQueue &) = delete;
+    SPSCQueue &operator=(const SPSCQueue &) = delete;
+
+    ~SPSCQueue() {
+        const auto tail = tail_.load(std::memory_order_acquire);
+        for (auto index = head_.load(std::memory_order_relaxed); index != tail; ++index) {
+            std::destroy_at(get_slot(index));
+        }
+        std::allocator<T>{}.deallocate(store_, capacity_);
     }
 
     /**
@@ -29,20 +63,34 @@ class SPSCQueue {
      * @return false when the queue is full.
      */
     bool push(T object) {
-        const auto current_tail = tail_.load(std::memory_order_relaxed);
-        const auto next_tail = (current_tail + 1) & (capacity_ - 1);
-
-        // Queue is full.
-        if (next_tail == head_.load(std::memory_order_acquire)) {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (get_free_slots(tail, 1) == 0) {
             return false;
         }
 
-
-        new (store_.data() + current_tail * sizeof(T)) T(std::move(object));
-        tail_.store(next_tail, std::memory_order_release);
+        std::construct_at(get_slot(tail), std::move(object));
+        tail_.store(tail + 1, std::memory_order_release);
         return true;
     }
 
+    /**
+     * @brief Push as many of the given objects as fit, in order. The pushed objects are moved from.
+     *
+     * @return Number of objects which were pushed, from the front of the span.
+     */
+    std::size_t push_bulk(std::span<T> objects) {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        const auto number_of_objects = std::min(objects.size(), get_free_slots(tail, objects.size()));
+        for (std::size_t idx{0}; idx < number_of_objects; ++idx) {
+            std::construct_at(get_slot(tail + idx), std::move(objects[idx]));
+        }
+
+        if (number_of_objects != 0) {
+            tail_.store(tail + number_of_objects, std::memory_order_release);
+        }
+        return number_of_objects;
+    }
+
     /**
      * @brief Pop an item into the given item.
      *
@@ -51,21 +99,86 @@ class SPSCQueue {
      * @return false when the queue is empty.
      */
     bool pop(T &item) {
-        const auto current_head = head_.load(std::memory_order_relaxed);
-        if (current_head == tail_.load(std::memory_order_acquire)) {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (get_used_slots(head, 1) == 0) {
             return false;
         }
 
-        auto top_ptr = reinterpret_cast<T *>(store_.data() + current_head * sizeof(T));
-        item = std::move(*top_ptr);
-        head_.store((current_head + 1) & (capacity_ - 1), std::memory_order_release);
+        auto *object = get_slot(head);
+        item = std::move(*object);
+        std::destroy_at(object);
+        head_.store(head + 1, std::memory_order_release);
         return true;
     }
 
+    /**
+     * @brief Pop up to the size of the given span, in order.
+     *
+     * @param items where the popped items are stored, from the front.
+     * @return Number of items which were popped.
+     */
+    std::size_t pop_bulk(std::span<T> items) {
+        const auto head = head_.load(std::memory_order_relaxed);
+        const auto number_of_items = std::min(items.size(), get_used_slots(head, items.size()));
+        for (std::size_t idx{0}; idx < number_of_items; ++idx) {
+            auto *object = get_slot(head + idx);
+            items[idx] = std::move(*object);
+            std::destroy_at(object);
+        }
+
+        if (number_of_items != 0) {
+            head_.store(head + number_of_items, std::memory_order_release);
+        }
+        return number_of_items;
+    }
+
+    /**
+     * @brief Check whether the queue has no items. Can be called from both sides.
+     *
+     */
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
 
   private:
-    std::atomic<std::size_t> head_{0};
-    std::atomic<std::size_t> tail_{0};
-    std::size_t capacity_{0};
-    std::vector<std::byte> store_;
+    // The indices only grow, they are mapped to a slot with the mask of the capacity.
+    T *get_slot(std::size_t index) const {
+        return store_ + (index & (capacity_ - 1));
+    }
+
+    /**
+     * @brief Free slots for the producer. The head of the consumer is only read when the cached one leaves fewer than
+     * the wanted number.
+     *
+     */
+    std::size_t get_free_slots(std::size_t tail, std::size_t wanted) {
+        if (capacity_ - (tail - cached_head_) < wanted) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+        }
+        return capacity_ - (tail - cached_head_);
+    }
+
+    /**
+     * @brief Items for the consumer. The tail of the producer is only read when the cached one shows fewer than the
+     * wanted number.
+     *
+     */
+    std::size_t get_used_slots(std::size_t head, std::size_t wanted) {
+        if (cached_tail_ - head < wanted) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+        }
+        return cached_tail_ - head;
+    }
+
+    // Written by the producer.
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_{0};
+    std::size_t cached_head_{0};
+
+    // Written by the consumer.
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_{0};
+    std::size_t cached_tail_{0};
+
+    // Read by both sides.
+    alignas(CACHE_LINE_SIZE) std::size_t capacity_{0};
+    T *store_{nullptr};
 };
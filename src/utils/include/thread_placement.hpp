@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Where a thread runs, -1 while it is not pinned. Written by the thread itself, can be read by any other thread.
+ *
+ */
+struct ThreadPlacement {
+    std::atomic<int> cpu{-1};
+    // Node of the CPU, -1 also when the system does not report NUMA nodes.
+    std::atomic<int> numa_node{-1};
+};
+
+/**
+ * @brief Parse a list of CPUs in the format of taskset and the kernel, e.g. "0-3,8,10-11".
+ *
+ * @throws std::invalid_argument when the list is malformed.
+ */
+std::vector<int> parse_cpu_list(std::string_view cpu_list);
+
+/**
+ * @return true when the calling thread may run on the CPU, a thread can only be pinned to such a CPU.
+ */
+bool is_cpu_available(int cpu);
+
+/**
+ * @return NUMA node of the CPU, -1 when the system does not report it.
+ */
+int get_numa_node(int cpu);
+
+/**
+ * @brief Pin the calling thread to a CPU of a group of threads and record where it runs. The n-th thread of the group
+ * gets the n-th CPU of the list, which wraps around. An empty list leaves the thread to the scheduler.
+ *
+ * The memory a thread touches first is allocated on its local NUMA node, so a thread has to be placed before it
+ * allocates its own data.
+ *
+ * @return false when the thread could not be pinned, it is not pinned then.
+ */
+bool place_current_thread(const std::vector<int> &cpus, std::size_t thread_index, ThreadPlacement &placement);
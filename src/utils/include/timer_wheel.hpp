@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+
+using TimerId = std::uint64_t;
+
+/**
+ * @brief Hierarchical timer wheel for one-shot and periodic timers. Scheduling and cancelling a timer are O(1), the
+ * expired timers are found without looking at the others.
+ *
+ * Time is split into ticks of the given resolution. The lowest level has one slot per tick, every higher level has one
+ * slot per full turn of the level below it. A timer is placed on the lowest level whose range covers its expiry and
+ * moves down a level every time the wheel reaches its slot, until it runs.
+ *
+ * Not thread safe, the wheel belongs to the thread which advances it. Callbacks may schedule and cancel timers,
+ * including their own.
+ */
+class TimerWheel {
+  public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void()>;
+
+    static constexpr TimerId INVALID_TIMER_ID = 0;
+
+    explicit TimerWheel(Clock::time_point start, Clock::duration resolution = std::chrono::milliseconds{1});
+
+    /**
+     * @brief Run the callback once the given time is reached. A time in the past runs it with the next advance.
+     *
+     * @param period When not zero, the timer runs again every period until it is cancelled.
+     * @return Id to cancel the timer.
+     */
+    TimerId schedule(Clock::time_point expiry, Callback callback, Clock::duration period = Clock::duration::zero());
+
+    /**
+     * @return false when the timer already ran (one-shot) or was cancelled.
+     */
+    bool cancel(TimerId timer_id);
+
+    /**
+     * @brief Run the callbacks of all timers which expired until now.
+     *
+     * @return Number of callbacks which were run.
+     */
+    std::size_t advance(Clock::time_point now);
+
+    /**
+     * @brief Time at which advance() has to be called next. It is never later than the next expiry, but can be
+     * earlier when timers of a higher level have to be moved down first.
+     *
+     * @return Nothing when there is no timer.
+     */
+    std::optional<Clock::time_point> get_next_advance_time() const;
+
+    std::size_t size() const {
+        return number_of_timers_;
+    }
+
+  private:
+    static constexpr std::size_t BITS_PER_LEVEL = 6;
+    static constexpr std::size_t SLOTS_PER_LEVEL = 1 << BITS_PER_LEVEL;
+    static constexpr std::size_t NUMBER_OF_LEVELS = 4;
+    // Timers further away are kept on the highest level until they get in range.
+    static constexpr std::uint64_t MAX_TICKS_AHEAD = (std::uint64_t{1} << (BITS_PER_LEVEL * NUMBER_OF_LEVELS)) - 1;
+    static constexpr std::uint32_t NO_TIMER = UINT32_MAX;
+
+    struct Timer {
+        Callback callback;
+        std::uint64_t expiry_tick{0};
+        std::uint64_t period_ticks{0};
+        // Neighbours in the list of the slot or, for free timers, the next free one.
+        std::uint32_t previous{NO_TIMER};
+        std::uint32_t next{NO_TIMER};
+        std::uint32_t generation{0};
+        std::uint8_t level{0};
+        std::uint8_t slot{0};
+        bool is_scheduled{false};
+    };
+
+    struct Level {
+        std::array<std::uint32_t, SLOTS_PER_LEVEL> slots;
+        // Bit i is set while slot i holds timers.
+        std::uint64_t occupied_slots{0};
+    };
+
+    std::uint64_t to_tick(Clock::time_point time) const;
+    void insert(std::uint32_t index);
+    void unlink(std::uint32_t index);
+    void release(std::uint32_t index);
+    void cascade(std::uint64_t tick);
+    std::size_t run_slot(std::size_t slot);
+
+    Clock::time_point start_;
+    Clock::duration resolution_;
+    std::uint64_t current_tick_{0};
+
+    std::array<Level, NUMBER_OF_LEVELS> levels_;
+
+    // A deque keeps the timers in place while a callback schedules new ones.
+    std::deque<Timer> timers_;
+    std::uint32_t first_free_timer_{NO_TIMER};
+    std::size_t number_of_timers_{0};
+
+    // Timer whose callback runs, it is only released after the callback returned.
+    std::uint32_t running_timer_{NO_TIMER};
+    bool is_running_timer_cancelled_{false};
+};
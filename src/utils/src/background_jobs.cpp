@@ -0,0 +1,104 @@
+#include <exception>
+#include <iostream>
+#include <utility>
+
+#include "background_jobs.hpp"
+
+BackgroundJobs::BackgroundJobs(std::vector<int> cpus) : cpus_{std::move(cpus)} {
+    for (std::size_t idx{0}; idx < queues_.size(); ++idx) {
+        queues_[idx] = std::make_unique<Queue>();
+        queues_[idx]->thread = std::jthread([this, idx, queue = queues_[idx].get()](std::stop_token stop_token) {
+            run_worker(*queue, idx, stop_token);
+        });
+    }
+}
+
+BackgroundJobs::~BackgroundJobs() {
+    // The workers finish their queues in parallel.
+    for (auto &queue : queues_) {
+        queue->thread.request_stop();
+        queue->wake_ups.fetch_add(1, std::memory_order_release);
+        queue->wake_ups.notify_one();
+    }
+}
+
+void BackgroundJobs::submit(BackgroundJobType type, Job job) {
+    auto &queue = get_queue(type);
+    {
+        std::lock_guard lock{queue.mutex};
+        queue.jobs.push_back(std::move(job));
+        ++queue.number_of_submitted_jobs;
+        queue.number_of_pending_jobs.fetch_add(1, std::memory_order_relaxed);
+    }
+    queue.wake_ups.fetch_add(1, std::memory_order_release);
+    queue.wake_ups.notify_one();
+}
+
+void BackgroundJobs::wait_for_completion(BackgroundJobType type) {
+    auto &queue = get_queue(type);
+    std::uint64_t ticket{0};
+    {
+        std::lock_guard lock{queue.mutex};
+        ticket = queue.number_of_submitted_jobs;
+    }
+
+    auto number_of_done_jobs = queue.number_of_done_jobs.load(std::memory_order_acquire);
+    while (number_of_done_jobs < ticket) {
+        queue.number_of_done_jobs.wait(number_of_done_jobs, std::memory_order_acquire);
+        number_of_done_jobs = queue.number_of_done_jobs.load(std::memory_order_acquire);
+    }
+}
+
+std::size_t BackgroundJobs::get_number_of_pending_jobs(BackgroundJobType type) const {
+    return get_queue(type).number_of_pending_jobs.load(std::memory_order_relaxed);
+}
+
+std::uint64_t BackgroundJobs::get_number_of_processed_jobs(BackgroundJobType type) const {
+    return get_queue(type).number_of_done_jobs.load(std::memory_order_relaxed);
+}
+
+const ThreadPlacement &BackgroundJobs::get_placement(BackgroundJobType type) const {
+    return get_queue(type).placement;
+}
+
+void BackgroundJobs::run_worker(Queue &queue, std::size_t index, std::stop_token stop_token) {
+    if (!place_current_thread(cpus_, index, queue.placement)) {
+        std::cout << "Could not pin background worker " << BACKGROUND_JOB_TYPE_NAMES[index] << ", it runs on any CPU"
+                  << std::endl;
+    }
+
+    while (true) {
+        // Loaded before the queue is checked, a job submitted after the check changes it and the worker does not park.
+        const auto wake_ups = queue.wake_ups.load(std::memory_order_acquire);
+        Job job;
+        {
+            std::lock_guard lock{queue.mutex};
+            if (!queue.jobs.empty()) {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+            }
+        }
+
+        if (!job) {
+            // Once stopped, the worker still runs the queued jobs and only returns when the queue is empty.
+            if (stop_token.stop_requested()) {
+                return;
+            }
+            queue.wake_ups.wait(wake_ups, std::memory_order_acquire);
+            continue;
+        }
+
+        try {
+            job();
+        } catch (const std::exception &exception) {
+            std::cout << "Background job " << BACKGROUND_JOB_TYPE_NAMES[index] << " failed: " << exception.what()
+                      << std::endl;
+        }
+        // Whatever the job holds, e.g. a value to free, is released on this thread and before a waiter returns.
+        job = nullptr;
+
+        queue.number_of_pending_jobs.fetch_sub(1, std::memory_order_relaxed);
+        queue.number_of_done_jobs.fetch_add(1, std::memory_order_release);
+        queue.number_of_done_jobs.notify_all();
+    }
+}
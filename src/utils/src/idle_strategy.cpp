@@ -0,0 +1,36 @@
+#include "idle_strategy.hpp"
+
+IdleStrategy::IdleStrategy(const IdleConfig &config, IdleStats &stats)
+  : config_{config}, stats_{stats}, last_update_{Clock::now()}, idle_since_{last_update_} {
+}
+
+bool IdleStrategy::on_iteration(bool did_work) {
+    const auto now = Clock::now();
+    const auto elapsed_ns = get_elapsed_ns(now);
+    last_update_ = now;
+
+    if (did_work) {
+        stats_.working_ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+        idle_since_ = now;
+        return false;
+    }
+
+    stats_.spinning_ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+    if (config_.policy == IdlePolicy::busy_poll || now - idle_since_ < config_.spin_duration) {
+        return false;
+    }
+
+    stats_.number_of_parks.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void IdleStrategy::on_wake_up() {
+    const auto now = Clock::now();
+    stats_.parked_ns.fetch_add(get_elapsed_ns(now), std::memory_order_relaxed);
+    last_update_ = now;
+    idle_since_ = now;
+}
+
+std::uint64_t IdleStrategy::get_elapsed_ns(Clock::time_point now) const {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_update_).count());
+}
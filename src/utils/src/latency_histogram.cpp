@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include "latency_histogram.hpp"
+
+void LatencyHistogram::record(std::uint64_t value) {
+    ++buckets_[get_bucket_index(value)];
+    ++count_;
+    sum_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+    for (std::size_t idx{0}; idx < NUMBER_OF_BUCKETS; ++idx) {
+        buckets_[idx] += other.buckets_[idx];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+std::uint64_t LatencyHistogram::get_percentile(double percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+
+    const auto rank =
+      std::max<std::uint64_t>(static_cast<std::uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(count_))), 1);
+
+    std::uint64_t number_of_values{0};
+    for (std::size_t idx{0}; idx < NUMBER_OF_BUCKETS; ++idx) {
+        number_of_values += buckets_[idx];
+        if (number_of_values >= rank) {
+            return std::min(get_bucket_upper_bound(idx), max_);
+        }
+    }
+
+    return max_;
+}
+
+std::size_t LatencyHistogram::get_bucket_index(std::uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+
+    // The highest bit selects the power of two, the next bits the bucket within it.
+    const auto shift = static_cast<std::size_t>(63 - std::countl_zero(value)) - SUB_BUCKET_BITS;
+    const auto sub_bucket = (value >> shift) & (SUB_BUCKETS - 1);
+    return (shift + 1) * SUB_BUCKETS + sub_bucket;
+}
+
+std::uint64_t LatencyHistogram::get_bucket_upper_bound(std::size_t bucket_index) {
+    if (bucket_index < SUB_BUCKETS) {
+        return bucket_index;
+    }
+
+    const auto shift = bucket_index / SUB_BUCKETS - 1;
+    const auto sub_bucket = bucket_index % SUB_BUCKETS;
+    const auto lower_bound = (SUB_BUCKETS + sub_bucket) << shift;
+    return lower_bound + ((std::uint64_t{1} << shift) - 1);
+}
@@ -0,0 +1,99 @@
+#include <charconv>
+#include <filesystem>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "thread_placement.hpp"
+
+namespace {
+int parse_cpu(std::string_view cpu, std::string_view cpu_list) {
+    int result{-1};
+    const auto [end, error_code] = std::from_chars(cpu.data(), cpu.data() + cpu.size(), result);
+    if (cpu.empty() || error_code != std::errc{} || end != cpu.data() + cpu.size() || result < 0) {
+        throw std::invalid_argument("Invalid CPU list: " + std::string{cpu_list});
+    }
+
+    return result;
+}
+} // namespace
+
+std::vector<int> parse_cpu_list(std::string_view cpu_list) {
+    std::vector<int> cpus;
+    auto rest = cpu_list;
+    while (!rest.empty() || cpus.empty()) {
+        const auto comma = rest.find(',');
+        const auto range = rest.substr(0, comma);
+        rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+
+        const auto dash = range.find('-');
+        const auto first = parse_cpu(range.substr(0, dash), cpu_list);
+        const auto last = dash == std::string_view::npos ? first : parse_cpu(range.substr(dash + 1), cpu_list);
+        if (last < first) {
+            throw std::invalid_argument("Invalid CPU list: " + std::string{cpu_list});
+        }
+
+        for (auto cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+
+        // A trailing comma leaves an empty range.
+        if (comma != std::string_view::npos && rest.empty()) {
+            throw std::invalid_argument("Invalid CPU list: " + std::string{cpu_list});
+        }
+    }
+
+    return cpus;
+}
+
+bool is_cpu_available(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    return sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0 && CPU_ISSET(cpu, &cpu_set);
+}
+
+int get_numa_node(int cpu) {
+    // The directory of a CPU links to its node as node<index>.
+    std::error_code error_code;
+    const auto cpu_directory = std::filesystem::path{"/sys/devices/system/cpu"} / ("cpu" + std::to_string(cpu));
+    for (const auto &entry : std::filesystem::directory_iterator{cpu_directory, error_code}) {
+        const auto name = entry.path().filename().string();
+        int node{-1};
+        if (name.starts_with("node") &&
+            std::from_chars(name.data() + 4, name.data() + name.size(), node).ec == std::errc{}) {
+            return node;
+        }
+    }
+
+    return -1;
+}
+
+bool place_current_thread(const std::vector<int> &cpus, std::size_t thread_index, ThreadPlacement &placement) {
+    if (cpus.empty()) {
+        return true;
+    }
+
+    const auto cpu = cpus[thread_index % cpus.size()];
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+        return false;
+    }
+
+    // Also when the process was started with another policy, e.g. interleaved by numactl. Without NUMA support the
+    // call fails, which changes nothing.
+    syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0);
+
+    placement.cpu.store(cpu, std::memory_order_relaxed);
+    placement.numa_node.store(get_numa_node(cpu), std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+#include "timer_wheel.hpp"
+
+namespace {
+constexpr std::uint64_t SLOT_MASK = 0b111111;
+} // namespace
+
+TimerWheel::TimerWheel(Clock::time_point start, Clock::duration resolution) : start_{start}, resolution_{resolution} {
+    for (auto &level : levels_) {
+        level.slots.fill(NO_TIMER);
+    }
+}
+
+TimerId TimerWheel::schedule(Clock::time_point expiry, Callback callback, Clock::duration period) {
+    std::uint32_t index;
+    if (first_free_timer_ != NO_TIMER) {
+        index = first_free_timer_;
+        first_free_timer_ = timers_[index].next;
+    } else {
+        index = static_cast<std::uint32_t>(timers_.size());
+        timers_.emplace_back();
+        timers_.back().generation = 1;
+    }
+
+    // Rounded up, a timer never runs early.
+    auto expiry_tick = to_tick(expiry);
+    if (start_ + expiry_tick * resolution_ < expiry) {
+        ++expiry_tick;
+    }
+
+    auto &timer = timers_[index];
+    timer.callback = std::move(callback);
+    timer.expiry_tick = std::max(expiry_tick, current_tick_ + 1);
+    timer.period_ticks = 0;
+    if (period > Clock::duration::zero()) {
+        timer.period_ticks = std::max<std::uint64_t>((period + resolution_ - Clock::duration{1}) / resolution_, 1);
+    }
+
+    insert(index);
+    ++number_of_timers_;
+    return (static_cast<TimerId>(timer.generation) << 32) | index;
+}
+
+bool TimerWheel::cancel(TimerId timer_id) {
+    const auto index = static_cast<std::uint32_t>(timer_id);
+    const auto generation = static_cast<std::uint32_t>(timer_id >> 32);
+    if (index >= timers_.size() || timers_[index].generation != generation) {
+        return false;
+    }
+
+    auto &timer = timers_[index];
+
+    // The timer is released once its callback returned. A periodic timer was already scheduled again.
+    if (index == running_timer_) {
+        if (timer.period_ticks == 0 || is_running_timer_cancelled_) {
+            return false;
+        }
+
+        is_running_timer_cancelled_ = true;
+        unlink(index);
+        return true;
+    }
+
+    if (!timer.is_scheduled) {
+        return false;
+    }
+
+    unlink(index);
+    release(index);
+    return true;
+}
+
+std::size_t TimerWheel::advance(Clock::time_point now) {
+    const auto target_tick = to_tick(now);
+    std::size_t number_of_callbacks{0};
+
+    while (current_tick_ < target_tick) {
+        if (number_of_timers_ == 0) {
+            current_tick_ = target_tick;
+            break;
+        }
+
+        // Jump to the next occupied slot of the lowest level within its current turn.
+        const auto slot = current_tick_ & SLOT_MASK;
+        const auto turn_end = (current_tick_ | SLOT_MASK) + 1;
+        const auto last_tick = std::min(target_tick, turn_end - 1);
+
+        std::uint64_t pending_slots{0};
+        if (last_tick > current_tick_) {
+            const auto lowest_slot = slot + 1;
+            const auto highest_slot = last_tick & SLOT_MASK;
+            const auto slots_in_range = (~std::uint64_t{0} >> (63 - highest_slot)) & (~std::uint64_t{0} << lowest_slot);
+            pending_slots = levels_[0].occupied_slots & slots_in_range;
+        }
+
+        if (pending_slots != 0) {
+            current_tick_ = (current_tick_ & ~SLOT_MASK) + std::countr_zero(pending_slots);
+            number_of_callbacks += run_slot(current_tick_ & SLOT_MASK);
+            continue;
+        }
+
+        if (target_tick < turn_end) {
+            current_tick_ = target_tick;
+            break;
+        }
+
+        // A new turn of the lowest level, the timers of the next slots of the higher levels move down.
+        current_tick_ = turn_end;
+        cascade(current_tick_);
+        number_of_callbacks += run_slot(0);
+    }
+
+    return number_of_callbacks;
+}
+
+std::optional<TimerWheel::Clock::time_point> TimerWheel::get_next_advance_time() const {
+    if (number_of_timers_ == 0) {
+        return std::nullopt;
+    }
+
+    auto next_tick = std::numeric_limits<std::uint64_t>::max();
+    for (std::size_t level_index{0}; level_index < NUMBER_OF_LEVELS; ++level_index) {
+        const auto occupied_slots = levels_[level_index].occupied_slots;
+        if (occupied_slots == 0) {
+            continue;
+        }
+
+        // On the lowest level the tick of the slot is the expiry, on the others it is the tick at which the slot is
+        // moved down.
+        const auto shift = level_index * BITS_PER_LEVEL;
+        const auto turn = current_tick_ >> shift;
+        const auto rotated_slots = std::rotr(occupied_slots, static_cast<int>((turn + 1) & SLOT_MASK));
+        const auto distance = static_cast<std::uint64_t>(std::countr_zero(rotated_slots)) + 1;
+        next_tick = std::min(next_tick, (turn + distance) << shift);
+    }
+
+    // Only a periodic timer which cancelled itself while running is left.
+    if (next_tick == std::numeric_limits<std::uint64_t>::max()) {
+        return std::nullopt;
+    }
+
+    return start_ + next_tick * resolution_;
+}
+
+std::uint64_t TimerWheel::to_tick(Clock::time_point time) const {
+    if (time <= start_) {
+        return 0;
+    }
+
+    return static_cast<std::uint64_t>((time - start_) / resolution_);
+}
+
+void TimerWheel::insert(std::uint32_t index) {
+    auto &timer = timers_[index];
+
+    // Timers which are out of range wait in the last slot of the highest level.
+    auto ticks_ahead = timer.expiry_tick - std::min(timer.expiry_tick, current_tick_);
+    auto placement_tick = timer.expiry_tick;
+    if (ticks_ahead > MAX_TICKS_AHEAD) {
+        ticks_ahead = MAX_TICKS_AHEAD;
+        placement_tick = current_tick_ + MAX_TICKS_AHEAD;
+    }
+
+    std::size_t level_index{0};
+    while (level_index + 1 < NUMBER_OF_LEVELS && ticks_ahead >> ((level_index + 1) * BITS_PER_LEVEL) != 0) {
+        ++level_index;
+    }
+
+    auto &level = levels_[level_index];
+    const auto slot = (placement_tick >> (level_index * BITS_PER_LEVEL)) & SLOT_MASK;
+
+    timer.level = static_cast<std::uint8_t>(level_index);
+    timer.slot = static_cast<std::uint8_t>(slot);
+    timer.previous = NO_TIMER;
+    timer.next = level.slots[slot];
+    if (timer.next != NO_TIMER) {
+        timers_[timer.next].previous = index;
+    }
+    level.slots[slot] = index;
+    level.occupied_slots |= std::uint64_t{1} << slot;
+    timer.is_scheduled = true;
+}
+
+void TimerWheel::unlink(std::uint32_t index) {
+    auto &timer = timers_[index];
+    auto &level = levels_[timer.level];
+
+    if (timer.previous != NO_TIMER) {
+        timers_[timer.previous].next = timer.next;
+    } else {
+        level.slots[timer.slot] = timer.next;
+    }
+
+    if (timer.next != NO_TIMER) {
+        timers_[timer.next].previous = timer.previous;
+    }
+
+    if (level.slots[timer.slot] == NO_TIMER) {
+        level.occupied_slots &= ~(std::uint64_t{1} << timer.slot);
+    }
+
+    timer.previous = timer.next = NO_TIMER;
+    timer.is_scheduled = false;
+}
+
+void TimerWheel::release(std::uint32_t index) {
+    auto &timer = timers_[index];
+    timer.callback = nullptr;
+    // Ids handed out for this timer become invalid.
+    ++timer.generation;
+    timer.next = first_free_timer_;
+    first_free_timer_ = index;
+    --number_of_timers_;
+}
+
+void TimerWheel::cascade(std::uint64_t tick) {
+    for (std::size_t level_index{1}; level_index < NUMBER_OF_LEVELS; ++level_index) {
+        const auto slot = (tick >> (level_index * BITS_PER_LEVEL)) & SLOT_MASK;
+        auto &level = levels_[level_index];
+
+        while (level.slots[slot] != NO_TIMER) {
+            const auto index = level.slots[slot];
+            unlink(index);
+            insert(index);
+        }
+
+        // The level above only starts a new slot when this level starts a new turn.
+        if (slot != 0) {
+            break;
+        }
+    }
+}
+
+std::size_t TimerWheel::run_slot(std::size_t slot) {
+    std::size_t number_of_callbacks{0};
+    auto &level = levels_[0];
+
+    // Callbacks can cancel the other timers of the slot, they are taken one at a time.
+    while (level.slots[slot] != NO_TIMER) {
+        const auto index = level.slots[slot];
+        auto &timer = timers_[index];
+        unlink(index);
+
+        if (timer.period_ticks != 0) {
+            timer.expiry_tick = std::max(timer.expiry_tick + timer.period_ticks, current_tick_ + 1);
+            insert(index);
+        }
+
+        running_timer_ = index;
+        is_running_timer_cancelled_ = false;
+        timer.callback();
+        running_timer_ = NO_TIMER;
+        ++number_of_callbacks;
+
+        if (timer.period_ticks == 0 || is_running_timer_cancelled_) {
+            release(index);
+        }
+    }
+
+    return number_of_callbacks;
+}
@@ -0,0 +1,115 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <sched.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "background_jobs.hpp"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Records the thread which destroys it.
+struct ReleaseTracker {
+    explicit ReleaseTracker(std::atomic<std::thread::id> &releasing_thread) : releasing_thread{releasing_thread} {
+    }
+
+    ~ReleaseTracker() {
+        releasing_thread = std::this_thread::get_id();
+    }
+
+    std::atomic<std::thread::id> &releasing_thread;
+};
+
+} // namespace
+
+TEST(BackgroundJobs, jobsOfATypeRunInOrder) {
+    BackgroundJobs background_jobs;
+    std::vector<int> order;
+    for (int idx{0}; idx < 100; ++idx) {
+        background_jobs.submit(BackgroundJobType::lazy_free, [&order, idx]() { order.push_back(idx); });
+    }
+
+    background_jobs.wait_for_completion(BackgroundJobType::lazy_free);
+
+    ASSERT_EQ(order.size(), 100);
+    for (int idx{0}; idx < 100; ++idx) {
+        EXPECT_EQ(order[idx], idx);
+    }
+    EXPECT_EQ(background_jobs.get_number_of_pending_jobs(BackgroundJobType::lazy_free), 0);
+    EXPECT_EQ(background_jobs.get_number_of_processed_jobs(BackgroundJobType::lazy_free), 100);
+}
+
+TEST(BackgroundJobs, slowJobDoesNotBlockOtherTypes) {
+    BackgroundJobs background_jobs;
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    background_jobs.submit(BackgroundJobType::fsync, [released]() { released.wait(); });
+    background_jobs.submit(BackgroundJobType::fsync, []() {});
+
+    auto freed = false;
+    background_jobs.submit(BackgroundJobType::lazy_free, [&freed]() { freed = true; });
+    background_jobs.wait_for_completion(BackgroundJobType::lazy_free);
+
+    EXPECT_TRUE(freed);
+    EXPECT_EQ(background_jobs.get_number_of_pending_jobs(BackgroundJobType::fsync), 2);
+
+    release.set_value();
+    background_jobs.wait_for_completion(BackgroundJobType::fsync);
+    EXPECT_EQ(background_jobs.get_number_of_pending_jobs(BackgroundJobType::fsync), 0);
+}
+
+TEST(BackgroundJobs, capturedStateIsReleasedByTheWorker) {
+    BackgroundJobs background_jobs;
+    std::atomic<std::thread::id> releasing_thread;
+    auto value = std::make_shared<ReleaseTracker>(releasing_thread);
+
+    background_jobs.submit(BackgroundJobType::lazy_free, [value = std::move(value)]() {});
+    background_jobs.wait_for_completion(BackgroundJobType::lazy_free);
+
+    EXPECT_NE(releasing_thread.load(), std::thread::id{});
+    EXPECT_NE(releasing_thread.load(), std::this_thread::get_id());
+}
+
+TEST(BackgroundJobs, failingJobDoesNotStopTheWorker) {
+    BackgroundJobs background_jobs;
+    auto has_run = false;
+    background_jobs.submit(BackgroundJobType::close_file, []() { throw std::runtime_error("close failed"); });
+    background_jobs.submit(BackgroundJobType::close_file, [&has_run]() { has_run = true; });
+
+    background_jobs.wait_for_completion(BackgroundJobType::close_file);
+
+    EXPECT_TRUE(has_run);
+    EXPECT_EQ(background_jobs.get_number_of_processed_jobs(BackgroundJobType::close_file), 2);
+}
+
+TEST(BackgroundJobs, queuedJobsRunBeforeDestruction) {
+    std::atomic<int> number_of_runs{0};
+    {
+        BackgroundJobs background_jobs;
+        for (int idx{0}; idx < 10; ++idx) {
+            background_jobs.submit(BackgroundJobType::lazy_free, [&number_of_runs]() {
+                std::this_thread::sleep_for(1ms);
+                ++number_of_runs;
+            });
+        }
+    }
+
+    EXPECT_EQ(number_of_runs.load(), 10);
+}
+
+TEST(BackgroundJobs, workersArePinned) {
+    BackgroundJobs background_jobs{{0}};
+    std::atomic<int> cpu{-1};
+    background_jobs.submit(BackgroundJobType::fsync, [&cpu]() { cpu = sched_getcpu(); });
+    background_jobs.wait_for_completion(BackgroundJobType::fsync);
+
+    EXPECT_EQ(cpu.load(), 0);
+    EXPECT_EQ(background_jobs.get_placement(BackgroundJobType::fsync).cpu.load(), 0);
+}
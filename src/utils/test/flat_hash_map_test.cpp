@@ -0,0 +1,130 @@
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <gtest/gtest.h>
+
+#include "flat_hash_map.hpp"
+
+namespace {
+
+struct StringHash {
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view key) const noexcept {
+        return std::hash<std::string_view>{}(key);
+    }
+};
+
+using StringMap = FlatHashMap<std::string, int, StringHash, std::equal_to<>>;
+
+// Every key lands in the same group, the probe has to go past full groups.
+struct CollidingHash {
+    std::size_t operator()(int) const noexcept {
+        return 0;
+    }
+};
+
+} // namespace
+
+TEST(FlatHashMap, keysAreFoundByView) {
+    StringMap map;
+    EXPECT_EQ(map.find(std::string_view{"missing"}), map.end());
+
+    const auto [it, is_inserted] = map.try_emplace(std::string_view{"key"}, 1);
+    EXPECT_TRUE(is_inserted);
+    EXPECT_EQ(it->first, "key");
+
+    // An existing key is neither constructed nor overwritten.
+    const auto [existing, is_inserted_again] = map.try_emplace(std::string_view{"key"}, 2);
+    EXPECT_FALSE(is_inserted_again);
+    EXPECT_EQ(existing, it);
+    EXPECT_EQ(map.find(std::string_view{"key"})->second, 1);
+    EXPECT_EQ(map.find(std::string{"key"})->second, 1);
+    EXPECT_EQ(map.size(), 1);
+}
+
+TEST(FlatHashMap, entriesSurviveGrowth) {
+    StringMap map;
+    for (int idx{0}; idx < 10000; ++idx) {
+        map.try_emplace("key_" + std::to_string(idx), idx);
+    }
+
+    EXPECT_EQ(map.size(), 10000);
+    EXPECT_GE(map.capacity() - map.capacity() / 8, 10000);
+    for (int idx{0}; idx < 10000; ++idx) {
+        const auto it = map.find("key_" + std::to_string(idx));
+        ASSERT_NE(it, map.end());
+        EXPECT_EQ(it->second, idx);
+    }
+
+    std::size_t number_of_entries{0};
+    for (const auto &[key, value] : map) {
+        EXPECT_EQ(key, "key_" + std::to_string(value));
+        ++number_of_entries;
+    }
+    EXPECT_EQ(number_of_entries, 10000);
+}
+
+TEST(FlatHashMap, collidingKeysAreProbedAcrossGroups) {
+    FlatHashMap<int, int, CollidingHash> map;
+    for (int idx{0}; idx < 100; ++idx) {
+        map.try_emplace(idx, idx);
+    }
+    for (int idx{0}; idx < 100; idx += 2) {
+        EXPECT_EQ(map.erase(idx), 1);
+    }
+
+    // The erased keys left deleted slots behind, the keys after them are still found.
+    for (int idx{0}; idx < 100; ++idx) {
+        const auto it = map.find(idx);
+        EXPECT_EQ(it != map.end(), idx % 2 == 1) << idx;
+    }
+    EXPECT_EQ(map.size(), 50);
+}
+
+TEST(FlatHashMap, matchesUnorderedMapUnderChurn) {
+    FlatHashMap<int, int> map;
+    std::unordered_map<int, int> expected;
+    std::mt19937 random{42};
+    std::uniform_int_distribution<int> key_distribution{0, 2000};
+
+    for (int idx{0}; idx < 200000; ++idx) {
+        const auto key = key_distribution(random);
+        if (random() % 2 == 0) {
+            EXPECT_EQ(map.try_emplace(key, idx).second, expected.try_emplace(key, idx).second);
+        } else {
+            EXPECT_EQ(map.erase(key), expected.erase(key));
+        }
+    }
+
+    ASSERT_EQ(map.size(), expected.size());
+    for (const auto &[key, value] : expected) {
+        const auto it = map.find(key);
+        ASSERT_NE(it, map.end());
+        EXPECT_EQ(it->second, value);
+    }
+    // Deleted slots are cleaned up instead of growing the table.
+    EXPECT_LE(map.capacity(), 4096);
+}
+
+TEST(FlatHashMap, erasedEntriesAreDestroyed) {
+    FlatHashMap<int, std::shared_ptr<int>> map;
+    auto value = std::make_shared<int>(1);
+    map.try_emplace(1, value);
+    map.try_emplace(2, value);
+    EXPECT_EQ(value.use_count(), 3);
+
+    map.erase(map.find(1));
+    EXPECT_EQ(value.use_count(), 2);
+
+    auto moved = std::move(map);
+    EXPECT_EQ(moved.find(2)->second, value);
+    moved.clear();
+    EXPECT_EQ(value.use_count(), 1);
+    EXPECT_TRUE(moved.empty());
+}
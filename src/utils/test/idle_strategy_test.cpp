@@ -0,0 +1,48 @@
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "idle_strategy.hpp"
+
+using namespace std::chrono_literals;
+
+TEST(IdleStrategy, busyPollNeverParks) {
+    IdleStats stats;
+    IdleStrategy idle_strategy{IdleConfig{IdlePolicy::busy_poll, 0us}, stats};
+
+    for (std::size_t idx{0}; idx < 100; ++idx) {
+        EXPECT_FALSE(idle_strategy.on_iteration(false));
+    }
+    std::this_thread::sleep_for(1ms);
+    EXPECT_FALSE(idle_strategy.on_iteration(false));
+
+    EXPECT_GE(stats.spinning_ns.load(), 1000000);
+    EXPECT_EQ(stats.working_ns.load(), 0);
+}
+
+TEST(IdleStrategy, parksAfterSpinning) {
+    IdleStats stats;
+    IdleStrategy idle_strategy{IdleConfig{IdlePolicy::spin_then_park, 5ms}, stats};
+
+    EXPECT_FALSE(idle_strategy.on_iteration(false));
+    std::this_thread::sleep_for(5ms);
+    EXPECT_TRUE(idle_strategy.on_iteration(false));
+    EXPECT_EQ(stats.number_of_parks.load(), 1);
+
+    // Work restarts the spinning.
+    std::this_thread::sleep_for(1ms);
+    EXPECT_FALSE(idle_strategy.on_iteration(true));
+    EXPECT_FALSE(idle_strategy.on_iteration(false));
+    EXPECT_GE(stats.working_ns.load(), 1000000);
+
+    std::this_thread::sleep_for(5ms);
+    EXPECT_TRUE(idle_strategy.on_iteration(false));
+
+    // So does waking up.
+    std::this_thread::sleep_for(2ms);
+    idle_strategy.on_wake_up();
+    EXPECT_FALSE(idle_strategy.on_iteration(false));
+    EXPECT_GE(stats.parked_ns.load(), 2000000);
+    EXPECT_EQ(stats.number_of_parks.load(), 2);
+}
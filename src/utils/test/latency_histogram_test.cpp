@@ -0,0 +1,53 @@
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "latency_histogram.hpp"
+
+TEST(LatencyHistogram, smallValuesAreExact) {
+    LatencyHistogram histogram;
+    for (std::uint64_t value{1}; value <= 20; ++value) {
+        histogram.record(value);
+    }
+
+    EXPECT_EQ(histogram.get_count(), 20);
+    EXPECT_EQ(histogram.get_min(), 1);
+    EXPECT_EQ(histogram.get_max(), 20);
+    EXPECT_DOUBLE_EQ(histogram.get_mean(), 10.5);
+    EXPECT_EQ(histogram.get_percentile(50), 10);
+    EXPECT_EQ(histogram.get_percentile(100), 20);
+}
+
+TEST(LatencyHistogram, percentilesAreWithinTheRelativeError) {
+    LatencyHistogram histogram;
+    for (std::uint64_t value{1}; value <= 1000000; ++value) {
+        histogram.record(value);
+    }
+
+    for (const auto percentile : {50.0, 90.0, 99.0, 99.9}) {
+        const auto exact = static_cast<double>(percentile) * 10000.0;
+        const auto estimate = static_cast<double>(histogram.get_percentile(percentile));
+        EXPECT_GE(estimate, exact) << percentile;
+        EXPECT_LE(estimate, exact * (1.0 + 1.0 / 32.0)) << percentile;
+    }
+    EXPECT_EQ(histogram.get_percentile(100), 1000000);
+}
+
+TEST(LatencyHistogram, mergedHistogramsHoldAllValues) {
+    LatencyHistogram fast;
+    LatencyHistogram slow;
+    for (std::size_t idx{0}; idx < 990; ++idx) {
+        fast.record(1000);
+    }
+    for (std::size_t idx{0}; idx < 10; ++idx) {
+        slow.record(1000000);
+    }
+
+    fast.merge(slow);
+    EXPECT_EQ(fast.get_count(), 1000);
+    EXPECT_EQ(fast.get_max(), 1000000);
+    EXPECT_LT(fast.get_percentile(99), 1100);
+    EXPECT_GE(fast.get_percentile(99.9), 1000000);
+
+    EXPECT_EQ(LatencyHistogram{}.get_percentile(99), 0);
+}
@@ -1,18 +1,86 @@
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "spsc_queue.hpp"
 
+namespace {
+/**
+ * @brief Counts its living instances.
+ *
+ */
+struct Tracked {
+    static inline int number_of_instances{0};
+
+    explicit Tracked(int value = 0) : value{value} {
+        ++number_of_instances;
+    }
+
+    Tracked(const Tracked &other) : value{other.value} {
+        ++number_of_instances;
+    }
+
+    Tracked(Tracked &&other) noexcept : value{other.value} {
+        ++number_of_instances;
+    }
+
+    Tracked &operator=(const Tracked &) = default;
+    Tracked &operator=(Tracked &&) noexcept = default;
+
+    ~Tracked() {
+        --number_of_instances;
+    }
+
+    int value;
+};
+
+/**
+ * @brief Pass the numbers 0 to number_of_items - 1 from a producer to a consumer thread.
+ *
+ * @return Sum of the numbers the consumer popped.
+ */
+template<typename Push, typename Pop>
+std::size_t transfer(std::size_t number_of_items, Push &&push, Pop &&pop) {
+    std::size_t sum{0};
+    auto consumer = std::jthread([&]() {
+        std::size_t number_of_popped_items{0};
+        while (number_of_popped_items < number_of_items) {
+            if (const auto number_of_popped = pop(sum); number_of_popped != 0) {
+                number_of_popped_items += number_of_popped;
+            } else {
+                // The producer may need the core.
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (std::size_t number{0}; number < number_of_items;) {
+        if (const auto number_of_pushed = push(number); number_of_pushed != 0) {
+            number += number_of_pushed;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    return sum;
+}
+} // namespace
+
 TEST(SPSCQueue, exceptionForSizeNotPowerOfTwo) {
     EXPECT_THROW(SPSCQueue<std::size_t>(24), std::invalid_argument);
+    EXPECT_THROW(SPSCQueue<std::size_t>(0), std::invalid_argument);
 }
 
 TEST(SPSCQueue, singleProducerAndConsumer) {
     const auto queue_size = 16;
     SPSCQueue<std::size_t> queue(queue_size);
 
-    bool producer_is_done = false;
+    std::atomic<bool> producer_is_done = false;
 
     // Write number 0 to 99 in the queue
     auto produce = std::jthread([&]() {
@@ -28,12 +96,14 @@ TEST(SPSCQueue, singleProducerAndConsumer) {
     std::vector<size_t> number_in_consumer;
     auto consumer = std::jthread([&]() {
         std::size_t current_item{10};
-        auto has_values = true;
 
-        while (!producer_is_done || has_values) {
-            has_values = queue.pop(current_item);
-            if (has_values) {
+        // The flag is read before the pop, an empty queue after the producer is done means that everything was read.
+        for (;;) {
+            const auto is_producer_done = producer_is_done.load();
+            if (queue.pop(current_item)) {
                 number_in_consumer.push_back(current_item);
+            } else if (is_producer_done) {
+                break;
             }
         }
     });
@@ -46,3 +116,91 @@ TEST(SPSCQueue, singleProducerAndConsumer) {
         EXPECT_EQ(number_in_consumer[index], index);
     }
 }
+
+TEST(SPSCQueue, holdsAsManyItemsAsItsCapacity) {
+    SPSCQueue<std::size_t> queue(4);
+    for (std::size_t number{0}; number < 4; ++number) {
+        EXPECT_TRUE(queue.push(number));
+    }
+    EXPECT_FALSE(queue.push(4));
+
+    // The indices wrap around the store.
+    std::size_t item{0};
+    for (std::size_t number{0}; number < 10; ++number) {
+        EXPECT_TRUE(queue.pop(item));
+        EXPECT_EQ(item, number);
+        EXPECT_TRUE(queue.push(number + 4));
+    }
+    EXPECT_FALSE(queue.empty());
+}
+
+TEST(SPSCQueue, bulkOperationsMoveWhatFits) {
+    SPSCQueue<std::string> queue(4);
+    std::vector<std::string> items{"a", "b", "c", "d", "e", "f"};
+    EXPECT_EQ(queue.push_bulk(items), 4);
+    EXPECT_EQ(queue.push_bulk(std::span{items}.subspan(4)), 0);
+
+    std::array<std::string, 3> popped_items;
+    EXPECT_EQ(queue.pop_bulk(popped_items), 3);
+    EXPECT_EQ(popped_items, (std::array<std::string, 3>{"a", "b", "c"}));
+
+    EXPECT_EQ(queue.push_bulk(std::span{items}.subspan(4)), 2);
+    EXPECT_EQ(queue.pop_bulk(popped_items), 3);
+    EXPECT_EQ(popped_items, (std::array<std::string, 3>{"d", "e", "f"}));
+    EXPECT_EQ(queue.pop_bulk(popped_items), 0);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SPSCQueue, popAndDestructionEndTheLifetimeOfTheItems) {
+    {
+        SPSCQueue<Tracked> queue(8);
+        for (int value{0}; value < 5; ++value) {
+            queue.push(Tracked{value});
+        }
+        EXPECT_EQ(Tracked::number_of_instances, 5);
+
+        Tracked item;
+        EXPECT_TRUE(queue.pop(item));
+        EXPECT_EQ(item.value, 0);
+        std::array<Tracked, 2> items;
+        EXPECT_EQ(queue.pop_bulk(items), 2);
+        EXPECT_EQ(Tracked::number_of_instances, 2 + 1 + 2);
+    }
+
+    // The items left in the queue are destroyed with it.
+    EXPECT_EQ(Tracked::number_of_instances, 0);
+
+    // A queue which is never used does not construct any object.
+    SPSCQueue<Tracked> queue(8);
+    EXPECT_EQ(Tracked::number_of_instances, 0);
+}
+
+TEST(SPSCQueue, bulkProducerAndConsumer) {
+    constexpr std::size_t NUMBER_OF_ITEMS = 100000;
+    SPSCQueue<std::size_t> queue(64);
+
+    std::vector<std::size_t> batch(32);
+    std::size_t expected_number{0};
+    auto consumer_saw_the_order = true;
+    const auto sum = transfer(
+      NUMBER_OF_ITEMS,
+      [&](std::size_t first_number) {
+          const auto batch_size = std::min(batch.size(), NUMBER_OF_ITEMS - first_number);
+          for (std::size_t idx{0}; idx < batch_size; ++idx) {
+              batch[idx] = first_number + idx;
+          }
+          return queue.push_bulk(std::span{batch}.first(batch_size));
+      },
+      [&](std::size_t &sum) {
+          std::array<std::size_t, 16> items;
+          const auto number_of_items = queue.pop_bulk(items);
+          for (std::size_t idx{0}; idx < number_of_items; ++idx) {
+              consumer_saw_the_order = consumer_saw_the_order && items[idx] == expected_number++;
+              sum += items[idx];
+          }
+          return number_of_items;
+      });
+
+    EXPECT_TRUE(consumer_saw_the_order);
+    EXPECT_EQ(sum, NUMBER_OF_ITEMS * (NUMBER_OF_ITEMS - 1) / 2);
+}
@@ -0,0 +1,45 @@
+#include <sched.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "thread_placement.hpp"
+
+TEST(ThreadPlacement, cpuListsAreParsed) {
+    EXPECT_EQ(parse_cpu_list("3"), std::vector<int>({3}));
+    EXPECT_EQ(parse_cpu_list("0-3,8,10-11"), std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+
+    for (const auto *cpu_list : {"", ",", "1,", "a", "3-1", "1-", "-1", "1-2-3"}) {
+        EXPECT_THROW(parse_cpu_list(cpu_list), std::invalid_argument) << cpu_list;
+    }
+}
+
+TEST(ThreadPlacement, threadRunsOnItsCpu) {
+    ASSERT_TRUE(is_cpu_available(0));
+    EXPECT_FALSE(is_cpu_available(-1));
+    EXPECT_FALSE(is_cpu_available(CPU_SETSIZE));
+
+    ThreadPlacement placement;
+    bool placed{false};
+    int cpu{-1};
+    // The list wraps around, the third thread of the group gets the first CPU.
+    std::thread{[&] {
+        placed = place_current_thread({0, 0}, 2, placement);
+        cpu = sched_getcpu();
+    }}.join();
+
+    EXPECT_TRUE(placed);
+    EXPECT_EQ(cpu, 0);
+    EXPECT_EQ(placement.cpu.load(), 0);
+    EXPECT_EQ(placement.numa_node.load(), get_numa_node(0));
+}
+
+TEST(ThreadPlacement, threadWithoutCpusIsNotPinned) {
+    ThreadPlacement placement;
+
+    EXPECT_TRUE(place_current_thread({}, 0, placement));
+    EXPECT_EQ(placement.cpu.load(), -1);
+    EXPECT_EQ(placement.numa_node.load(), -1);
+}
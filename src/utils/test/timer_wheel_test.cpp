@@ -0,0 +1,143 @@
+#include <chrono>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "timer_wheel.hpp"
+
+using namespace std::chrono_literals;
+
+namespace {
+const auto START = TimerWheel::Clock::time_point{} + 1h;
+} // namespace
+
+TEST(TimerWheel, oneShotTimersRunOnceInOrder) {
+    TimerWheel timer_wheel{START};
+    std::vector<int> runs;
+
+    timer_wheel.schedule(START + 30ms, [&]() { runs.push_back(30); });
+    timer_wheel.schedule(START + 10ms, [&]() { runs.push_back(10); });
+    timer_wheel.schedule(START + 20ms, [&]() { runs.push_back(20); });
+    EXPECT_EQ(timer_wheel.size(), 3);
+    EXPECT_EQ(timer_wheel.get_next_advance_time(), START + 10ms);
+
+    // Never early.
+    EXPECT_EQ(timer_wheel.advance(START + 9ms), 0);
+    EXPECT_EQ(timer_wheel.advance(START + 20ms), 2);
+    EXPECT_EQ(runs, (std::vector<int>{10, 20}));
+
+    EXPECT_EQ(timer_wheel.advance(START + 1s), 1);
+    EXPECT_EQ(runs, (std::vector<int>{10, 20, 30}));
+    EXPECT_EQ(timer_wheel.size(), 0);
+    EXPECT_FALSE(timer_wheel.get_next_advance_time().has_value());
+}
+
+TEST(TimerWheel, periodicTimerRunsUntilCancelled) {
+    TimerWheel timer_wheel{START};
+    std::size_t number_of_runs{0};
+
+    const auto timer_id = timer_wheel.schedule(START + 100ms, [&]() { ++number_of_runs; }, 100ms);
+    for (auto now = START; now <= START + 1s; now += 10ms) {
+        timer_wheel.advance(now);
+    }
+    EXPECT_EQ(number_of_runs, 10);
+
+    EXPECT_TRUE(timer_wheel.cancel(timer_id));
+    EXPECT_FALSE(timer_wheel.cancel(timer_id));
+    timer_wheel.advance(START + 2s);
+    EXPECT_EQ(number_of_runs, 10);
+    EXPECT_EQ(timer_wheel.size(), 0);
+}
+
+TEST(TimerWheel, cancelledTimersDoNotRun) {
+    TimerWheel timer_wheel{START};
+    auto has_run = false;
+
+    const auto timer_id = timer_wheel.schedule(START + 5ms, [&]() { has_run = true; });
+    EXPECT_TRUE(timer_wheel.cancel(timer_id));
+    timer_wheel.advance(START + 10ms);
+    EXPECT_FALSE(has_run);
+
+    // The slot of the timer is reused, the old id does not cancel the new timer.
+    timer_wheel.schedule(START + 20ms, [&]() { has_run = true; });
+    EXPECT_FALSE(timer_wheel.cancel(timer_id));
+    timer_wheel.advance(START + 20ms);
+    EXPECT_TRUE(has_run);
+}
+
+// Timers on the higher levels move down until they run at their expiry, also when the wheel is advanced in one step.
+// The last ones are beyond the range of the highest level.
+TEST(TimerWheel, distantTimersRunOnTime) {
+    const std::vector<std::chrono::milliseconds> delays{63ms, 64ms, 4095ms, 4096ms, 300s, 5h, 10h};
+
+    for (const auto step : std::vector<std::chrono::milliseconds>{1ms, 7ms, 1s, 11h}) {
+        TimerWheel timer_wheel{START};
+        std::vector<TimerWheel::Clock::time_point> run_times(delays.size(), START + 12h);
+        auto now = START;
+
+        // The small steps only go up to the closer timers to keep the test fast.
+        const auto last_delay = step < 1s ? 300s : 10h;
+        for (std::size_t idx{0}; idx < delays.size() && delays[idx] <= last_delay; ++idx) {
+            timer_wheel.schedule(START + delays[idx], [&, idx]() { run_times[idx] = now; });
+        }
+
+        while (timer_wheel.size() != 0) {
+            now += step;
+            timer_wheel.advance(now);
+        }
+
+        for (std::size_t idx{0}; idx < delays.size() && delays[idx] <= last_delay; ++idx) {
+            EXPECT_GE(run_times[idx], START + delays[idx]) << "step " << step.count() << "ms";
+            EXPECT_LT(run_times[idx], START + delays[idx] + step) << "step " << step.count() << "ms";
+        }
+    }
+}
+
+// The next advance time lets the owner sleep without missing a timer.
+TEST(TimerWheel, nextAdvanceTimeIsNeverLate) {
+    TimerWheel timer_wheel{START};
+    const auto expiry = START + 300s;
+    auto has_run = false;
+    timer_wheel.schedule(expiry, [&]() { has_run = true; });
+
+    std::size_t number_of_wake_ups{0};
+    while (!has_run) {
+        const auto next_advance_time = timer_wheel.get_next_advance_time();
+        ASSERT_TRUE(next_advance_time.has_value());
+        ASSERT_LE(*next_advance_time, expiry);
+        timer_wheel.advance(*next_advance_time);
+        ++number_of_wake_ups;
+    }
+
+    // The timer moves down the levels instead of waking the owner up on every tick.
+    EXPECT_LE(number_of_wake_ups, 4);
+}
+
+TEST(TimerWheel, callbacksCanScheduleAndCancelTimers) {
+    TimerWheel timer_wheel{START};
+    std::vector<int> runs;
+
+    TimerId periodic_timer_id{TimerWheel::INVALID_TIMER_ID};
+    std::size_t number_of_periodic_runs{0};
+    periodic_timer_id = timer_wheel.schedule(
+      START + 1ms,
+      [&]() {
+          runs.push_back(1);
+          if (++number_of_periodic_runs == 3) {
+              EXPECT_TRUE(timer_wheel.cancel(periodic_timer_id));
+          }
+      },
+      1ms);
+
+    // Timers of the same tick run in reverse order of scheduling.
+    const auto cancelled_timer_id = timer_wheel.schedule(START + 2ms, [&]() { runs.push_back(-1); });
+    timer_wheel.schedule(START + 2ms, [&]() {
+        runs.push_back(2);
+        timer_wheel.schedule(START + 4ms, [&]() { runs.push_back(4); });
+        EXPECT_TRUE(timer_wheel.cancel(cancelled_timer_id));
+    });
+
+    timer_wheel.advance(START + 10ms);
+    EXPECT_EQ(runs, (std::vector<int>{1, 1, 2, 1, 4}));
+    EXPECT_EQ(timer_wheel.size(), 0);
+}